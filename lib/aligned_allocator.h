@@ -0,0 +1,49 @@
+#include <stdlib.h>
+#include <cstddef>
+#include <new>
+
+#ifndef _aligned_allocator_h
+#define _aligned_allocator_h
+/**
+ * Allocator for std::vector that places the first element on an Alignment-byte boundary. Columns of
+ * stock data use this so that each array starts on its own cache line.
+ */
+template<class T, std::size_t Alignment = 64>
+class aligned_allocator {
+	public:
+		typedef T value_type;
+
+		template<class U>
+		struct rebind {
+			typedef aligned_allocator<U, Alignment> other;
+		};
+
+		aligned_allocator() {}
+
+		template<class U>
+		aligned_allocator(const aligned_allocator<U, Alignment> &) {}
+
+		T *allocate(std::size_t n) {
+			void *ret = nullptr;
+
+			if (posix_memalign(&ret, Alignment, n * sizeof(T)))
+				throw std::bad_alloc();
+
+			return static_cast<T *>(ret);
+		}
+
+		void deallocate(T *p, std::size_t) {
+			free(p);
+		}
+
+		template<class U>
+		bool operator ==(const aligned_allocator<U, Alignment> &) const {
+			return true;
+		}
+
+		template<class U>
+		bool operator !=(const aligned_allocator<U, Alignment> &) const {
+			return false;
+		}
+};
+#endif
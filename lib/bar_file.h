@@ -0,0 +1,141 @@
+#include <stdint.h>
+#include <string.h>
+
+#ifndef _bar_file_h
+#define _bar_file_h
+/**
+ * Binary bar file format (version 3).
+ *
+ * A 64-byte header followed by one fixed-width column per field, in this order: day (int32, days since
+ * 1970-01-01), open, high, low, close (double) and volume (int64). Every column starts on a 64-byte boundary
+ * so that a mapped file can be read without any parsing. Values are stored in host byte order; byte_order
+ * lets a reader reject files written on a different architecture.
+ */
+#define BAR_FILE_MAGIC "RSIBARS"
+#define BAR_FILE_VERSION 3
+#define BAR_FILE_BYTE_ORDER 0x01020304
+#define BAR_FILE_ALIGN 64
+#define BAR_FILE_DATE_WIDTH 16
+#define BAR_FILE_ROW_BYTES (sizeof(int32_t) + 4 * sizeof(double) + sizeof(int64_t))
+
+struct bar_file_header {
+	char magic[8];
+	uint32_t version;
+	uint32_t byte_order;
+	uint64_t rows;
+	uint64_t reserved[5];
+};
+
+// Byte offsets of each column, relative to the start of the header.
+struct bar_file_columns {
+	uint64_t day;
+	uint64_t open;
+	uint64_t high;
+	uint64_t low;
+	uint64_t close;
+	uint64_t volume;
+	uint64_t size;
+};
+
+/**
+ * Bar log format (version 2).
+ *
+ * Daily updates are appended to "<bar file>.log" instead of rewriting the bar file. The log is a 64-byte
+ * header followed by one 64-byte record per bar, oldest first. Loading a bar file replays its log on top of
+ * it, and the log is folded back into the bar file once it holds BAR_LOG_COMPACT_ROWS records.
+ */
+#define BAR_LOG_MAGIC "RSIBLOG"
+#define BAR_LOG_VERSION 2
+#define BAR_LOG_COMPACT_ROWS 64
+
+// Log records key rows by timestamp (midnight UTC) and date.
+struct bar_log_record {
+	int64_t timestamp;
+	double open;
+	double high;
+	double low;
+	double close;
+	int64_t volume;
+	char date[BAR_FILE_DATE_WIDTH];
+};
+
+/**
+ * Round a byte count up to the next column boundary.
+ */
+inline uint64_t bar_file_align(uint64_t bytes) {
+	return (bytes + BAR_FILE_ALIGN - 1) & ~(uint64_t)(BAR_FILE_ALIGN - 1);
+}
+
+/**
+ * Find where each column of a file with the given number of rows lives.
+ */
+inline struct bar_file_columns bar_file_layout(uint64_t rows) {
+	struct bar_file_columns ret;
+
+	ret.day = bar_file_align(sizeof(struct bar_file_header));
+	ret.open = ret.day + bar_file_align(rows * sizeof(int32_t));
+	ret.high = ret.open + bar_file_align(rows * sizeof(double));
+	ret.low = ret.high + bar_file_align(rows * sizeof(double));
+	ret.close = ret.low + bar_file_align(rows * sizeof(double));
+	ret.volume = ret.close + bar_file_align(rows * sizeof(double));
+	ret.size = ret.volume + bar_file_align(rows * sizeof(int64_t));
+
+	return ret;
+}
+
+/**
+ * Fill out a header for a file with the given number of rows.
+ */
+inline struct bar_file_header bar_file_new_header(uint64_t rows) {
+	struct bar_file_header ret;
+
+	memset(&ret, 0, sizeof(ret));
+	memcpy(ret.magic, BAR_FILE_MAGIC, sizeof(ret.magic));
+	ret.version = BAR_FILE_VERSION;
+	ret.byte_order = BAR_FILE_BYTE_ORDER;
+	ret.rows = rows;
+
+	return ret;
+}
+
+/**
+ * Fill out a header for a new bar log. Logs share the bar file header, with no rows.
+ */
+inline struct bar_file_header bar_log_new_header() {
+	struct bar_file_header ret = bar_file_new_header(0);
+
+	memcpy(ret.magic, BAR_LOG_MAGIC, sizeof(ret.magic));
+	ret.version = BAR_LOG_VERSION;
+
+	return ret;
+}
+
+/**
+ * Check that a header is one we know how to read, and that size bytes are enough to hold its columns.
+ */
+inline bool bar_file_valid(const struct bar_file_header *header, uint64_t size) {
+	if (size < sizeof(struct bar_file_header))
+		return false;
+
+	if ((memcmp(header->magic, BAR_FILE_MAGIC, sizeof(header->magic)) != 0) ||
+	    (header->version != BAR_FILE_VERSION) || (header->byte_order != BAR_FILE_BYTE_ORDER))
+		return false;
+
+	// The offsets of a huge row count would overflow, so bound it by the bytes there are first.
+	if (header->rows > (size - sizeof(struct bar_file_header)) / BAR_FILE_ROW_BYTES)
+		return false;
+
+	return bar_file_layout(header->rows).size <= size;
+}
+
+/**
+ * Check that a log header is one we know how to read.
+ */
+inline bool bar_log_valid(const struct bar_file_header *header, uint64_t size) {
+	if (size < sizeof(struct bar_file_header))
+		return false;
+
+	return (memcmp(header->magic, BAR_LOG_MAGIC, sizeof(header->magic)) == 0) &&
+	       (header->version == BAR_LOG_VERSION) && (header->byte_order == BAR_FILE_BYTE_ORDER);
+}
+#endif
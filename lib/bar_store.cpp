@@ -0,0 +1,536 @@
+#include <sys/stat.h>
+#include <sys/mman.h>
+#include <stdlib.h>
+#include <string.h>
+#include <ctype.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <errno.h>
+#include <algorithm>
+
+#include <boost/log/trivial.hpp>
+
+#include "lib/bar_file.h"
+#include "lib/bar_store.h"
+
+static_assert(sizeof(struct bar_store_header) == BAR_FILE_ALIGN, "Store blocks start on a column boundary.");
+
+/**
+ * When a file was last written, to the nanosecond. macOS names the field after its type.
+ */
+static struct timespec modified_at(const struct stat &buf) {
+#ifdef __APPLE__
+	return buf.st_mtimespec;
+#else
+	return buf.st_mtim;
+#endif
+}
+
+/**
+ * Class clean-up. An uncommitted store is thrown away, as are replaced tickers that were never saved.
+ */
+bar_store::~bar_store() {
+	if (write_filename == nullptr)
+		abandon();
+	else if (wr != nullptr) {
+		fclose(wr);
+		unlink(write_filename);
+	}
+
+	unmap();
+
+	if (write_filename != nullptr)
+		free(write_filename);
+	if (read_filename != nullptr)
+		free(read_filename);
+}
+
+/**
+ * Map a store into memory and index its symbols.
+ *
+ * @param filename The store to read.
+ * @return boolean. True if the file existed and was valid.
+ */
+bool bar_store::open(const char *filename) {
+	const struct bar_store_header *header;
+	struct stat buf;
+	uint64_t x;
+	int fd, y;
+
+	unmap();
+
+	if ((fd = ::open(filename, O_RDONLY)) == -1) {
+		BOOST_LOG_TRIVIAL(trace) << "Unable to open store: " << filename;
+		return false;
+	}
+
+	if ((fstat(fd, &buf) == -1) || (buf.st_size < (off_t)sizeof(struct bar_store_header))) {
+		BOOST_LOG_TRIVIAL(error) << "Store is too short: " << filename;
+		::close(fd);
+		return false;
+	}
+
+	map = (const char *)mmap(nullptr, buf.st_size, PROT_READ, MAP_SHARED, fd, 0);
+	::close(fd);
+	if (map == MAP_FAILED) {
+		BOOST_LOG_TRIVIAL(error) << "Unable to map store " << filename << ": " << strerror(errno);
+		map = nullptr;
+		return false;
+	}
+	map_size = buf.st_size;
+	map_time = modified_at(buf);
+
+	// Validate the header and the index before trusting any offsets.
+	header = (const struct bar_store_header *)map;
+	if ((memcmp(header->magic, BAR_STORE_MAGIC, sizeof(header->magic)) != 0) || (header->version != BAR_STORE_VERSION) ||
+	    (header->byte_order != BAR_FILE_BYTE_ORDER) || (header->index > map_size) ||
+	    (header->symbols > (map_size - header->index) / sizeof(struct bar_store_entry))) {
+		BOOST_LOG_TRIVIAL(error) << "Unrecognized store: " << filename;
+		unmap();
+		return false;
+	}
+
+	entries = (const struct bar_store_entry *)(map + header->index);
+	index.reserve(header->symbols);
+	for (x = 0; x < header->symbols; x++) {
+		for (y = 0; y < store_blocks; y++)
+			if ((entries[x].blocks[y].offset > map_size) || (entries[x].blocks[y].size > map_size - entries[x].blocks[y].offset)) {
+				BOOST_LOG_TRIVIAL(error) << "Store entry " << x << " is out of range: " << filename;
+				unmap();
+				return false;
+			}
+
+		// symbol() hands the name out as a C string.
+		if (memchr(entries[x].symbol, '\0', BAR_STORE_SYMBOL_WIDTH) == nullptr) {
+			BOOST_LOG_TRIVIAL(error) << "Store entry " << x << " has no end to its symbol: " << filename;
+			unmap();
+			return false;
+		}
+
+		index[entries[x].symbol] = x;
+	}
+
+	if (read_filename != filename) {
+		free(read_filename);
+		read_filename = strdup(filename);
+	}
+
+	BOOST_LOG_TRIVIAL(trace) << "Opened store " << filename << " with " << index.size() << " symbols.";
+	return true;
+}
+
+bool bar_store::is_open() const {
+	return map != nullptr;
+}
+
+/**
+ * Return the number of symbols in the store.
+ */
+long bar_store::length() const {
+	return is_open() ? ((const struct bar_store_header *)map)->symbols : 0;
+}
+
+/**
+ * Return the symbol stored at position index, or nullptr. The string lives as long as the store is open.
+ */
+const char *bar_store::symbol(const long index) const {
+	if ((index < 0) || (index >= length()))
+		return nullptr;
+
+	return entries[index].symbol;
+}
+
+/**
+ * Copy one ticker's bars out of the store.
+ *
+ * @param symbol The ticker, in any case.
+ * @param data Receives the bars.
+ * @param block store_bars for the daily bars, or store_week_bars for the calendar weeks.
+ * @return boolean. False if the symbol is not in the store, or has no such bars.
+ */
+bool bar_store::load(const char *symbol, stockinfo &data, store_block block) const {
+	char key[BAR_STORE_SYMBOL_WIDTH];
+	const struct bar_store_extent *extent;
+
+	if (!is_open() || !normalize(symbol, key))
+		return false;
+
+	auto found = index.find(key);
+	if (found == index.end())
+		return false;
+
+	extent = &entries[found->second].blocks[block];
+	if (extent->size == 0)
+		return false;
+
+	if (!data.read_bars(map + extent->offset, extent->size)) {
+		BOOST_LOG_TRIVIAL(error) << "Corrupt store entry: " << key;
+		return false;
+	}
+
+	BOOST_LOG_TRIVIAL(trace) << "Loaded " << data.length() << " records for " << key << " from the store.";
+	return true;
+}
+
+/**
+ * Copy one block of a ticker out of the store as it was written, like the state of its live indicators.
+ *
+ * @param size The size of out. The block must be exactly this long.
+ * @return boolean. False if the symbol is not in the store, or its block is another size.
+ */
+bool bar_store::read(const char *symbol, store_block block, void *out, uint64_t size) const {
+	char key[BAR_STORE_SYMBOL_WIDTH];
+	const struct bar_store_extent *extent;
+
+	if (!is_open() || !normalize(symbol, key))
+		return false;
+
+	auto found = index.find(key);
+	if (found == index.end())
+		return false;
+
+	extent = &entries[found->second].blocks[block];
+	if (extent->size != size)
+		return false;
+
+	memcpy(out, map + extent->offset, size);
+	return true;
+}
+
+/**
+ * Whether a file was written after the open store was mapped.
+ *
+ * @return boolean. False if the file does not exist.
+ */
+bool bar_store::older_than(const char *filename) const {
+	struct timespec written;
+	struct stat buf;
+
+	if (!is_open() || (stat(filename, &buf) == -1))
+		return false;
+
+	written = modified_at(buf);
+	return (written.tv_sec > map_time.tv_sec) || ((written.tv_sec == map_time.tv_sec) && (written.tv_nsec > map_time.tv_nsec));
+}
+
+/**
+ * @return The size of the open store in bytes, or 0.
+ */
+uint64_t bar_store::size() const {
+	return is_open() ? map_size : 0;
+}
+
+/**
+ * @return The bytes of the open store that no entry uses: blocks that were replaced, and old indexes.
+ */
+uint64_t bar_store::unused() const {
+	uint64_t used = sizeof(struct bar_store_header) + length() * sizeof(struct bar_store_entry);
+	long x;
+	int y;
+
+	for (x = 0; x < length(); x++)
+		for (y = 0; y < store_blocks; y++)
+			used += entries[x].blocks[y].size;
+
+	return (map_size > used) ? map_size - used : 0;
+}
+
+/**
+ * Start writing a new store. It is written next to filename and renamed over it by commit().
+ */
+bool bar_store::create(const char *filename) {
+	struct bar_store_header header = {};
+
+	if (wr != nullptr)
+		return false;
+
+	write_filename = (char *)malloc(strlen(filename) + 5);
+	sprintf(write_filename, "%s.tmp", filename);
+
+	if ((wr = fopen(write_filename, "w")) == NULL) {
+		BOOST_LOG_TRIVIAL(error) << "Unable to open " << write_filename << " for writing: " << strerror(errno);
+		free(write_filename);
+		write_filename = nullptr;
+		return false;
+	}
+
+	// Reserve room for the header. commit() fills it in.
+	written.clear();
+	return fwrite(&header, sizeof(header), 1, wr) == 1;
+}
+
+/**
+ * Add one ticker to the store being written.
+ *
+ * @param data The daily bars.
+ * @param weeks The calendar weeks, if they are kept.
+ * @param live The state of the live indicators, if there is one, and its size.
+ */
+bool bar_store::append(const char *symbol, const stockinfo &data, const stockinfo *weeks, const void *live, uint64_t live_size) {
+	struct bar_store_entry entry = {};
+
+	if ((wr == nullptr) || (write_filename == nullptr) || !write_entry(symbol, data, weeks, live, live_size, entry))
+		return false;
+
+	written.push_back(entry);
+	return true;
+}
+
+/**
+ * Write the index and header, then replace the old store with the new one.
+ */
+bool bar_store::commit() {
+	struct bar_store_header header = {};
+	char *filename;
+	long pos;
+	bool ret;
+
+	if ((wr == nullptr) || (write_filename == nullptr))
+		return false;
+
+	memcpy(header.magic, BAR_STORE_MAGIC, sizeof(header.magic));
+	header.version = BAR_STORE_VERSION;
+	header.byte_order = BAR_FILE_BYTE_ORDER;
+	header.symbols = written.size();
+
+	pos = ftell(wr);
+	header.index = pos;
+	ret = (pos >= 0);
+	ret = ret && (written.empty() || (fwrite(written.data(), sizeof(struct bar_store_entry), written.size(), wr) == written.size()));
+	ret = ret && (fseek(wr, 0, SEEK_SET) == 0) && (fwrite(&header, sizeof(header), 1, wr) == 1);
+	ret = (fclose(wr) == 0) && ret;
+	wr = nullptr;
+
+	// Drop the ".tmp" suffix.
+	filename = strndup(write_filename, strlen(write_filename) - 4);
+	if (ret && (rename(write_filename, filename) == -1)) {
+		BOOST_LOG_TRIVIAL(error) << "Error moving " << write_filename << " to " << filename << ": " << strerror(errno);
+		ret = false;
+	}
+
+	if (!ret)
+		unlink(write_filename);
+
+	free(filename);
+	free(write_filename);
+	write_filename = nullptr;
+
+	return ret;
+}
+
+/**
+ * Write one ticker's blocks at the end of the open store, like append(). Its old blocks, if any, are no longer
+ * used once save() succeeds.
+ */
+bool bar_store::replace(const char *symbol, const stockinfo &data, const stockinfo *weeks, const void *live, uint64_t live_size) {
+	struct bar_store_entry entry = {};
+	std::string key;
+	long x;
+
+	if (!begin_update())
+		return false;
+
+	if (!write_entry(symbol, data, weeks, live, live_size, entry)) {
+		BOOST_LOG_TRIVIAL(error) << "Failed to write " << symbol << " to " << read_filename;
+		abandon();
+		return false;
+	}
+
+	key = std::string(entry.symbol, strnlen(entry.symbol, BAR_STORE_SYMBOL_WIDTH));
+	auto found = index.find(key);
+	if (found != index.end()) {
+		written[found->second] = entry;
+		return true;
+	}
+
+	// A symbol the store did not have, which may have been replaced before.
+	for (x = length(); x < (long)written.size(); x++)
+		if (memcmp(written[x].symbol, entry.symbol, BAR_STORE_SYMBOL_WIDTH) == 0)
+			break;
+	if (x < (long)written.size())
+		written[x] = entry;
+	else
+		written.push_back(entry);
+
+	return true;
+}
+
+/**
+ * Drop one ticker from the open store. Like replace(), nothing changes for readers until save() succeeds.
+ *
+ * @return boolean. False if the symbol is not in the store.
+ */
+bool bar_store::remove(const char *symbol) {
+	char key[BAR_STORE_SYMBOL_WIDTH];
+	long x;
+
+	if (!normalize(symbol, key) || !begin_update())
+		return false;
+
+	// An empty symbol marks the entry for save() to leave out.
+	for (x = 0; x < (long)written.size(); x++)
+		if (memcmp(written[x].symbol, key, BAR_STORE_SYMBOL_WIDTH) == 0) {
+			written[x].symbol[0] = '\0';
+			return true;
+		}
+
+	return false;
+}
+
+/**
+ * @return boolean. True if tickers were replaced or removed since the last save().
+ */
+bool bar_store::pending() const {
+	return (wr != nullptr) && (write_filename == nullptr);
+}
+
+/**
+ * Start from the open store's index, and write after everything in the file, unless an update is under way.
+ */
+bool bar_store::begin_update() {
+	if (!is_open() || (write_filename != nullptr))
+		return false;
+	if (wr != nullptr)
+		return true;
+
+	if ((wr = fopen(read_filename, "r+")) == NULL) {
+		BOOST_LOG_TRIVIAL(error) << "Unable to open " << read_filename << " for writing: " << strerror(errno);
+		return false;
+	}
+
+	written.assign(entries, entries + length());
+	if (fseek(wr, 0, SEEK_END) != 0) {
+		abandon();
+		return false;
+	}
+
+	return true;
+}
+
+/**
+ * Give up on the tickers replaced since the last save(). The file is cut back to the size it was mapped at, so
+ * nothing that was written after it is left behind.
+ */
+void bar_store::abandon() {
+	if (wr == nullptr)
+		return;
+
+	fflush(wr);
+	if (ftruncate(fileno(wr), map_size) == -1)
+		BOOST_LOG_TRIVIAL(error) << "Unable to truncate " << read_filename << ": " << strerror(errno);
+	fclose(wr);
+	wr = nullptr;
+	written.clear();
+}
+
+/**
+ * Write the index after the replaced tickers, then point the header at it, and map the store again.
+ */
+bool bar_store::save() {
+	struct bar_store_header header;
+	char *filename;
+	long pos;
+	bool ret;
+
+	if ((wr == nullptr) || (write_filename != nullptr))
+		return false;
+
+	// Leave out the tickers that were removed.
+	written.erase(std::remove_if(written.begin(), written.end(), [](const struct bar_store_entry &entry) {
+		return entry.symbol[0] == '\0';
+	}), written.end());
+
+	memcpy(&header, map, sizeof(header));
+	header.symbols = written.size();
+
+	pos = ftell(wr);
+	header.index = pos;
+	ret = (pos >= 0);
+	ret = ret && (written.empty() || (fwrite(written.data(), sizeof(struct bar_store_entry), written.size(), wr) == written.size()));
+
+	// The index must be on disk before the header points at it.
+	ret = ret && (fflush(wr) == 0) && (fsync(fileno(wr)) == 0);
+	ret = ret && (fseek(wr, 0, SEEK_SET) == 0) && (fwrite(&header, sizeof(header), 1, wr) == 1);
+	ret = (fclose(wr) == 0) && ret;
+	wr = nullptr;
+
+	filename = strdup(read_filename);
+	ret = open(filename) && ret;
+	free(filename);
+
+	return ret;
+}
+
+/**
+ * Write one ticker's blocks at the current end of the file being written. Empty calendar weeks are left out.
+ *
+ * @param entry Receives the symbol, and the offset and size of each block.
+ */
+bool bar_store::write_entry(const char *symbol, const stockinfo &data, const stockinfo *weeks, const void *live,
+                            uint64_t live_size, struct bar_store_entry &entry) {
+	if (!normalize(symbol, entry.symbol) || !align(entry.blocks[store_bars]) || !data.write_bars(wr))
+		return false;
+	entry.blocks[store_bars].size = bar_file_layout(data.length()).size;
+
+	if ((weeks != nullptr) && weeks->length()) {
+		if (!align(entry.blocks[store_week_bars]) || !weeks->write_bars(wr))
+			return false;
+		entry.blocks[store_week_bars].size = bar_file_layout(weeks->length()).size;
+	}
+
+	if ((live != nullptr) && live_size) {
+		if (!align(entry.blocks[store_live]) || (fwrite(live, live_size, 1, wr) != 1))
+			return false;
+		entry.blocks[store_live].size = live_size;
+	}
+
+	return true;
+}
+
+/**
+ * Pad the file being written out to a column boundary, where the next block starts.
+ *
+ * @param block Receives the offset of the block.
+ */
+bool bar_store::align(struct bar_store_extent &block) {
+	static const char padding[BAR_FILE_ALIGN] = {};
+	long pos;
+
+	pos = ftell(wr);
+	if ((pos < 0) || ((bar_file_align(pos) > (uint64_t)pos) && (fwrite(padding, bar_file_align(pos) - pos, 1, wr) != 1)))
+		return false;
+
+	block.offset = bar_file_align(pos);
+	return true;
+}
+
+/**
+ * Release the mapped store.
+ */
+void bar_store::unmap() {
+	if (map != nullptr)
+		munmap((void *)map, map_size);
+
+	map = nullptr;
+	map_size = 0;
+	entries = nullptr;
+	index.clear();
+}
+
+/**
+ * Copy a symbol into a fixed-width, upper case key.
+ *
+ * @return boolean. False if the symbol is empty or too long.
+ */
+bool bar_store::normalize(const char *symbol, char *out) const {
+	size_t x, len = strlen(symbol);
+
+	if ((len == 0) || (len >= BAR_STORE_SYMBOL_WIDTH))
+		return false;
+
+	memset(out, 0, BAR_STORE_SYMBOL_WIDTH);
+	for (x = 0; x < len; x++)
+		out[x] = toupper(symbol[x]);
+
+	return true;
+}
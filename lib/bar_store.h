@@ -0,0 +1,100 @@
+#include <stdio.h>
+#include <stdint.h>
+#include <time.h>
+#include <string>
+#include <vector>
+#include <unordered_map>
+#include "lib/stock.h"
+
+#ifndef _bar_store_h
+#define _bar_store_h
+/**
+ * Single-file store for many tickers (version 2).
+ *
+ * A 64-byte header, then the blocks of each ticker, each starting on a 64-byte boundary, then an index of
+ * fixed-width entries that map a symbol to the offset and size of each of its blocks. Every ticker has a bar file
+ * image of its daily bars (see lib/bar_file.h). It can also have an image of its calendar weeks and the saved state
+ * of its live indicators; a block it does not have is empty. The whole file is mapped once, so a scan over every
+ * ticker needs one file descriptor.
+ *
+ * An open store can also be updated in place: replace() writes the new blocks of a ticker after everything in the
+ * file, and save() writes an index that points at them, then the header. Until the header is written, readers see
+ * the old index. remove() drops a ticker from the index that save() writes. The old blocks are left unused until
+ * the store is packed again with create(). If a replace() fails, every ticker replaced since the last save() is
+ * dropped, and the file is cut back to the size it had.
+ */
+#define BAR_STORE_MAGIC "RSISTOR"
+#define BAR_STORE_VERSION 2
+#define BAR_STORE_SYMBOL_WIDTH 16
+
+struct bar_store_header {
+	char magic[8];
+	uint32_t version;
+	uint32_t byte_order;
+	uint64_t symbols;
+	uint64_t index;
+	uint64_t reserved[4];
+};
+
+enum store_block { store_bars, store_week_bars, store_live, store_blocks };
+
+struct bar_store_extent {
+	uint64_t offset;
+	uint64_t size;
+};
+
+struct bar_store_entry {
+	char symbol[BAR_STORE_SYMBOL_WIDTH];
+	struct bar_store_extent blocks[store_blocks];
+};
+
+class bar_store {
+	public:
+		bar_store(): map(nullptr), map_size(0), map_time{}, entries(nullptr), read_filename(nullptr), wr(nullptr), write_filename(nullptr) {};
+		~bar_store();
+
+		// Reading.
+		bool open(const char *filename);
+		bool is_open() const;
+		long length() const;
+		const char *symbol(const long index) const;
+		bool load(const char *symbol, stockinfo &data, store_block block = store_bars) const;
+		bool read(const char *symbol, store_block block, void *out, uint64_t size) const;
+		bool older_than(const char *filename) const;
+		uint64_t size() const;
+		uint64_t unused() const;
+
+		// Writing. Nothing replaces the old file until commit() succeeds.
+		bool create(const char *filename);
+		bool append(const char *symbol, const stockinfo &data, const stockinfo *weeks = nullptr, const void *live = nullptr,
+		            uint64_t live_size = 0);
+		bool commit();
+
+		// Updating the open store in place. Nothing changes for readers until save() succeeds.
+		bool replace(const char *symbol, const stockinfo &data, const stockinfo *weeks = nullptr, const void *live = nullptr,
+		             uint64_t live_size = 0);
+		bool remove(const char *symbol);
+		bool pending() const;
+		bool save();
+
+	private:
+		void unmap();
+		bool begin_update();
+		void abandon();
+		bool normalize(const char *symbol, char *out) const;
+		bool write_entry(const char *symbol, const stockinfo &data, const stockinfo *weeks, const void *live,
+		                 uint64_t live_size, struct bar_store_entry &entry);
+		bool align(struct bar_store_extent &block);
+
+		const char *map;
+		size_t map_size;
+		struct timespec map_time;
+		const struct bar_store_entry *entries;
+		std::unordered_map<std::string, long> index;
+		char *read_filename;
+
+		FILE *wr;
+		char *write_filename;
+		std::vector<struct bar_store_entry> written;
+};
+#endif
@@ -0,0 +1,83 @@
+#include <ctype.h>
+#include <string.h>
+
+#include "lib/calendar.h"
+
+/**
+ * Read up to max digits.
+ *
+ * @return The number of digits read, or 0 if there were none.
+ */
+static int read_digits(const char **p, int max, int *value)
+{
+	int ret = 0;
+
+	*value = 0;
+	while ((ret < max) && isdigit(**p))
+	{
+		*value = *value * 10 + (*(*p)++ - '0');
+		ret++;
+	}
+
+	return ret;
+}
+
+/**
+ * Read an English month name, full or abbreviated, in any case.
+ *
+ * @return The month (1-12), or 0 if there was none.
+ */
+static unsigned read_month(const char **p)
+{
+	static const char *months[] = {"january", "february", "march", "april", "may", "june", "july", "august",
+	                               "september", "october", "november", "december"};
+	size_t len;
+	unsigned x;
+
+	for (x = 0; x < 12; x++)
+	{
+		if (strncasecmp(*p, months[x], 3) != 0)
+			continue;
+
+		len = strlen(months[x]);
+		*p += (strncasecmp(*p, months[x], len) == 0) ? len : 3;
+		return x + 1;
+	}
+
+	return 0;
+}
+
+/**
+ * Parse a %Y-%m-%d (Yahoo) or %d-%B-%y (Google) date into a day number. Two digit years follow strptime():
+ * 69-99 are 1969-1999, 00-68 are 2000-2068. Anything after the date is ignored.
+ *
+ * @return boolean. False if date is in neither format.
+ */
+bool parse_civil_date(const char *date, int32_t *days)
+{
+	const char *p = date;
+	int year, month, day;
+
+	// %Y-%m-%d
+	if (read_digits(&p, 4, &year) && (*p == '-'))
+	{
+		p++;
+		if (read_digits(&p, 2, &month) && (*p++ == '-') && read_digits(&p, 2, &day) &&
+		    (month >= 1) && (month <= 12) && (day >= 1) && (day <= 31))
+		{
+			*days = days_from_civil(year, month, day);
+			return true;
+		}
+	}
+
+	// %d-%B-%y
+	p = date;
+	if (read_digits(&p, 2, &day) && (*p++ == '-') && ((month = read_month(&p)) != 0) &&
+	    (*p++ == '-') && read_digits(&p, 2, &year) && (day >= 1) && (day <= 31))
+	{
+		*days = days_from_civil(year + (year < 69 ? 2000 : 1900), month, day);
+		return true;
+	}
+
+	return false;
+}
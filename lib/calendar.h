@@ -0,0 +1,138 @@
+#include <stdint.h>
+
+#ifndef _calendar_h
+#define _calendar_h
+/**
+ * Calendar arithmetic on day numbers (days since 1970-01-01) in the proleptic Gregorian calendar. Nothing
+ * here consults the C library, the locale or the time zone database.
+ *
+ * The conversions are Howard Hinnant's civil date algorithms: http://howardhinnant.github.io/date_algorithms.html
+ */
+#define SECONDS_PER_DAY 86400
+
+/**
+ * Return the day number of year-month-day. Out of range days roll over into the next month, like mktime().
+ */
+inline int32_t days_from_civil(int year, unsigned month, unsigned day) {
+	int era;
+	unsigned yoe, doy, doe;
+
+	year -= (month <= 2);
+	era = (year >= 0 ? year : year - 399) / 400;
+	yoe = (unsigned)(year - era * 400);
+	doy = (153 * (month + (month > 2 ? -3 : 9)) + 2) / 5 + day - 1;
+	doe = yoe * 365 + yoe / 4 - yoe / 100 + doy;
+
+	return era * 146097 + (int32_t)doe - 719468;
+}
+
+/**
+ * Split a day number into year, month (1-12) and day of the month (1-31).
+ */
+inline void civil_from_days(int32_t days, int *year, unsigned *month, unsigned *day) {
+	int era;
+	unsigned doe, yoe, doy, mp;
+
+	days += 719468;
+	era = (days >= 0 ? days : days - 146096) / 146097;
+	doe = (unsigned)(days - era * 146097);
+	yoe = (doe - doe / 1460 + doe / 36524 - doe / 146096) / 365;
+	doy = doe - (365 * yoe + yoe / 4 - yoe / 100);
+	mp = (5 * doy + 2) / 153;
+
+	*day = doy - (153 * mp + 2) / 5 + 1;
+	*month = mp < 10 ? mp + 3 : mp - 9;
+	*year = (int)yoe + era * 400 + (*month <= 2);
+}
+
+/**
+ * Return the number of days in a month (1-12).
+ */
+inline unsigned days_in_month(int year, unsigned month) {
+	static const unsigned char days[] = {31, 28, 31, 30, 31, 30, 31, 31, 30, 31, 30, 31};
+
+	if ((month == 2) && (year % 4 == 0) && ((year % 100 != 0) || (year % 400 == 0)))
+		return 29;
+
+	return days[month - 1];
+}
+
+/**
+ * Move a day number by a number of months, backwards if months is negative. The day of the month is kept,
+ * limited to the length of the new month, except that the last day of a month moves to the last day of the
+ * new month. That is how boost::gregorian::month_iterator steps.
+ */
+inline int32_t add_months(int32_t days, long months) {
+	unsigned month, day, last;
+	long total;
+	int year;
+
+	civil_from_days(days, &year, &month, &day);
+	last = days_in_month(year, month);
+
+	total = (long)year * 12 + (month - 1) + months;
+	year = (int)((total >= 0 ? total : total - 11) / 12);
+	month = (unsigned)(total - (long)year * 12) + 1;
+
+	if ((day == last) || (day > days_in_month(year, month)))
+		day = days_in_month(year, month);
+
+	return days_from_civil(year, month, day);
+}
+
+/**
+ * Return the day number that a UTC timestamp falls on.
+ */
+inline int32_t days_from_time(int64_t timestamp) {
+	return (int32_t)((timestamp >= 0 ? timestamp : timestamp - SECONDS_PER_DAY + 1) / SECONDS_PER_DAY);
+}
+
+/**
+ * Return the day of the week, 0 (Sunday) to 6 (Saturday). Day 0 was a Thursday.
+ */
+inline int weekday_from_days(int32_t days) {
+	return (int)((days % 7 + 11) % 7);
+}
+
+/**
+ * Return the ISO 8601 week (1-53) that a day falls in. The week belongs to the year of its Thursday, which
+ * is stored in year if it is not null.
+ */
+inline int iso_week_from_days(int32_t days, int *year = nullptr) {
+	int32_t thursday = days - (weekday_from_days(days) + 6) % 7 + 3;
+	unsigned month, day;
+	int iso_year;
+
+	civil_from_days(thursday, &iso_year, &month, &day);
+	if (year != nullptr)
+		*year = iso_year;
+
+	return (thursday - days_from_civil(iso_year, 1, 1)) / 7 + 1;
+}
+
+/**
+ * Write a day number as YYYY-MM-DD. out must hold at least 11 characters.
+ */
+inline void format_civil_date(int32_t days, char *out) {
+	unsigned month, day;
+	int year;
+
+	civil_from_days(days, &year, &month, &day);
+	if ((year < 0) || (year > 9999))
+		year = 0;
+
+	out[0] = '0' + year / 1000;
+	out[1] = '0' + year / 100 % 10;
+	out[2] = '0' + year / 10 % 10;
+	out[3] = '0' + year % 10;
+	out[4] = '-';
+	out[5] = '0' + month / 10;
+	out[6] = '0' + month % 10;
+	out[7] = '-';
+	out[8] = '0' + day / 10;
+	out[9] = '0' + day % 10;
+	out[10] = '\0';
+}
+
+bool parse_civil_date(const char *date, int32_t *days);
+#endif
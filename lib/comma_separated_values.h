@@ -1,7 +1,15 @@
 #include "lib/stock.h"
 
+#ifndef _comma_separated_values_h
+#define _comma_separated_values_h
 class comma_separated_values
 {
 public:
 	struct stock *parse(const char *block, long *rows);
+	long parse(const char *begin, const char *end, stockinfo &data);
+
+private:
+	double parse_double(const char *p, const char *end) const;
+	long parse_long(const char *p, const char *end) const;
 };
+#endif
@@ -23,6 +23,9 @@ config::config(): save_config(true) {
 	sprintf(stock_dir, "%s/data", (char *)config_dir);
 	create_dir(stock_dir);
 
+	store_file = (char *)malloc(strlen(home) + 21);
+	sprintf(store_file, "%s/store.bars", (char *)config_dir);
+
 	return;
 }
 
@@ -33,6 +36,7 @@ config::~config() {
 	free(old_dir);
 	free(list_dir);
 	free(stock_dir);
+	free(store_file);
 
 	for (x = 0; x < tickers.size(); x++)
 		free(tickers[x]);
@@ -55,32 +59,50 @@ void config::create_dir(const char *path)
 	return;
 }
 
-void config::delist(const char *identifier) {
+/**
+ * Move a ticker's files to the old directory, and take it out of the store if one is given.
+ */
+void config::delist(const char *identifier, bar_store *store) {
+	// CSV files are no longer written, but find_tickers() still converts any that are left.
+	const char *extensions[] = {"csv", "bars", "bars.log", "week.bars", "live"};
 	char *filename, *tmp;
 	struct stat buf;
+	size_t x;
 
 	if (!save_config)
 		return;
 
-	filename = get_filename(identifier);
+	for (x = 0; x < sizeof(extensions) / sizeof(extensions[0]); x++) {
+		filename = get_filename(identifier, extensions[x]);
 
-	tmp = (char *)malloc(strlen(old_dir) + strlen(filename) + 6);
-	sprintf(tmp, "%s/%s.csv", (char *)old_dir, filename);
+		tmp = (char *)malloc(strlen(old_dir) + strlen(filename) + 2);
+		sprintf(tmp, "%s/%s", (char *)old_dir, strrchr(filename, '/') + 1);
 
+		BOOST_LOG_TRIVIAL(trace) << "Removing stock data: " << filename;
 
-	BOOST_LOG_TRIVIAL(trace) << "Removing stock data: " << filename;
+		if (stat(filename, &buf) == 0)
+			if (rename(filename, tmp) == -1)
+				fprintf(stderr, "Error moving %s to %s: %s\n", filename, tmp, strerror(errno));
 
-	if (stat(filename, &buf) == 0)
-		if (rename(filename, tmp) == -1)
-			fprintf(stderr, "Error moving %s to %s: %s\n", filename, tmp, strerror(errno));
+		free(filename);
+		free(tmp);
+	}
 
-	free(filename);
-	free(tmp);
+	// find_tickers() lists the store, so the ticker has to leave it too.
+	if ((store != nullptr) && store->is_open() && store->remove(identifier) && !store->save())
+		fprintf(stderr, "Error removing %s from the store\n", identifier);
 
 	return;
 }
 
-char *config::get_filename(const char *identifier) {
+/**
+ * Build the path of a ticker's file in the data directory.
+ *
+ * @param identifier The ticker symbol.
+ * @param extension "csv" for text data, "bars" for binary bar files (default: "csv").
+ * @return The path. The caller must free() it.
+ */
+char *config::get_filename(const char *identifier, const char *extension) {
 	char *tkr, *tmp, *filename;
 
 	tkr = (char *)malloc(strlen(identifier) + 1);
@@ -93,8 +115,9 @@ char *config::get_filename(const char *identifier) {
 	}
 	tmp = NULL;
 
-	filename = (char *)malloc(strlen(stock_dir) + strlen(tkr) + 6);
-	sprintf(filename, "%s/%s.csv", (char *)stock_dir, tkr);
+	filename = (char *)malloc(strlen(stock_dir) + strlen(tkr) + strlen(extension) + 3);
+	sprintf(filename, "%s/%s.%s", (char *)stock_dir, tkr, extension);
+	free(tkr);
 
 	return filename;
 }
@@ -1,5 +1,6 @@
 #include <vector>
 #include "lib/stock.h"
+#include "lib/bar_store.h"
 
 #ifndef _config_h
 #define _config_h
@@ -17,7 +18,7 @@ class config {
         operator const T&() const { return data; }
     };
 
-		proxy<char*> home, stock_dir, old_dir, list_dir, config_dir;
+		proxy<char*> home, stock_dir, old_dir, list_dir, config_dir, store_file;
 		std::vector<char *> tickers;
 		bool save_config;
 
@@ -25,9 +26,9 @@ class config {
 		~config();
 		bool load(const char *identifier, stockinfo &in);
 		bool save(const char *identifier, stockinfo &in);
-		void delist(const char *identifier);
+		void delist(const char *identifier, bar_store *store = nullptr);
 
-		char *get_filename(const char *identifier);
+		char *get_filename(const char *identifier, const char *extension = "csv");
 
 	private:
 		time_t parse_csv_time(const char *date);
@@ -0,0 +1,160 @@
+#include <stddef.h>
+
+#if defined(__x86_64__) || defined(__i386__)
+#include <immintrin.h>
+#define CSV_SCANNER_X86
+#endif
+
+#include "lib/csv_scanner.h"
+
+/**
+ * Delimiter masks for one 64-byte block. Bit n is set if byte n is a delimiter.
+ */
+static uint64_t find_scalar(const char *block)
+{
+	uint64_t ret = 0;
+	int x;
+
+	for (x = 0; x < 64; x++)
+		ret |= (uint64_t)((block[x] == ',') | (block[x] == '\r') | (block[x] == '\n')) << x;
+
+	return ret;
+}
+
+#ifdef CSV_SCANNER_X86
+__attribute__((target("sse2")))
+static uint64_t find_sse2(const char *block)
+{
+	const __m128i comma = _mm_set1_epi8(','), cr = _mm_set1_epi8('\r'), lf = _mm_set1_epi8('\n');
+	uint64_t ret = 0;
+	__m128i chunk;
+	int x;
+
+	for (x = 0; x < 4; x++)
+	{
+		chunk = _mm_loadu_si128((const __m128i *)(block + x * 16));
+		chunk = _mm_or_si128(_mm_or_si128(_mm_cmpeq_epi8(chunk, comma), _mm_cmpeq_epi8(chunk, cr)), _mm_cmpeq_epi8(chunk, lf));
+		ret |= (uint64_t)(uint16_t)_mm_movemask_epi8(chunk) << (x * 16);
+	}
+
+	return ret;
+}
+
+__attribute__((target("avx2")))
+static uint64_t find_avx2(const char *block)
+{
+	const __m256i comma = _mm256_set1_epi8(','), cr = _mm256_set1_epi8('\r'), lf = _mm256_set1_epi8('\n');
+	__m256i lo, hi;
+
+	lo = _mm256_loadu_si256((const __m256i *)block);
+	hi = _mm256_loadu_si256((const __m256i *)(block + 32));
+	lo = _mm256_or_si256(_mm256_or_si256(_mm256_cmpeq_epi8(lo, comma), _mm256_cmpeq_epi8(lo, cr)), _mm256_cmpeq_epi8(lo, lf));
+	hi = _mm256_or_si256(_mm256_or_si256(_mm256_cmpeq_epi8(hi, comma), _mm256_cmpeq_epi8(hi, cr)), _mm256_cmpeq_epi8(hi, lf));
+
+	return (uint64_t)(uint32_t)_mm256_movemask_epi8(lo) | ((uint64_t)(uint32_t)_mm256_movemask_epi8(hi) << 32);
+}
+
+// One load covers the whole block, and the compares give the mask directly.
+__attribute__((target("avx512f,avx512bw")))
+static uint64_t find_avx512(const char *block)
+{
+	const __m512i chunk = _mm512_loadu_si512((const void *)block);
+
+	return _mm512_cmpeq_epi8_mask(chunk, _mm512_set1_epi8(',')) | _mm512_cmpeq_epi8_mask(chunk, _mm512_set1_epi8('\r')) |
+	       _mm512_cmpeq_epi8_mask(chunk, _mm512_set1_epi8('\n'));
+}
+#endif
+
+/**
+ * Prepare to scan [begin, end).
+ *
+ * @param isa The instruction set to use. Falls back to the best supported one if the CPU lacks it.
+ */
+csv_scanner::csv_scanner(const char *begin, const char *end, scanner_isa isa): begin(begin), end(end), block(begin), mask(0)
+{
+	if ((isa == scan_best) || (isa > best_isa()))
+		isa = best_isa();
+
+	switch (isa)
+	{
+#ifdef CSV_SCANNER_X86
+		case scan_avx512:
+			find = find_avx512;
+			break;
+		case scan_avx2:
+			find = find_avx2;
+			break;
+		case scan_sse2:
+			find = find_sse2;
+			break;
+#endif
+		default:
+			find = find_scalar;
+			break;
+	}
+
+	if (begin < end)
+		load(begin);
+}
+
+/**
+ * Return the widest instruction set this CPU supports.
+ */
+scanner_isa csv_scanner::best_isa()
+{
+#ifdef CSV_SCANNER_X86
+	static const scanner_isa best = __builtin_cpu_supports("avx512bw") ? scan_avx512 :
+	                                __builtin_cpu_supports("avx2") ? scan_avx2 :
+	                                __builtin_cpu_supports("sse2") ? scan_sse2 : scan_scalar;
+
+	return best;
+#else
+	return scan_scalar;
+#endif
+}
+
+/**
+ * Find the first delimiter at or after from.
+ *
+ * @return A pointer to the delimiter, or end if there are none left.
+ */
+const char *csv_scanner::next(const char *from)
+{
+	if (from >= end)
+		return end;
+
+	// Jump to the block that holds from, then drop the delimiters before it.
+	if ((from < block) || (from - block >= 64))
+		load(begin + ((from - begin) & ~(ptrdiff_t)63));
+	mask &= ~(uint64_t)0 << (from - block);
+
+	while (mask == 0)
+	{
+		if (end - block <= 64)
+			return end;
+
+		load(block + 64);
+	}
+
+	return block + __builtin_ctzll(mask);
+}
+
+/**
+ * Build the delimiter mask of the block that starts at at. The last, partial block is scanned a byte at a
+ * time so that nothing past end is read.
+ */
+void csv_scanner::load(const char *at)
+{
+	ptrdiff_t x;
+
+	block = at;
+	if (end - block >= 64)
+	{
+		mask = find(block);
+		return;
+	}
+
+	mask = 0;
+	for (x = 0; x < end - block; x++)
+		mask |= (uint64_t)((block[x] == ',') | (block[x] == '\r') | (block[x] == '\n')) << x;
+}
@@ -0,0 +1,31 @@
+#include <stdint.h>
+
+#ifndef _csv_scanner_h
+#define _csv_scanner_h
+// Instruction sets the scanner can use. scan_best picks the widest one the CPU supports.
+enum scanner_isa {scan_best = -1, scan_scalar = 0, scan_sse2 = 1, scan_avx2 = 2, scan_avx512 = 3};
+
+/**
+ * Finds the delimiters (',', '\r' and '\n') in a block of CSV data, 64 bytes at a time. Each block is
+ * turned into a bit mask with vector compares, so finding the end of a field is a count of trailing zeros
+ * instead of a loop over every byte.
+ */
+class csv_scanner
+{
+public:
+	csv_scanner(const char *begin, const char *end, scanner_isa isa = scan_best);
+
+	const char *next(const char *from);
+
+	static scanner_isa best_isa();
+
+private:
+	void load(const char *at);
+
+	uint64_t (*find)(const char *block);
+	const char *begin;
+	const char *end;
+	const char *block;
+	uint64_t mask;
+};
+#endif
@@ -1,4 +1,5 @@
 #include <ctype.h>
+#include <math.h>
 #include <regex>
 #include <algorithm>
 
@@ -8,6 +9,7 @@
 #include "lib/stats/exponential_moving_average.h"
 #include "lib/stats/simple_moving_average.h"
 #include "lib/stats/bollinger.h"
+#include "lib/stats/live_indicators.h"
 #include "lib/rsiscript.h"
 
 /**
@@ -18,10 +20,11 @@
  * 3. Process the math equations/comparisons.
  *
  * @param const char *script [ex: (1+3)/(2 * (4 + 6))]
+ * @param indicators A cache of series from data, to share with the caller's screens.
  * @return const char *result
  */
 int script_max_paren_depth = 50;
-std::string rsiscript::parse(const char* const script, const stockinfo &data) {
+std::string rsiscript::parse(const char* const script, const stockinfo_view &data, const live_indicators *live, indicator_cache *indicators) {
 	std::string err = "0", repl, expr = script;
 	std::size_t pos, lparen_pos, rparen_pos = 0;
 	unsigned int lparens, rparens;
@@ -29,9 +32,17 @@ std::string rsiscript::parse(const char* const script, const stockinfo &data) {
 
 	last_variables_used.clear();
 	last_variables.clear();
+	this->live = live;
+	this->indicators = indicators;
 	if (script == nullptr)
 		return err;
 
+	// Without a cache of the caller's, series are only shared within this script.
+	if (indicators == nullptr) {
+		own_indicators.reset(data);
+		this->indicators = &own_indicators;
+	}
+
 	BOOST_LOG_TRIVIAL(trace) << "Script: " << script;
 	expr = replace_variables(expr, data);
 
@@ -64,7 +75,7 @@ std::string rsiscript::parse(const char* const script, const stockinfo &data) {
 			// ERROR: Mismatched parenthesis.
 			if (rparens != lparens) {
 				BOOST_LOG_TRIVIAL(error) << "Mismatched parenthesis: " << script;
-				printf("ERROR: Mismatched parenthesis: %s\n", script);
+				fprintf(out, "ERROR: Mismatched parenthesis: %s\n", script);
 				return err;
 			}
 
@@ -87,7 +98,7 @@ std::string rsiscript::parse(const char* const script, const stockinfo &data) {
  *
  * @return string
  */
-std::string rsiscript::replace_variables(const std::string &script, const stockinfo &data) {
+std::string rsiscript::replace_variables(const std::string &script, const stockinfo_view &data) {
 	std::string expr = script;
 	std::string err = "0", repl;
 	std::size_t pos, lparen_pos, rparen_pos = 0;
@@ -129,7 +140,7 @@ std::string rsiscript::replace_variables(const std::string &script, const stocki
 			// ERROR: Mismatched parenthesis.
 			if (rparens != lparens) {
 				BOOST_LOG_TRIVIAL(error) << "Mismatched brackets: " << script;
-				printf("ERROR: Mismatched brackets: %s\n", script.c_str());
+				fprintf(out, "ERROR: Mismatched brackets: %s\n", script.c_str());
 				return err;
 			}
 
@@ -161,11 +172,11 @@ std::string rsiscript::replace_variables(const std::string &script, const stocki
  * @param stockinfo data The stock data to use in processing req.
  * @return string The script without any more variables.
  */
-std::string rsiscript::variables(const std::string &req, const stockinfo &data) {
+std::string rsiscript::variables(const std::string &req, const stockinfo_view &data) {
 	std::string ret = "0";
 	std::vector<std::string> tokens;
-	stockinfo *working_data = (stockinfo *)&data;
-	stockinfo week_data;
+	const stockinfo_view *working_data = &data;
+	indicator_cache *cache = indicators;
 
 	tokenize(req, tokens, ":", true);
 	BOOST_LOG_TRIVIAL(trace) << "Variable tokens: " << tokens.size();
@@ -180,14 +191,18 @@ std::string rsiscript::variables(const std::string &req, const stockinfo &data)
 		timeperiods tp;
 		parse_period(period, number, tp);
 
-		week_data = working_data->rollup(number, tp);
-		working_data = &week_data;
+		cache = &indicators->timeframe(number, tp);
+		working_data = &cache->bars();
 	}
 
 	if (!(*working_data).length()) {
 		return ret;
 	}
 
+	// Daily values can come from the live indicators, if they have seen exactly these rows. They start from
+	// the oldest row, like the full-history series below.
+	bool streaming = (live != nullptr) && (working_data == &data) && (data.length() > 26) && live->current(data);
+
 	// Process the requested variable.
 	std::string var = tokens[0];
 	if (var.compare("open") == 0) {
@@ -205,41 +220,31 @@ std::string rsiscript::variables(const std::string &req, const stockinfo &data)
 	else if (var.compare("volume") == 0) {
 		ret = last_variable(req, (*working_data)[0]->volume);
 	}
+	else if ((var.compare("rsi") == 0) && streaming) {
+		ret = last_variable(req, live->rsi.value());
+	}
 	else if (var.compare("rsi") == 0) {
-		relative_strength_index rsi;
-		double *rsi_data = rsi.generate(*working_data, 14, (*working_data).length() - 26);
-		ret = last_variable(req, *rsi_data);
-		free(rsi_data);
+		ret = last_variable(req, *cache->rsi(14, (*working_data).length() - 26));
+	}
+	else if ((var.compare("sma") == 0) && streaming) {
+		ret = last_variable(req, live->sma.value());
 	}
 	else if (var.compare("sma") == 0) {
-		simple_moving_average sma;
-		double *sma_data = sma.generate(*working_data, 20, (*working_data).length() - 26);
-		ret = last_variable(req, *sma_data);
-		free(sma_data);
+		ret = last_variable(req, *cache->sma(20, (*working_data).length() - 26));
 	}
 	else if (var.compare("ema") == 0) {
-		simple_moving_average ema;
-		double *ema_data = ema.generate(*working_data, 20, (*working_data).length() - 26);
-		ret = last_variable(req, *ema_data);
-		free(ema_data);
+		// {ema} has always read the SMA.
+		ret = last_variable(req, *cache->sma(20, (*working_data).length() - 26));
 	}
 	else if (var.compare("bb_top") == 0) {
-		simple_moving_average sma;
-		bollinger bb;
-		double *sma_data = sma.generate(*working_data, 20, (*working_data).length() - 26);
-		double *bb_data = bb.bands(*working_data, 14, (*working_data).length() - 26);
-		ret = last_variable(req, *sma_data + *bb_data);
-		free(sma_data);
-		free(bb_data);
+		const double *sma_data = cache->sma(20, (*working_data).length() - 26);
+		struct bollinger_bands bands = cache->bands(14, (*working_data).length() - 26, 0);
+		ret = last_variable(req, *sma_data + *bands.width);
 	}
 	else if (var.compare("bb_bottom") == 0) {
-		simple_moving_average sma;
-		bollinger bb;
-		double *sma_data = sma.generate(*working_data, 20, (*working_data).length() - 26);
-		double *bb_data = bb.bands(*working_data, 14, (*working_data).length() - 26);
-		ret = last_variable(req, *sma_data - *bb_data);
-		free(sma_data);
-		free(bb_data);
+		const double *sma_data = cache->sma(20, (*working_data).length() - 26);
+		struct bollinger_bands bands = cache->bands(14, (*working_data).length() - 26, 0);
+		ret = last_variable(req, *sma_data - *bands.width);
 	}
 
 	return ret;
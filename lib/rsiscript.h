@@ -1,21 +1,26 @@
+#include <stdio.h>
 #include <vector>
 #include <string>
 #include "lib/stock.h"
+#include "lib/stats/indicator_cache.h"
 
 #ifndef _rsiscript_h
 #define _rsiscript_h
+class live_indicators;
+
 class rsiscript {
 public:
 	// Public interfaces.
-	std::string parse(const char* const script, const stockinfo &data);
+	std::string parse(const char* const script, const stockinfo_view &data, const live_indicators *live = nullptr, indicator_cache *indicators = nullptr);
 	std::string last_variables;
+	FILE *out = stdout; // Where script errors are printed.
 
 	void parse_period(const std::string req, int &number, timeperiods &period);
 
 private:
 	// Standard class functions.
-	std::string replace_variables(const std::string &script, const stockinfo &data);
-	std::string variables(const std::string &req, const stockinfo &data);
+	std::string replace_variables(const std::string &script, const stockinfo_view &data);
+	std::string variables(const std::string &req, const stockinfo_view &data);
 	std::string exec_script_operations(const std::string &script, const char *operators);
 	const std::string exec_script_calculate(const std::string &script);
 
@@ -32,5 +37,8 @@ private:
 
 	// Variables.
 	std::vector<std::string> last_variables_used;
+	const live_indicators *live = nullptr;
+	indicator_cache *indicators = nullptr;
+	indicator_cache own_indicators;
 };
 #endif
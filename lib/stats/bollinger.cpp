@@ -1,39 +1,84 @@
-#include <math.h>
 #include <stdlib.h>
+#include <string.h>
 #include "lib/stats/bollinger.h"
-#include "lib/stats/simple_moving_average.h"
+#include "lib/stats/simd.h"
 
-double *bollinger::bands(const stockinfo &data, int period, int deviations, long count)
+/**
+ * Allocate and fill in the Bollinger bands. See fill().
+ *
+ * @return The bands. Free them with release().
+ */
+struct bollinger_bands bollinger::generate(const stockinfo_view &data, int period, int deviations, long count)
 {
-	simple_moving_average sma;
-	double sum, *sma_data, *ret;
-	int row, y, start;
-	long rows = data.length();
+	return fill(data, period, deviations, count, (double *)malloc(sizeof(double) * BOLLINGER_SERIES * series_size(count)));
+}
+
+/**
+ * Make the Bollinger bands in one pass over the closes.
+ *
+ * The middle is the same running SMA as simple_moving_average::generate(). The variance comes from rolling
+ * sums of each close's distance from a shift, which is moved to the current middle (and the sums rebuilt)
+ * once per period. That keeps the sums small, so there is no cancellation, and the whole pass O(rows).
+ *
+ * @param data The rows.
+ * @param period The length of the window. Default: 20.
+ * @param deviations How many standard deviations the bands are from the middle. Default: 2.
+ * @param count The number of rows to make bands for, counting from the newest.
+ * @param out Room for BOLLINGER_SERIES * series_size(count) values, which the bands are written into.
+ * @return The bands, inside out.
+ */
+struct bollinger_bands bollinger::fill(const stockinfo_view &data, int period, int deviations, long count, double *out)
+{
+	struct bollinger_bands ret;
+	long row, start, rows = data.length(), size = series_size(count);
+
+	memset(out, 0, sizeof(double) * BOLLINGER_SERIES * size);
+	ret.upper = out;
+	ret.middle = out + size;
+	ret.lower = out + 2 * size;
+	ret.width = out + 3 * size;
+	ret.bandwidth = out + 4 * size;
+	ret.valid = 0;
 
 	if ((count <= 0) || (rows <= period + 1))
-	{
-		ret = (double *)malloc(sizeof(double));
-		ret[0] = 0;
 		return ret;
-	}
 
-	ret = (double *)malloc(sizeof(double) * (count + 1));
-	ret[count] = 0;
+	start = (period + count < rows) ? period + count : rows;
+	simd().deviation(data.closes(), start, period, deviations, ret.middle, ret.width);
 
-	start = (period + count < rows) ? count : rows - period;
-	sma_data = sma.generate(data, period, count);
-
-	for (row = start - 1; row >= 0; row--)
+	for (row = start - period - 1; row >= 0; row--)
 	{
-		sum = 0;
-		for (y = row; y < row + period; y++)
-			sum += pow(data[y]->close - sma_data[row], 2);
+		ret.upper[row] = ret.middle[row] + ret.width[row];
+		ret.lower[row] = ret.middle[row] - ret.width[row];
+		ret.bandwidth[row] = (ret.middle[row] != 0) ? (ret.upper[row] - ret.lower[row]) / ret.middle[row] : 0;
+	}
 
-		ret[row] = sqrt(sum / period) * deviations;
+	ret.valid = start - period;
+	return ret;
+}
 
-	}
+/**
+ * Free every series of bands from generate().
+ */
+void bollinger::release(struct bollinger_bands &bands)
+{
+	free(bands.upper);
+	memset(&bands, 0, sizeof(bands));
+}
+
+/**
+ * The distance from the middle of the bands to either band. See generate().
+ *
+ * @return count + 1 values. The caller must free() them.
+ */
+double *bollinger::bands(const stockinfo_view &data, int period, int deviations, long count)
+{
+	struct bollinger_bands all = generate(data, period, deviations, count);
+	double *ret;
 
-	free(sma_data);
+	ret = (double *)malloc(sizeof(double) * series_size(count));
+	memcpy(ret, all.width, sizeof(double) * series_size(count));
+	release(all);
 
 	return ret;
 }
@@ -1,7 +1,29 @@
 #include "lib/stock.h"
+#include "lib/stats/series.h"
+
+#ifndef _bollinger_h
+#define _bollinger_h
+#define BOLLINGER_SERIES 5
+
+/**
+ * Every series that bollinger::fill() makes in its one pass. Each has series_size(count) values, like the
+ * other generators, and they share one block.
+ */
+struct bollinger_bands {
+	long valid; // The number of values, from index 0, that have a full period behind them.
+	double *upper;
+	double *middle; // The SMA, the same as simple_moving_average::generate() gives.
+	double *lower;
+	double *width; // From the middle to either band: deviations times the standard deviation.
+	double *bandwidth; // (upper - lower) / middle.
+};
 
 class bollinger
 {
 	public:
-		double *bands(const stockinfo &data, int period = 20, int deviations = 2, long count = 0);
+		struct bollinger_bands generate(const stockinfo_view &data, int period = 20, int deviations = 2, long count = 0);
+		struct bollinger_bands fill(const stockinfo_view &data, int period, int deviations, long count, double *out);
+		void release(struct bollinger_bands &bands);
+		double *bands(const stockinfo_view &data, int period = 20, int deviations = 2, long count = 0);
 };
+#endif
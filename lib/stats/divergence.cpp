@@ -0,0 +1,182 @@
+#include <string.h>
+#include "lib/stats/divergence.h"
+
+/**
+ * Trend: Determine whether the current value (values[0]) is a Higher High, Lower High, Higher Low, or Lower Low.
+ *
+ * @param values The values to check against each other.
+ * @param rows The number of values we have.
+ * @param reset_high How far back do we go before we stop checking for additional highs?
+ * @param reset_low How far back do we go before we stop checking for additional lows?
+ * @param pos - NULL => Ignored. 0 => Return location we found. +/- => Try to find a divergence near pos.
+ */
+int divergence(const double *values, long rows, long reset_high, long reset_low, long *pos)
+{
+	int ret = IGNORED;
+	bool matches_direction;
+	long x, start, stop, found = 0;
+
+	if ((rows < 3) || (rows <= reset_high) || (rows <= reset_low))
+		return ret;
+
+	// Find highs.
+	if ((reset_low > 0) && (values[0] > values[1]) && (values[0] > values[2]))
+	{
+		ret = HIGHERHIGH;
+		start = (pos && *pos) ? *pos - 1 : 2;
+		stop = (pos && *pos) ? *pos + 2 : reset_low;
+		for (x = start; x < stop; x++)
+		{
+			matches_direction = true; //((values[0] < 0) && (values[x] < 0)) || ((values[0] > 0) && (values[x] > 0));
+			if (values[x] > values[found] && matches_direction)
+			{
+				ret = LOWERHIGH;
+				found = x;
+				break;
+			}
+		}
+	}
+
+	// Find lows.
+	else if ((reset_high > 0) && (values[0] < values[1]) && (values[0] < values[2]))
+	{
+		ret = LOWERLOW;
+		start = (pos && *pos) ? *pos - 1 : 2;
+		stop = (pos && *pos) ? *pos + 2 : reset_high;
+		for (x = start; x < stop; x++)
+		{
+			matches_direction = true; //((values[0] < 0) && (values[x] < 0)) || ((values[0] > 0) && (values[x] > 0));
+			if ((values[x] < values[found]) && matches_direction)
+			{
+				ret = HIGHERLOW;
+				found = x;
+				break;
+			}
+		}
+	}
+
+	if (pos)
+		*pos = found;
+
+	return ret;
+}
+
+/**
+ * Try to find triple divergences, as defined by Chris Verheigh (The Option Trainer).
+ *
+ * TODO: Generate a list of highs/lows from BB resets, then compare their placement to each other. The
+ * code currently finds "divergences" of different indicators at different locations - which means they
+ * aren't really divergences.
+ *
+ * TODO: We need a strength indicator.
+ *
+ * @param desc What the bars are, like "potential weekly".
+ * @param out Where to print what is found.
+ * @param verbose Also print what was checked when nothing is found.
+ * @return Whether the bars end in a triple divergence.
+ */
+bool diverge(const char *ticker, indicator_cache &indicators, const char *desc, FILE *out, bool verbose)
+{
+	const char *debug_modes[] = {"IGNORED", "HIGHER HIGH", "LOWER HIGH", "HIGHER LOW", "LOWER LOW"};
+	const stockinfo_view &data = indicators.bars();
+	struct bollinger_bands bands;
+	bool is_uptrend, is_diverging = false;
+	const double *stock_close = data.closes();
+	const double /* *sma_weekly = NULL,*/ *sma_data = NULL, *rsi_data = NULL, *macd_data = NULL, *macd_h = NULL;
+	long trend_change = 0, reset_h = 0, reset_l = 0, found_divergence = 0, x;
+	int d_stock, d_rsi, d_macd, d_macd_h;
+	long rows = data.length();
+
+	// Every series below has rows - 26 values, and divergence() needs three of them.
+	if (rows - 26 < 3)
+		return false;
+
+	//sma_weekly = sma.generate(data, 5, rows - 11);
+	bands = indicators.bands(20, 2, rows - 26);
+	sma_data = bands.middle;
+
+	// Find the current "trend" - "up" or "down."
+	x = 0;
+	do
+	{
+		x++;
+		is_uptrend = (sma_data[x] > sma_data[x-1]);
+	} while ((sma_data[x] == sma_data[x-1]) && (x < rows - 27));
+
+	for (; x < rows - 26; x++)
+	{
+		// If the SMA trend direction changed.
+		if (is_uptrend ? (sma_data[x - 1] > sma_data[x]) : (sma_data[x] > sma_data[x - 1]))
+		{
+			trend_change = x;
+			break;
+		}
+	}
+
+	// We can use shorter values, but 1-3 are almost useless.
+	if (trend_change > 5)
+		trend_change = 5;
+
+	// Prices outside the Bollinger Bands reset are reset points for our "high" and "low" patterns. I think CV said to do this sometime.
+	for (x = trend_change; x < rows - 26; x++)
+	{
+		if ((reset_h == 0) && (data[x]->close > bands.upper[x]))
+			reset_h = x;
+
+		if ((reset_l == 0) && (data[x]->close < bands.lower[x]))
+			reset_l = x;
+
+		if ((reset_h > 0) && (reset_l > 0))
+			break;
+	}
+
+	// stock trend
+	d_stock = divergence(stock_close, rows - 26, reset_h, reset_l, NULL);
+
+	// rsi trend
+	d_rsi = IGNORED;
+	if ((d_stock == HIGHERHIGH) || (d_stock == LOWERLOW))
+	{
+		rsi_data = indicators.rsi(14, rows - 26);
+		d_rsi = divergence(rsi_data, data.length() - 26, reset_h, reset_l, &found_divergence);
+	}
+
+	// MACD trend
+	d_macd = IGNORED;
+	if (d_rsi && found_divergence)
+	{
+		macd_data = indicators.macd(12, 26, rows - 26);
+		d_macd = divergence(macd_data, rows - 26, reset_h, reset_l, &found_divergence);
+	}
+
+	// MACD histogram trend
+	d_macd_h = IGNORED;
+	if (d_macd)
+	{
+		macd_h = indicators.histogram(12, 26, 9, rows - 26);
+		if (((d_stock == HIGHERHIGH) && (macd_h[0] > 0)) || ((d_stock == LOWERLOW) && (macd_h[0] < 0)))
+			d_macd_h = divergence(macd_h, rows - 26, reset_h, reset_l, &found_divergence);
+	}
+
+	// Look for the divergence.
+	if (d_macd_h)
+	{
+		if (((d_stock == HIGHERHIGH) && (d_rsi == LOWERHIGH) && (d_macd == LOWERHIGH) && (d_macd_h == LOWERHIGH)) ||
+	    	    ((d_stock == LOWERLOW) && (d_rsi == HIGHERLOW) && (d_macd == HIGHERLOW) && (d_macd_h == HIGHERLOW)))
+		{
+			fprintf(out, "%s, %s is in \033[%im%s\033[0m triple divergence\n", data[0]->date, ticker, (strncmp(desc, "potential", 6) == 0) ? 31 : 32, desc);
+			fprintf(out, "    \033[%im%s\033[0m; Distance: %li, %s; %.02f, %.02f; RSI: %.02f, %.02f, %s; MACD: %.02f, %.02f, %s; MACD histogram: %.02f, %.02f, %s; high reset: %li/%s, low reset: %li/%s; Volume: %li!\n\n", (d_stock == HIGHERHIGH) ? 31 : 32, debug_modes[d_stock], found_divergence, data[found_divergence]->date, stock_close[found_divergence], *stock_close,
+					rsi_data[found_divergence], *rsi_data, debug_modes[d_rsi],
+					macd_data[found_divergence], *macd_data, debug_modes[d_macd],
+					macd_h[found_divergence], *macd_h, debug_modes[d_macd_h],
+					reset_h, data[reset_h]->date, reset_l, data[reset_l]->date, data[0]->volume);
+			is_diverging = true;
+		}
+		else if (verbose)
+			fprintf(out, "%s, Stock: %s/%s, RSI: %s, MACD: %s, Histogram: %s\n", data[0]->date, ticker, debug_modes[d_stock], debug_modes[d_rsi], debug_modes[d_macd], debug_modes[d_macd_h]);
+	}
+	else if (verbose)
+		fprintf(out, "%s, Stock: %s/%s, RSI: %s, MACD: %s, Histogram: %s\n", data[0]->date, ticker, debug_modes[d_stock], debug_modes[d_rsi], debug_modes[d_macd], debug_modes[d_macd_h]);
+
+	return is_diverging;
+}
@@ -0,0 +1,15 @@
+#include <stdio.h>
+#include "lib/stats/indicator_cache.h"
+
+#ifndef _divergence_h
+#define _divergence_h
+// What divergence() finds at the newest value.
+#define IGNORED 0
+#define HIGHERHIGH 1
+#define LOWERHIGH 2
+#define HIGHERLOW 3
+#define LOWERLOW 4
+
+int divergence(const double *values, long rows, long reset_high, long reset_low, long *pos = NULL);
+bool diverge(const char *ticker, indicator_cache &indicators, const char *desc, FILE *out, bool verbose);
+#endif
@@ -1,67 +1,134 @@
 #include <stdlib.h>
+#include <string.h>
 #include "lib/stats/exponential_moving_average.h"
+#include "lib/stats/simd.h"
+#include "lib/stats/stream.h"
+
+exponential_moving_average::exponential_moving_average(int period)
+{
+	state.period = (period > 0) ? period : 20;
+	reset();
+}
 
 /* Loop through data and create a exponential moving average */
-double *exponential_moving_average::generate(const stockinfo &data, int period, long count)
+double *exponential_moving_average::generate(const stockinfo_view &data, int period, long count)
+{
+	double *ret = (double *)malloc(sizeof(double) * series_size(count));
+
+	fill(data, period, count, ret);
+
+	return ret;
+}
+
+/**
+ * Write the EMA of the newest count rows into out, which holds series_size(count) values. The average starts
+ * from the close period rows before the oldest of them.
+ *
+ * @return The number of values, from out[0], that have a full period behind them. The rest are 0.
+ */
+long exponential_moving_average::fill(const stockinfo_view &data, int period, long count, double *out)
 {
-	double alpha, ema, *ret;
-	int row, start;
+	long start;
 	long rows = data.length();
 
+	memset(out, 0, sizeof(double) * series_size(count));
 	if ((count <= 0) || (rows <= period + 1))
-	{
-		ret = (double *)malloc(sizeof(double));
-		ret[0] = 0;
-		return ret;
-	}
-
-	ret = (double *)malloc(sizeof(double) * (count + 1));
-	ret[count] = 0;
+		return 0;
 
-	alpha = 2.0 / (period + 1);
 	start = (period + count < rows) ? period + count : rows - 1;
+	simd().smooth(data.closes(), start, 2.0 / (period + 1), start - period, out);
 
-	ema = data[start]->close;
-	for (row = start - 1; row >= 0; row--)
-	{
-		ema = alpha * data[row]->close + (1 - alpha) * ema;
-		if (row < start - period)
-			ret[row] = ema;
+	return start - period;
+}
+
+/* Loop through data and create a exponential moving average */
+double *exponential_moving_average::generate_d(const double *data, long rows, int period, long count)
+{
+	double *ret = (double *)malloc(sizeof(double) * series_size(count));
 
-	}
+	fill_d(data, rows, period, count, ret);
 
 	return ret;
 }
 
-/* Loop through data and create a exponential moving average */
-double *exponential_moving_average::generate_d(const double *data, long rows, int period, long count)
+/**
+ * Write the EMA of the newest count values of data into out, which holds series_size(count) values. Unlike
+ * fill(), the average can start from data[rows], so data needs rows + 1 values.
+ *
+ * @return The number of values, from out[0], that have a full period behind them. The rest are 0.
+ */
+long exponential_moving_average::fill_d(const double *data, long rows, int period, long count, double *out)
 {
-	double alpha, ema, *ret;
-	int row, start;
+	long start;
 
+	memset(out, 0, sizeof(double) * series_size(count));
 	if ((count <= 0) || (rows <= period + 1))
-	{
-		ret = (double *)malloc(sizeof(double));
-		ret[0] = 0;
-		return ret;
-	}
+		return 0;
 
-	ret = (double *)malloc(sizeof(double) * (count + 1));
-	ret[count] = 0;
+	start = (period + count < rows) ? period + count : rows;
+	simd().smooth(data, start, 2.0 / (period + 1), start - period, out);
 
-	for (row = 0; row <= count; row++)
-		ret[row] = 0;
+	return start - period;
+}
 
-	alpha = 2.0 / (period + 1);
-	start = (period + count < rows) ? period + count : rows;
+/**
+ * Forget every bar, but keep the period.
+ */
+void exponential_moving_average::reset()
+{
+	int period = state.period;
 
-	ema = data[start];
-	for (row = start - 1; row >= 0; row--)
-	{
-		ema = alpha * data[row] + (1 - alpha) * ema;
-		if (row < start - period)
-			ret[row] = ema;
-	}
+	memset(&state, 0, sizeof(state));
+	state.period = period;
+}
 
-	return ret;
+/**
+ * Add the next bar. The average starts at the first close, so feeding every row of data in, oldest first,
+ * gives the same EMA as generate() does when it starts from the oldest row.
+ *
+ * @param close The close of the new bar.
+ * @param day The day of the new bar, for advance().
+ * @return The EMA as of the new bar. See value().
+ */
+double exponential_moving_average::update(double close, int32_t day)
+{
+	double alpha = 2.0 / (state.period + 1);
+
+	if (state.bars++ == 0)
+		state.ema = close;
+	else
+		state.ema = alpha * close + (1 - alpha) * state.ema;
+
+	state.close = close;
+	state.day = day;
+
+	return value();
+}
+
+/**
+ * Feed in the rows of data after the last bar. See stream_advance().
+ */
+long exponential_moving_average::advance(const stockinfo_view &data, int32_t since)
+{
+	return stream_advance(*this, data, since);
+}
+
+/**
+ * @return The EMA as of the last bar. 0 until there are more than period + 1 bars, like generate().
+ */
+double exponential_moving_average::value() const
+{
+	return (state.bars > state.period + 1) ? state.ema : 0;
+}
+
+/**
+ * Carry on from a snapshot() of an EMA with the same period.
+ */
+bool exponential_moving_average::restore(const exponential_moving_average_state &saved)
+{
+	if ((saved.period != state.period) || (saved.bars < 0))
+		return false;
+
+	state = saved;
+	return true;
 }
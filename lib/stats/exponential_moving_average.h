@@ -1,8 +1,35 @@
 #include "lib/stock.h"
+#include "lib/stats/series.h"
+
+#ifndef _exponential_moving_average_h
+#define _exponential_moving_average_h
+// Everything a streaming EMA needs to carry on from its last bar.
+struct exponential_moving_average_state {
+	int32_t period;
+	int32_t day;
+	int64_t bars;
+	double close;
+	double ema;
+};
 
 class exponential_moving_average
 {
 	public:
-		double *generate(const stockinfo &data, int period, long count);
+		exponential_moving_average(int period = 20);
+		double *generate(const stockinfo_view &data, int period, long count);
 		double *generate_d(const double *data, long rows, int period, long count);
+		long fill(const stockinfo_view &data, int period, long count, double *out);
+		long fill_d(const double *data, long rows, int period, long count, double *out);
+
+		// Streaming, one bar at a time, oldest first.
+		void reset();
+		double update(double close, int32_t day = 0);
+		long advance(const stockinfo_view &data, int32_t since = INT32_MAX);
+		double value() const;
+		const exponential_moving_average_state &snapshot() const { return state; }
+		bool restore(const exponential_moving_average_state &saved);
+
+	private:
+		exponential_moving_average_state state;
 };
+#endif
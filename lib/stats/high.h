@@ -1,7 +1,13 @@
 #include "lib/stock.h"
+#include "lib/stats/series.h"
 
 class high
 {
 	public:
-		double find(const stockinfo &data, int days = 251);
+		double find(const stockinfo_view &data, int days = 251);
+
+		// The highest of every window of days rows, and how far back it is. See rolling_extreme().
+		double *generate(const stockinfo_view &data, price_field field, int days, long count);
+		long fill(const stockinfo_view &data, price_field field, int days, long count, double *out, long *offsets = nullptr);
+		long fill_d(const double *values, long rows, int days, long count, double *out, long *offsets = nullptr);
 };
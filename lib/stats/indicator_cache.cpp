@@ -0,0 +1,261 @@
+#include <algorithm>
+#include "lib/stats/indicator_cache.h"
+#include "lib/stats/relative_strength_index.h"
+#include "lib/stats/exponential_moving_average.h"
+#include "lib/stats/simple_moving_average.h"
+#include "lib/stats/moving_average_convergence_divergence.h"
+
+/**
+ * Forget every series, and work out new ones from data. The buffers are kept for the new series.
+ */
+void indicator_cache::reset(const stockinfo_view &data)
+{
+	long length;
+
+	view = data;
+	misses = 0;
+
+	// The bars of a walk are the history with its newest rows dropped, so they share its columns.
+	dropped = -1;
+	if (history)
+	{
+		length = history->view.length();
+		if ((view.length() > 0) && (view.length() <= length) && (view.closes() == history->view.closes() + length - view.length()) &&
+				(view.days() == history->view.days() + length - view.length()))
+			dropped = length - view.length();
+	}
+
+	for (auto &s : series)
+		spare.push_back(std::move(s.second.values));
+	series.clear();
+	for (auto &r : rollups)
+		r.second.current = false;
+}
+
+/**
+ * Start a walk-back over history, with history as the bars. See the class comment. The series of the history are
+ * worked out as they are first asked for, and kept until the next walk().
+ */
+void indicator_cache::walk(const stockinfo_view &history)
+{
+	if (!this->history)
+		this->history.reset(new indicator_cache());
+
+	this->history->reset(history);
+	reset(history);
+}
+
+/**
+ * Whether a series of count rows of the bars can come from the history's. Only series that start from the oldest
+ * row do, as the rest start from a row that moves with the bars.
+ *
+ * @param count No more than the rows of the bars. See clamp().
+ * @param reach How far back the series starts, at most: count plus the rows that it starts before the oldest value.
+ * @param least The fewest rows that the indicator gives values for.
+ */
+bool indicator_cache::from_history(long count, long reach, long least) const
+{
+	long rows = view.length();
+
+	return (dropped >= 0) && (reach >= rows) && (rows > least) && (dropped + count <= history->view.length());
+}
+
+/**
+ * Clamp count to the rows of the bars. A series has no values past them, so longer ones would only add zeroes.
+ */
+long indicator_cache::clamp(long count) const
+{
+	return std::min(count, view.length());
+}
+
+/**
+ * The cache of a roll-up of the bars. See stockinfo_view::rollup() and stockinfo_view::calendar().
+ *
+ * @param align align_calendar ignores number, since calendar bars are one period each.
+ */
+indicator_cache &indicator_cache::timeframe(int number, timeperiods period, rollup_alignment align)
+{
+	rolled &r = rollups[std::make_tuple((align == align_calendar) ? 1 : number, (int)period, (int)align)];
+
+	if (!r.cache)
+		r.cache.reset(new indicator_cache());
+
+	if (!r.current)
+	{
+		if (align == align_calendar)
+			r.cache->reset(view.calendar(period));
+		else
+			r.cache->reset(view.rollup(number, period, align == align_sunday));
+		r.current = true;
+	}
+
+	return *r.cache;
+}
+
+/**
+ * Look up a series, making room for it if it has not been worked out since the last reset().
+ *
+ * @param found Set if the series is already there.
+ */
+indicator_cache::entry &indicator_cache::find(int kind, int a, int b, int c, long count, bool &found)
+{
+	entry &ret = series[std::make_tuple(kind, a, b, c, count)];
+
+	found = (ret.values != nullptr);
+	if (!found)
+	{
+		if (spare.empty())
+			ret.values.reset(new series_buffer());
+		else
+		{
+			ret.values = std::move(spare.back());
+			spare.pop_back();
+		}
+		misses++;
+	}
+
+	return ret;
+}
+
+/**
+ * See simple_moving_average::fill().
+ */
+const double *indicator_cache::sma(int period, long count)
+{
+	simple_moving_average sma;
+	bool found;
+
+	count = clamp(count);
+	if (from_history(count, period + count, period + 1))
+		return history->sma(period, history->view.length()) + dropped;
+
+	entry &e = find(indicator_sma, period, 0, 0, count, found);
+
+	if (!found)
+		e.valid = sma.fill(view, period, count, e.values->reserve(series_size(count)));
+
+	return e.values->data();
+}
+
+/**
+ * See exponential_moving_average::fill().
+ */
+const double *indicator_cache::ema(int period, long count)
+{
+	exponential_moving_average ema;
+	bool found;
+
+	count = clamp(count);
+	if (from_history(count, period + count, period + 1))
+		return history->ema(period, history->view.length()) + dropped;
+
+	entry &e = find(indicator_ema, period, 0, 0, count, found);
+
+	if (!found)
+		e.valid = ema.fill(view, period, count, e.values->reserve(series_size(count)));
+
+	return e.values->data();
+}
+
+/**
+ * See relative_strength_index::fill().
+ */
+const double *indicator_cache::rsi(int period, long count)
+{
+	relative_strength_index rsi;
+	bool found;
+
+	count = clamp(count);
+	if (from_history(count, count + 1, period + 1))
+		return history->rsi(period, history->view.length()) + dropped;
+
+	entry &e = find(indicator_rsi, period, 0, 0, count, found);
+
+	if (!found)
+		e.valid = rsi.fill(view, period, count, e.values->reserve(series_size(count)));
+
+	return e.values->data();
+}
+
+/**
+ * See moving_average_convergence_divergence::fill().
+ */
+const double *indicator_cache::macd(int fast, int slow, long count)
+{
+	count = clamp(count);
+	if (from_history(count, std::min(fast, slow) + count, slow + 1))
+		return history->macd(fast, slow, history->view.length()) + dropped;
+
+	return macd_line(fast, slow, count).values->data();
+}
+
+/**
+ * See moving_average_convergence_divergence::fill_histogram(). The MACD line under it, with count + avg rows,
+ * is cached too.
+ */
+const double *indicator_cache::histogram(int fast, int slow, int avg, long count)
+{
+	moving_average_convergence_divergence macd;
+	bool found;
+
+	count = clamp(count);
+
+	// The signal line starts where the MACD line does if count reaches it, and from 0 before that.
+	if (from_history(count, std::min(std::min(fast, slow) + avg + count, slow + count), slow + 1))
+		return history->histogram(fast, slow, avg, history->view.length()) + dropped;
+
+	entry &e = find(indicator_histogram, fast, slow, avg, count, found);
+
+	if (!found)
+	{
+		entry &line = macd_line(fast, slow, count + avg);
+		e.valid = macd.fill_histogram(line.values->data(), line.valid, avg, count, e.values->reserve(series_size(count)));
+	}
+
+	return e.values->data();
+}
+
+/**
+ * The cached MACD line, worked out if need be.
+ */
+indicator_cache::entry &indicator_cache::macd_line(int fast, int slow, long count)
+{
+	moving_average_convergence_divergence macd;
+	bool found;
+	entry &e = find(indicator_macd, fast, slow, 0, count, found);
+
+	if (!found)
+		e.valid = macd.fill(view, fast, slow, count, e.values->reserve(series_size(count)));
+
+	return e;
+}
+
+/**
+ * See bollinger::fill().
+ */
+struct bollinger_bands indicator_cache::bands(int period, int deviations, long count)
+{
+	struct bollinger_bands ret;
+	bollinger bb;
+	bool found;
+
+	count = clamp(count);
+	if (from_history(count, period + count, period + 1))
+	{
+		ret = history->bands(period, deviations, history->view.length());
+		ret.upper += dropped;
+		ret.middle += dropped;
+		ret.lower += dropped;
+		ret.width += dropped;
+		ret.bandwidth += dropped;
+		ret.valid -= dropped;
+		return ret;
+	}
+
+	entry &e = find(indicator_bands, period, deviations, 0, count, found);
+
+	if (!found)
+		e.bands = bb.fill(view, period, deviations, count, e.values->reserve(BOLLINGER_SERIES * series_size(count)));
+
+	return e.bands;
+}
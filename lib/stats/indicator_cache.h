@@ -0,0 +1,76 @@
+#include <map>
+#include <tuple>
+#include <vector>
+#include <memory>
+#include "lib/stock.h"
+#include "lib/stats/series.h"
+#include "lib/stats/bollinger.h"
+
+#ifndef _indicator_cache_h
+#define _indicator_cache_h
+enum indicator_kind {indicator_sma = 0, indicator_ema = 1, indicator_rsi = 2, indicator_macd = 3, indicator_histogram = 4, indicator_bands = 5};
+
+/**
+ * The indicator series of one ticker, each worked out the first time a screen or rsiscript asks for it, so that
+ * everything that scans the ticker shares one copy. Series are keyed by indicator, parameters and count, and
+ * counts past the rows of the bars are cut to them. Every indicator reads the close. Roll-ups of the bars have
+ * caches of their own, from timeframe().
+ *
+ * Series stay valid until the next reset(). Their buffers are kept for the series after it, so a cache that is
+ * reset from ticker to ticker, or from day to day of a walk-back, stops allocating once it has seen the longest.
+ *
+ * A walk-back hands the whole history to walk() first, which makes it the bars. Every reset() to the history less
+ * some of its newest rows then takes the series that would start from the oldest row anyway (those asked for with a
+ * count that reaches it) from the history's own series, a few rows in, rather than working them out again. Each of
+ * those series is worked out once per history, so a walk costs O(rows) for it rather than O(rows) a day.
+ */
+class indicator_cache
+{
+	public:
+		indicator_cache(): misses(0), dropped(-1) {};
+		indicator_cache(const indicator_cache &) = delete;
+		indicator_cache &operator =(const indicator_cache &) = delete;
+
+		void reset(const stockinfo_view &data);
+		void walk(const stockinfo_view &history);
+		const stockinfo_view &bars() const { return view; }
+		indicator_cache &timeframe(int number, timeperiods period, rollup_alignment align = align_latest);
+
+		const double *sma(int period, long count);
+		const double *ema(int period, long count);
+		const double *rsi(int period, long count);
+		const double *macd(int fast, int slow, long count);
+		const double *histogram(int fast, int slow, int avg, long count);
+		struct bollinger_bands bands(int period, int deviations, long count);
+
+		// The number of series worked out since the last reset(), not counting those of timeframe().
+		long computed() const { return misses; }
+
+	private:
+		struct entry {
+			long valid = 0;
+			struct bollinger_bands bands = {};
+			std::unique_ptr<series_buffer> values;
+		};
+
+		struct rolled {
+			bool current = false;
+			std::unique_ptr<indicator_cache> cache;
+		};
+
+		entry &find(int kind, int a, int b, int c, long count, bool &found);
+		entry &macd_line(int fast, int slow, long count);
+		bool from_history(long count, long reach, long least) const;
+		long clamp(long count) const;
+
+		stockinfo_view view;
+		std::map<std::tuple<int, int, int, int, long>, entry> series;
+		std::vector<std::unique_ptr<series_buffer>> spare;
+		std::map<std::tuple<int, int, int>, rolled> rollups;
+		long misses;
+
+		// The cache of the history from walk(), and how many of its newest rows the bars drop, or -1.
+		std::unique_ptr<indicator_cache> history;
+		long dropped;
+};
+#endif
@@ -0,0 +1,137 @@
+#include <stdio.h>
+#include <string.h>
+#include <errno.h>
+#include <algorithm>
+#include <boost/log/trivial.hpp>
+#include "lib/stats/live_indicators.h"
+
+/**
+ * Forget every bar.
+ */
+void live_indicators::reset()
+{
+	rsi.reset();
+	sma.reset();
+}
+
+/**
+ * Feed every indicator the rows of data after the last bar it saw. See stream_advance().
+ *
+ * @return The most bars fed to any one indicator.
+ */
+long live_indicators::advance(const stockinfo_view &data, int32_t since)
+{
+	long ret = 0;
+
+	ret = std::max(ret, rsi.advance(data, since));
+	ret = std::max(ret, sma.advance(data, since));
+
+	return ret;
+}
+
+/**
+ * Check that every indicator has seen all of data, and nothing else, so their values are data's latest.
+ */
+bool live_indicators::current(const stockinfo_view &data) const
+{
+	long rows = data.length();
+
+	if (rows == 0)
+		return false;
+
+	return (rsi.snapshot().bars == rows) && (rsi.snapshot().day == data.days()[0]) &&
+	       (sma.snapshot().bars == rows) && (sma.snapshot().day == data.days()[0]);
+}
+
+/**
+ * Read saved state. Indicators that are missing, or have other periods, start over.
+ *
+ * @return boolean. False if the file could not be read.
+ */
+bool live_indicators::load(const char *filename)
+{
+	struct live_indicators_file saved;
+	FILE *rd;
+	bool ret;
+
+	reset();
+
+	if ((rd = fopen(filename, "rb")) == NULL)
+	{
+		BOOST_LOG_TRIVIAL(trace) << "Unable to load indicator state: " << filename;
+		return false;
+	}
+
+	ret = (fread(&saved, sizeof(saved), 1, rd) == 1);
+	fclose(rd);
+
+	if (!ret || !restore(saved))
+	{
+		BOOST_LOG_TRIVIAL(error) << "Unrecognized indicator state: " << filename;
+		return false;
+	}
+
+	return true;
+}
+
+/**
+ * Take up state that was saved somewhere else, like a store. Indicators that have other periods start over.
+ *
+ * @return boolean. False if the state is not in this format. Every indicator starts over.
+ */
+bool live_indicators::restore(const struct live_indicators_file &saved)
+{
+	reset();
+
+	if ((memcmp(saved.header.magic, LIVE_FILE_MAGIC, sizeof(saved.header.magic)) != 0) ||
+	    (saved.header.version != LIVE_FILE_VERSION) || (saved.header.byte_order != BAR_FILE_BYTE_ORDER))
+		return false;
+
+	if (!rsi.restore(saved.rsi) || !sma.restore(saved.sma))
+		reset();
+
+	return true;
+}
+
+/**
+ * @return The state of every indicator, as save() writes it.
+ */
+struct live_indicators_file live_indicators::snapshot() const
+{
+	struct live_indicators_file saved;
+
+	memset(&saved, 0, sizeof(saved));
+	saved.header = bar_file_new_header(0);
+	memcpy(saved.header.magic, LIVE_FILE_MAGIC, sizeof(saved.header.magic));
+	saved.header.version = LIVE_FILE_VERSION;
+	saved.rsi = rsi.snapshot();
+	saved.sma = sma.snapshot();
+
+	return saved;
+}
+
+/**
+ * Write the state of every indicator.
+ *
+ * @return boolean. False if the file could not be written.
+ */
+bool live_indicators::save(const char *filename) const
+{
+	struct live_indicators_file saved = snapshot();
+	FILE *wr;
+	bool ret;
+
+	if ((wr = fopen(filename, "wb")) == NULL)
+	{
+		BOOST_LOG_TRIVIAL(error) << "Unable to open " << filename << " for writing: " << strerror(errno);
+		return false;
+	}
+
+	ret = (fwrite(&saved, sizeof(saved), 1, wr) == 1);
+	ret = (fclose(wr) == 0) && ret;
+
+	if (!ret)
+		BOOST_LOG_TRIVIAL(error) << "Failed to write " << filename;
+
+	return ret;
+}
@@ -0,0 +1,44 @@
+#include "lib/stock.h"
+#include "lib/bar_file.h"
+#include "lib/stats/relative_strength_index.h"
+#include "lib/stats/simple_moving_average.h"
+
+#ifndef _live_indicators_h
+#define _live_indicators_h
+/**
+ * Indicator state file format (version 4).
+ *
+ * The state of each streaming indicator of one ticker, saved to "<ticker>.live", or to the store, after a scan: a
+ * bar file header with its own magic and no rows, then the state of the RSI and the SMA (see struct
+ * live_indicators_file). Values are in host byte order, like bar files.
+ */
+#define LIVE_FILE_MAGIC "RSILIVE"
+#define LIVE_FILE_VERSION 4
+
+struct live_indicators_file {
+	struct bar_file_header header;
+	struct relative_strength_index_state rsi;
+	struct simple_moving_average_state sma;
+};
+
+/**
+ * The indicators that a scan reads for the latest day of every ticker, with the periods that the screens
+ * use. Each run only feeds them the bars that arrived since their state was saved.
+ */
+class live_indicators
+{
+	public:
+		live_indicators(): rsi(14), sma(20) {};
+
+		void reset();
+		long advance(const stockinfo_view &data, int32_t since = INT32_MAX);
+		bool current(const stockinfo_view &data) const;
+		bool load(const char *filename);
+		bool save(const char *filename) const;
+		bool restore(const struct live_indicators_file &saved);
+		struct live_indicators_file snapshot() const;
+
+		relative_strength_index rsi;
+		simple_moving_average sma;
+};
+#endif
@@ -1,26 +1,53 @@
 #include <stdlib.h>
 #include "lib/stats/low.h"
+#include "lib/stats/simd.h"
+#include "lib/stats/rolling.h"
 
-double low::find(const stockinfo &data, int days)
+double low::find(const stockinfo_view &data, int days)
 {
 	long rows = data.length();
 	double ret = 0;
-	int row;
 
 	if ((days <= 0) || (rows <= days + 1))
 	{
 		return ret;
 	}
 
-	ret = data[0]->low;
+	ret = simd().lowest(data.lows(), days);
 
-	for (row = days - 1; row >= 0; row--)
-	{
-		if (ret > data[row]->low)
-		{
-			ret = data[row]->low;
-		}
-	}
+	return ret;
+}
+
+/**
+ * Allocate and fill in the lowest low of every window of days rows. See fill().
+ *
+ * @return series_size(count) values. The caller must free() them.
+ */
+double *low::generate(const stockinfo_view &data, price_field field, int days, long count)
+{
+	double *ret = (double *)malloc(sizeof(double) * series_size(count));
+
+	fill(data, field, days, count, ret);
 
 	return ret;
 }
+
+/**
+ * Write the lowest of one price over the days rows up to each of the newest count rows into out, which holds
+ * series_size(count) values. out[row] is what find() gives for the view that starts at row, when field is price_low.
+ *
+ * @param offsets If not null, series_size(count) values: how many rows before each row its low is, or -1.
+ * @return The number of values, from out[0]. The rest are 0.
+ */
+long low::fill(const stockinfo_view &data, price_field field, int days, long count, double *out, long *offsets)
+{
+	return fill_d(data.prices(field), data.length(), days, count, out, offsets);
+}
+
+/**
+ * See fill(). values holds rows values, newest first.
+ */
+long low::fill_d(const double *values, long rows, int days, long count, double *out, long *offsets)
+{
+	return rolling_extreme(values, rows, days, count, out, offsets, [](double newer, double older) { return newer <= older; });
+}
@@ -1,6 +1,20 @@
 #include <stdlib.h>
+#include <string.h>
+#include <algorithm>
 #include "lib/stats/moving_average_convergence_divergence.h"
 #include "lib/stats/exponential_moving_average.h"
+#include "lib/stats/stream.h"
+
+moving_average_convergence_divergence::moving_average_convergence_divergence(int fast, int slow, int avg)
+{
+	state.fast = (fast > 0) ? fast : 12;
+	state.slow = (slow > 0) ? slow : 26;
+	state.avg = (avg > 0) ? avg : 9;
+	reset();
+}
+
+// Intermediate series, kept per thread so that fill() and histogram() do not allocate once they are big enough.
+static thread_local series_buffer fast_scratch, line_scratch;
 
 /**
  * Loop through data and create Moving Average Convergence/Divergence data from EMAs
@@ -10,34 +24,44 @@
  *
  * @link http://www.investopedia.com/terms/m/macd.asp?lgl=no-infinite
  */
-double *moving_average_convergence_divergence::generate(const stockinfo &data, int fast, int slow, long count)
+double *moving_average_convergence_divergence::generate(const stockinfo_view &data, int fast, int slow, long count)
+{
+	double *ret = (double *)malloc(sizeof(double) * series_size(count));
+
+	fill(data, fast, slow, count, ret);
+
+	return ret;
+}
+
+/**
+ * Write the MACD of the newest count rows into out, which holds series_size(count) values.
+ *
+ * @return The number of values, from out[0], that have a full slow period behind them. The rest are 0.
+ */
+long moving_average_convergence_divergence::fill(const stockinfo_view &data, int fast, int slow, long count, double *out)
 {
 	exponential_moving_average ema;
-	double *ema12, *ema26, *ret;
-	int row, start;
+	double *ema12;
+	long row, start;
 	long rows = data.length();
 
 	if ((count <= 0) || (rows <= slow + 1))
 	{
-		ret = (double *)malloc(sizeof(double));
-		ret[0] = 0;
-		return ret;
+		memset(out, 0, sizeof(double) * series_size(count));
+		return 0;
 	}
 
-	ret = (double *)malloc(sizeof(double) * (count + 1));
-	ret[count] = 0;
-
 	start = (slow + count < rows) ? count : rows - slow;
-	ema12 = ema.generate(data, fast, count);
-	ema26 = ema.generate(data, slow, count);
+	ema12 = fast_scratch.reserve(series_size(count));
+	ema.fill(data, fast, count, ema12);
+	ema.fill(data, slow, count, out);
 
 	for (row = start - 1; row >= 0; row--)
-		ret[row] = ema12[row] - ema26[row];
+		out[row] = ema12[row] - out[row];
+	for (row = start; row <= count; row++)
+		out[row] = 0;
 
-	free(ema12);
-	free(ema26);
-
-	return ret;
+	return start;
 }
 
 /**
@@ -48,32 +72,152 @@ double *moving_average_convergence_divergence::generate(const stockinfo &data, i
  *
  * @link http://www.investopedia.com/terms/m/macd.asp?lgl=no-infinite
  */
-double *moving_average_convergence_divergence::histogram(const stockinfo &data, int fast, int slow, int avg, long count)
+double *moving_average_convergence_divergence::histogram(const stockinfo_view &data, int fast, int slow, int avg, long count)
 {
-	exponential_moving_average ema;
-	double *macd, *ema_data, *ret;
-	int row, start;
+	double *ret = (double *)malloc(sizeof(double) * series_size(count));
+
+	fill_histogram(data, fast, slow, avg, count, ret);
+
+	return ret;
+}
+
+/**
+ * Write the MACD histogram of the newest count rows into out, which holds series_size(count) values.
+ *
+ * @return The number of values, from out[0], that were worked out. The rest are 0.
+ */
+long moving_average_convergence_divergence::fill_histogram(const stockinfo_view &data, int fast, int slow, int avg, long count, double *out)
+{
+	double *macd;
+	long start;
 	long rows = data.length();
 
 	if ((count <= 0) || (rows <= slow + 1))
 	{
-		ret = (double *)malloc(sizeof(double));
-		ret[0] = 0;
-		return ret;
+		memset(out, 0, sizeof(double) * series_size(count));
+		return 0;
 	}
 
-	ret = (double *)malloc(sizeof(double) * (count + 1));
-	ret[count] = 0;
+	macd = line_scratch.reserve(series_size(count + avg));
+	start = this->fill(data, fast, slow, count + avg, macd);
+
+	return fill_histogram(macd, start, avg, count, out);
+}
+
+/**
+ * Write the MACD histogram of the newest count rows into out, from a MACD line that fill() already made with
+ * count + avg rows.
+ *
+ * @param macd The MACD line, with series_size(count + avg) values.
+ * @param valid What fill() returned for the line.
+ * @return The number of values, from out[0], that were worked out. The rest are 0.
+ */
+long moving_average_convergence_divergence::fill_histogram(const double *macd, long valid, int avg, long count, double *out)
+{
+	exponential_moving_average ema;
+	long row, start;
+
+	if ((count <= 0) || (valid <= 0))
+	{
+		memset(out, 0, sizeof(double) * series_size(count));
+		return 0;
+	}
 
-	start = (slow + count + avg < rows) ? count : rows - slow;
-	macd = this->generate(data, fast, slow, count + avg);
-	ema_data = ema.generate_d(macd, count + avg, avg, count);
+	start = std::min(count, valid);
+	ema.fill_d(macd, count + avg, avg, count, out);
 
 	for (row = start - 1; row >= 0; row--)
-		ret[row] = macd[row] - ema_data[row];
+		out[row] = macd[row] - out[row];
+	for (row = start; row <= count; row++)
+		out[row] = 0;
 
-	free(macd);
-	free(ema_data);
+	return start;
+}
 
-	return ret;
+/**
+ * Forget every bar, but keep the periods.
+ */
+void moving_average_convergence_divergence::reset()
+{
+	int fast = state.fast, slow = state.slow, avg = state.avg;
+
+	memset(&state, 0, sizeof(state));
+	state.fast = fast;
+	state.slow = slow;
+	state.avg = avg;
+}
+
+/**
+ * Add the next bar. Both EMAs start at the first close, and the signal line starts at the first MACD, so
+ * feeding every row of data in, oldest first, gives the same MACD as generate() does when both of its EMAs
+ * start from the oldest row.
+ *
+ * @param close The close of the new bar.
+ * @param day The day of the new bar, for advance().
+ * @return The MACD as of the new bar. See value().
+ */
+double moving_average_convergence_divergence::update(double close, int32_t day)
+{
+	double fast_alpha = 2.0 / (state.fast + 1), slow_alpha = 2.0 / (state.slow + 1), avg_alpha = 2.0 / (state.avg + 1);
+
+	if (state.bars++ == 0)
+	{
+		state.fast_ema = state.slow_ema = close;
+		state.signal = 0;
+	}
+	else
+	{
+		state.fast_ema = fast_alpha * close + (1 - fast_alpha) * state.fast_ema;
+		state.slow_ema = slow_alpha * close + (1 - slow_alpha) * state.slow_ema;
+		state.signal = avg_alpha * (state.fast_ema - state.slow_ema) + (1 - avg_alpha) * state.signal;
+	}
+
+	state.close = close;
+	state.day = day;
+
+	return value();
+}
+
+/**
+ * Feed in the rows of data after the last bar. See stream_advance().
+ */
+long moving_average_convergence_divergence::advance(const stockinfo_view &data, int32_t since)
+{
+	return stream_advance(*this, data, since);
+}
+
+/**
+ * @return The MACD as of the last bar. 0 until there are more than slow + 1 bars, like generate().
+ */
+double moving_average_convergence_divergence::value() const
+{
+	return (state.bars > state.slow + 1) ? state.fast_ema - state.slow_ema : 0;
+}
+
+/**
+ * @return The signal line (an EMA of the MACD) as of the last bar.
+ */
+double moving_average_convergence_divergence::signal() const
+{
+	return (state.bars > state.slow + 1) ? state.signal : 0;
+}
+
+/**
+ * @return The MACD less its signal line, as of the last bar.
+ */
+double moving_average_convergence_divergence::histogram() const
+{
+	return value() - signal();
+}
+
+/**
+ * Carry on from a snapshot() of a MACD with the same periods.
+ */
+bool moving_average_convergence_divergence::restore(const moving_average_convergence_divergence_state &saved)
+{
+	if ((saved.fast != state.fast) || (saved.slow != state.slow) || (saved.avg != state.avg) || (saved.bars < 0))
+		return false;
+
+	state = saved;
+	return true;
 }
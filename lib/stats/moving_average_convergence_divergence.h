@@ -1,8 +1,42 @@
 #include "lib/stock.h"
+#include "lib/stats/series.h"
+
+#ifndef _moving_average_convergence_divergence_h
+#define _moving_average_convergence_divergence_h
+// Everything a streaming MACD needs to carry on from its last bar.
+struct moving_average_convergence_divergence_state {
+	int32_t fast;
+	int32_t slow;
+	int32_t avg;
+	int32_t day;
+	int64_t bars;
+	double close;
+	double fast_ema;
+	double slow_ema;
+	double signal;
+};
 
 class moving_average_convergence_divergence
 {
 	public:
-		double *generate(const stockinfo &data, int fast, int slow, long count);
-		double *histogram(const stockinfo &data, int fast, int slow, int avg, long count);
+		moving_average_convergence_divergence(int fast = 12, int slow = 26, int avg = 9);
+		double *generate(const stockinfo_view &data, int fast, int slow, long count);
+		double *histogram(const stockinfo_view &data, int fast, int slow, int avg, long count);
+		long fill(const stockinfo_view &data, int fast, int slow, long count, double *out);
+		long fill_histogram(const stockinfo_view &data, int fast, int slow, int avg, long count, double *out);
+		long fill_histogram(const double *macd, long valid, int avg, long count, double *out);
+
+		// Streaming, one bar at a time, oldest first.
+		void reset();
+		double update(double close, int32_t day = 0);
+		long advance(const stockinfo_view &data, int32_t since = INT32_MAX);
+		double value() const;
+		double signal() const;
+		double histogram() const;
+		const moving_average_convergence_divergence_state &snapshot() const { return state; }
+		bool restore(const moving_average_convergence_divergence_state &saved);
+
+	private:
+		moving_average_convergence_divergence_state state;
 };
+#endif
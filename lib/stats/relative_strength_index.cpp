@@ -1,72 +1,131 @@
 #include <stdlib.h>
+#include <string.h>
+#include <algorithm>
 #include "lib/stats/relative_strength_index.h"
+#include "lib/stats/simd.h"
+#include "lib/stats/stream.h"
 
-double *relative_strength_index::generate(const stockinfo &data, int period, long count)
+relative_strength_index::relative_strength_index(int period)
+{
+	state.period = (period > 0) ? period : 14;
+	reset();
+}
+
+/**
+ * Allocate and fill in the RSI of count rows. See fill().
+ *
+ * @return series_size(count) values. The caller must free() them.
+ */
+double *relative_strength_index::generate(const stockinfo_view &data, int period, long count)
+{
+	double *ret = (double *)malloc(sizeof(double) * series_size(count));
+
+	fill(data, period, count, ret);
+
+	return ret;
+}
+
+/**
+ * Write the RSI of the newest count rows into out, which holds series_size(count) values. The averages
+ * start from up to 2 * period rows before the oldest of them.
+ *
+ * @return The number of values, from out[0], that have a full period of changes behind them.
+ */
+long relative_strength_index::fill(const stockinfo_view &data, int period, long count, double *out)
 {
-	double change, ag, al, up, down, gains = 0, losses = 0;
-	double prev_gain = 0, prev_loss = 0, rs, rsi = 0, *ret;
 	long rows = data.length();
-	int row, start;
+	long start;
 
+	memset(out, 0, sizeof(double) * series_size(count));
 	if ((count <= 0) || (rows <= period + 1))
+		return 0;
+
+	start = ((2 * period) + count < rows - 1) ? (2 * period) + count : rows - 1;
+	simd().strength(data.closes(), start, period, count, out);
+
+	return std::min(count, start - period + 1);
+}
+
+/**
+ * Forget every bar, but keep the period.
+ */
+void relative_strength_index::reset()
+{
+	int period = state.period;
+
+	memset(&state, 0, sizeof(state));
+	state.period = period;
+}
+
+/**
+ * Add the next bar. Feeding every row of data in, oldest first, gives the same RSI as generate() does when it
+ * starts from the oldest row.
+ *
+ * @param close The close of the new bar.
+ * @param day The day of the new bar, for advance().
+ * @return The RSI as of the new bar. See value().
+ */
+double relative_strength_index::update(double close, int32_t day)
+{
+	double change, up, down;
+	int period = state.period;
+
+	if (state.bars++ == 0)
 	{
-		ret = (double *)malloc(sizeof(double));
-		ret[0] = 0;
-		return ret;
+		state.close = close;
+		state.day = day;
+		return value();
 	}
 
-	ret = (double *)malloc(sizeof(double) * (count + 1));
-	ret[count] = 0;
+	change = close - state.close;
+	up = (change < 0) ? 0 : change;
+	down = (change < 0) ? -change : 0;
 
-	start = ((2 * period) + count < rows - 1) ? (2 * period) + count : rows - 1;
-
-	for (row = start - 1; row >= 0; row--)
+	// Wilder's smoothing, once the first period of changes has been averaged.
+	if (state.bars > period + 1)
 	{
-		change = data[row]->close - data[row + 1]->close;
-		if (change < 0)
-		{
-			down = -change;
-			losses += down;
-			up = 0;
-		}
-		else
-		{
-			up = change;
-			gains += up;
-			down = 0;
-		}
-
-		if (row < start - period)
-		{
-			ag = (prev_gain * (period - 1) + up) / period;
-			al = (prev_loss * (period - 1) + down) / period;
-		}
-		else
-		{
-			ag = gains / period;
-			al = losses / period;
-		}
-
-		rs = ag / al;
-		rsi = 100 - (100 / (1 + rs));
-
-		if (row <= start - period)
-		{
-			change = data[row + period - 1]->close - data[row + period]->close;
-			if (change < 0)
-				losses += change;
-			else
-				gains -= change;
-		}
-
-		if (row < count)
-			ret[row] = rsi;
-
-		prev_gain = ag;
-		prev_loss = al;
+		state.avg_gain = (state.avg_gain * (period - 1) + up) / period;
+		state.avg_loss = (state.avg_loss * (period - 1) + down) / period;
+	}
+	else
+	{
+		state.gains += up;
+		state.losses += down;
+		state.avg_gain = state.gains / period;
+		state.avg_loss = state.losses / period;
 	}
 
-	ret[0] = rsi;
+	state.rsi = 100 - (100 / (1 + state.avg_gain / state.avg_loss));
+	state.close = close;
+	state.day = day;
 
-	return ret;
+	return value();
+}
+
+/**
+ * Feed in the rows of data after the last bar. See stream_advance().
+ */
+long relative_strength_index::advance(const stockinfo_view &data, int32_t since)
+{
+	return stream_advance(*this, data, since);
+}
+
+/**
+ * @return The RSI as of the last bar. 0 until there are more than period + 1 bars, like generate().
+ */
+double relative_strength_index::value() const
+{
+	return (state.bars > state.period + 1) ? state.rsi : 0;
+}
+
+/**
+ * Carry on from a snapshot() of an RSI with the same period.
+ */
+bool relative_strength_index::restore(const relative_strength_index_state &saved)
+{
+	if ((saved.period != state.period) || (saved.bars < 0))
+		return false;
+
+	state = saved;
+	return true;
 }
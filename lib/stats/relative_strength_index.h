@@ -1,7 +1,37 @@
 #include "lib/stock.h"
+#include "lib/stats/series.h"
+
+#ifndef _relative_strength_index_h
+#define _relative_strength_index_h
+// Everything a streaming RSI needs to carry on from its last bar.
+struct relative_strength_index_state {
+	int32_t period;
+	int32_t day;
+	int64_t bars;
+	double close;
+	double gains;
+	double losses;
+	double avg_gain;
+	double avg_loss;
+	double rsi;
+};
 
 class relative_strength_index
 {
 public:
-	double *generate(const stockinfo &data, int period = 14, long count = 1);
+	relative_strength_index(int period = 14);
+	double *generate(const stockinfo_view &data, int period = 14, long count = 1);
+	long fill(const stockinfo_view &data, int period, long count, double *out);
+
+	// Streaming, one bar at a time, oldest first.
+	void reset();
+	double update(double close, int32_t day = 0);
+	long advance(const stockinfo_view &data, int32_t since = INT32_MAX);
+	double value() const;
+	const relative_strength_index_state &snapshot() const { return state; }
+	bool restore(const relative_strength_index_state &saved);
+
+private:
+	relative_strength_index_state state;
 };
+#endif
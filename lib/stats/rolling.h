@@ -0,0 +1,57 @@
+#include <string.h>
+#include <algorithm>
+#include <vector>
+#include "lib/stats/series.h"
+
+#ifndef _rolling_h
+#define _rolling_h
+/**
+ * The extreme of every window of days values, from a monotonic deque. Each row goes into the deque once and leaves
+ * it once, so a whole series costs one pass, however long the window. The rows are newest first, and the window of
+ * a row is that row and the days - 1 rows before it.
+ *
+ * @param beats Whether a newer value beats an older one, which can then never be the extreme again. Ties should
+ *              beat, so that the newest of equal extremes is the one reported.
+ * @param out series_size(count) values. A row gets a value if more than days + 1 rows start from it, which is what
+ *            high::find() and low::find() ask for. The rest are 0.
+ * @param offsets If not null, series_size(count) values: how many rows before each row its extreme is. -1 for rows
+ *                without a value.
+ * @return The number of values, from out[0].
+ */
+template<class Beats>
+long rolling_extreme(const double *values, long rows, int days, long count, double *out, long *offsets, Beats beats)
+{
+	static thread_local std::vector<long> window;
+	long valid, row, head = 0, tail = 0, mask = 1;
+
+	memset(out, 0, sizeof(double) * series_size(count));
+	if (offsets)
+		std::fill(offsets, offsets + series_size(count), -1);
+	if ((count <= 0) || (days <= 0) || (rows <= days + 1))
+		return 0;
+
+	// The deque holds rows from head to tail, oldest first, and their values only get better from tail to head. It
+	// never holds more than days + 1 rows, in a ring that is a power of 2 long.
+	valid = std::min(count, rows - days - 1);
+	while (mask < days + 1)
+		mask = (mask << 1) | 1;
+	window.resize(mask + 1);
+	for (row = valid + days - 2; row >= 0; row--)
+	{
+		while ((tail > head) && beats(values[row], values[window[(tail - 1) & mask]]))
+			tail--;
+		window[tail++ & mask] = row;
+		if (window[head & mask] >= row + days)
+			head++;
+
+		if (row < valid)
+		{
+			out[row] = values[window[head & mask]];
+			if (offsets)
+				offsets[row] = window[head & mask] - row;
+		}
+	}
+
+	return valid;
+}
+#endif
@@ -0,0 +1,43 @@
+#include <stdlib.h>
+
+#ifndef _series_h
+#define _series_h
+/**
+ * The number of values that an indicator's fill() writes for count rows: count + 1, with a zero on the end,
+ * or a single zero if count is not positive. generate() allocates the same.
+ */
+inline long series_size(const long count) {
+	return (count > 0) ? count + 1 : 1;
+}
+
+/**
+ * Caller-owned storage for indicator series. It only grows, so a buffer that is reused from ticker to ticker
+ * stops allocating once it has held the longest series.
+ */
+class series_buffer {
+	public:
+		series_buffer(): values(nullptr), capacity(0) {};
+		~series_buffer() { free(values); };
+		series_buffer(const series_buffer &) = delete;
+		series_buffer &operator =(const series_buffer &) = delete;
+
+		/**
+		 * Make room for count values. Whatever the buffer held before is lost.
+		 */
+		double *reserve(const long count) {
+			if (count > capacity) {
+				free(values);
+				values = (double *)malloc(sizeof(double) * count);
+				capacity = count;
+			}
+
+			return values;
+		}
+
+		double *data() const { return values; }
+
+	private:
+		double *values;
+		long capacity;
+};
+#endif
@@ -0,0 +1,739 @@
+#include <math.h>
+#include <algorithm>
+#include <atomic>
+#include "lib/stats/simd.h"
+#include "lib/stats/series.h"
+
+#if defined(__x86_64__) && (defined(__GNUC__) || defined(__clang__))
+#define SIMD_X86
+#include <immintrin.h>
+
+// Every lane of an AVX-512 vector of eight. GCC 12 warns that the unmasked forms of many intrinsics may read the
+// undefined vector that they pass through, so the kernels use the zero-masked forms with every lane instead.
+#define ALL_LANES ((__mmask8)0xFF)
+#endif
+
+// Below this many rows, setting up the vector kernels costs more than it saves.
+#define SIMD_MIN_ROWS 64
+
+// Weights smaller than this no longer change a smoothed price, and multiplying them again is slow.
+#define SIMD_SMALLEST_WEIGHT 1e-200
+
+// Smoothed chunks, kept per thread so that the kernels do not allocate once they are big enough.
+static thread_local series_buffer smooth_scratch;
+
+/**
+ * The SMA loop: add each row to a running sum, and take away the row that left the window.
+ */
+static void mean_scalar(const double *values, long start, int period, double *out)
+{
+	double sum = 0;
+	long row;
+
+	for (row = start - 1; row >= 0; row--)
+	{
+		sum += values[row];
+		if (row < start - period)
+		{
+			sum -= values[row + period];
+			out[row] = sum / period;
+		}
+	}
+}
+
+/**
+ * The Bollinger loop: running sums of each price less a shift, which moves to the middle once a period so that
+ * the sum of squares does not lose precision.
+ */
+static void deviation_scalar(const double *values, long start, int period, int deviations, double *middle, double *width)
+{
+	double sum = 0, shift = 0, shifted = 0, squares = 0, variance;
+	long row, y;
+
+	for (row = start - 1; row >= 0; row--)
+	{
+		sum += values[row];
+		if (row >= start - period)
+			continue;
+
+		sum -= values[row + period];
+		middle[row] = sum / period;
+
+		if ((start - period - 1 - row) % period == 0)
+		{
+			// Move the shift to the middle, and add the window up again.
+			shift = middle[row];
+			shifted = squares = 0;
+			for (y = row; y < row + period; y++)
+			{
+				shifted += values[y] - shift;
+				squares += (values[y] - shift) * (values[y] - shift);
+			}
+		}
+		else
+		{
+			shifted += (values[row] - shift) - (values[row + period] - shift);
+			squares += (values[row] - shift) * (values[row] - shift) - (values[row + period] - shift) * (values[row + period] - shift);
+		}
+
+		variance = (squares - shifted * shifted / period) / period;
+		width[row] = sqrt((variance > 0) ? variance : 0) * deviations;
+	}
+}
+
+/**
+ * The EMA loop.
+ */
+static void smooth_scalar(const double *values, long start, double alpha, long keep, double *out)
+{
+	double e = values[start];
+	long row;
+
+	for (row = start - 1; row >= 0; row--)
+	{
+		e = alpha * values[row] + (1 - alpha) * e;
+		if (row < keep)
+			out[row] = e;
+	}
+}
+
+static double highest_scalar(const double *values, long count)
+{
+	double ret = values[0];
+	long row;
+
+	for (row = count - 1; row >= 0; row--)
+		if (ret < values[row])
+			ret = values[row];
+
+	return ret;
+}
+
+static double lowest_scalar(const double *values, long count)
+{
+	double ret = values[0];
+	long row;
+
+	for (row = count - 1; row >= 0; row--)
+		if (ret > values[row])
+			ret = values[row];
+
+	return ret;
+}
+
+/**
+ * The RSI loop: the first period changes are averaged, then Wilder's smoothing takes over.
+ */
+static void strength_scalar(const double *values, long start, int period, long count, double *out)
+{
+	double change, ag, al, up, down, gains = 0, losses = 0;
+	double prev_gain = 0, prev_loss = 0, rs;
+	long row;
+
+	for (row = start - 1; row >= 0; row--)
+	{
+		change = values[row] - values[row + 1];
+		if (change < 0)
+		{
+			down = -change;
+			losses += down;
+			up = 0;
+		}
+		else
+		{
+			up = change;
+			gains += up;
+			down = 0;
+		}
+
+		if (row < start - period)
+		{
+			ag = (prev_gain * (period - 1) + up) / period;
+			al = (prev_loss * (period - 1) + down) / period;
+		}
+		else
+		{
+			ag = gains / period;
+			al = losses / period;
+		}
+
+		rs = ag / al;
+		if (row <= start - period)
+		{
+			change = values[row + period - 1] - values[row + period];
+			if (change < 0)
+				losses += change;
+			else
+				gains -= change;
+		}
+
+		if (row < count)
+			out[row] = 100 - (100 / (1 + rs));
+
+		prev_gain = ag;
+		prev_loss = al;
+	}
+}
+
+/**
+ * strength_scalar() with Wilder's smoothing as a multiply by (period - 1) / period and one by 1 / period, rather than
+ * a divide. The divide was what each row waited on. Gains and losses split without a branch, which the scalar loop
+ * mispredicts half the time, and the sums stop once they are averaged, as nothing reads them after that.
+ */
+static void strength_fast(const double *values, long start, int period, long count, double *out)
+{
+	double change, ag = 0, al = 0, gains = 0, losses = 0, keep, part;
+	long row;
+
+	keep = (period - 1) / (double)period;
+	part = 1.0 / period;
+	for (row = start - 1; row >= start - period; row--)
+	{
+		change = values[row] - values[row + 1];
+		gains += std::max(change, 0.0);
+		losses += std::max(-change, 0.0);
+		ag = gains * part;
+		al = losses * part;
+		if (row < count)
+			out[row] = 100 - (100 / (1 + ag / al));
+	}
+
+	for (; row >= 0; row--)
+	{
+		change = values[row] - values[row + 1];
+		ag = ag * keep + std::max(change, 0.0) * part;
+		al = al * keep + std::max(-change, 0.0) * part;
+		if (row < count)
+			out[row] = 100 - (100 / (1 + ag / al));
+	}
+}
+
+/**
+ * The second half of a vector smooth(). Each of lanes chunks of chunk rows, oldest first, was smoothed on its
+ * own from 0 into local (one value per lane per step). Every chunk but the oldest then needs the weight of the
+ * value before it, (1 - alpha)^(t + 1) at step t, times that value.
+ */
+static void smooth_join(const double *local, long lanes, long chunk, long start, double alpha, long keep, double *out)
+{
+	double *weight = smooth_scratch.data() + lanes * chunk;
+	double w = 1, carry = 0;
+	long k, t, row;
+
+	for (t = 0; t < chunk; t++)
+	{
+		w *= 1 - alpha;
+		if (w < SIMD_SMALLEST_WEIGHT)
+			w = 0;
+		weight[t] = w;
+	}
+
+	for (k = 0; k < lanes; k++)
+	{
+		row = start - 1 - k * chunk;
+		for (t = (row >= keep) ? row - keep + 1 : 0; (t < chunk) && (row - t >= 0); t++)
+			out[row - t] = local[t * lanes + k] + weight[t] * carry;
+
+		carry = local[(chunk - 1) * lanes + k] + weight[chunk - 1] * carry;
+	}
+}
+
+#ifdef SIMD_X86
+/**
+ * The oldest window added up, then the rows after it carried forward by a prefix sum of what enters and leaves
+ * the window, four rows at a time. The sum stays the size of one window, as it does in the scalar loop.
+ */
+__attribute__((target("avx2,fma")))
+static void mean_avx2(const double *values, long start, int period, double *out)
+{
+	__m256d zero = _mm256_setzero_pd(), scale, sum, x;
+	double total = 0;
+	long row;
+
+	if (start < SIMD_MIN_ROWS)
+	{
+		mean_scalar(values, start, period, out);
+		return;
+	}
+
+	for (row = start - 1; row >= start - period; row--)
+		total += values[row];
+
+	scale = _mm256_set1_pd(1.0 / period);
+	sum = _mm256_set1_pd(total);
+	for (row = start - period; row >= 4; row -= 4)
+	{
+		// Add each lane to the lanes after it, then add the window before the block. Only the last add waits
+		// for the block before.
+		x = _mm256_sub_pd(_mm256_loadu_pd(values + row - 4), _mm256_loadu_pd(values + row - 4 + period));
+		x = _mm256_add_pd(x, _mm256_blend_pd(_mm256_permute4x64_pd(x, _MM_SHUFFLE(3, 3, 2, 1)), zero, 0x8));
+		x = _mm256_add_pd(x, _mm256_blend_pd(_mm256_permute4x64_pd(x, _MM_SHUFFLE(3, 3, 3, 2)), zero, 0xC));
+		_mm256_storeu_pd(out + row - 4, _mm256_mul_pd(_mm256_add_pd(x, sum), scale));
+		sum = _mm256_add_pd(sum, _mm256_permute4x64_pd(x, 0));
+	}
+
+	for (total = _mm256_cvtsd_f64(sum), row--; row >= 0; row--)
+	{
+		total += values[row] - values[row + period];
+		out[row] = total * (1.0 / period);
+	}
+}
+
+/**
+ * deviation_scalar() four rows at a time. Within each period the shift stays put, so the running sum and sum of
+ * squares are carried down the rows by a prefix sum of what enters and leaves the window, as in mean_avx2().
+ */
+__attribute__((target("avx2,fma")))
+static void deviation_avx2(const double *values, long start, int period, int deviations, double *middle, double *width)
+{
+	__m256d zero, scale, times, shift, sum, squares, a, b, x, q;
+	double s, shifted, square, variance;
+	long row, top, bottom, y;
+
+	if (start < SIMD_MIN_ROWS)
+	{
+		deviation_scalar(values, start, period, deviations, middle, width);
+		return;
+	}
+
+	mean_avx2(values, start, period, middle);
+
+	zero = _mm256_setzero_pd();
+	scale = _mm256_set1_pd(1.0 / period);
+	times = _mm256_set1_pd(deviations);
+	for (top = start - period - 1; top >= 0; top -= period)
+	{
+		// Move the shift to the middle, and add the window up again.
+		s = middle[top];
+		shift = _mm256_set1_pd(s);
+		sum = squares = zero;
+		for (y = top; y + 4 <= top + period; y += 4)
+		{
+			a = _mm256_sub_pd(_mm256_loadu_pd(values + y), shift);
+			sum = _mm256_add_pd(sum, a);
+			squares = _mm256_fmadd_pd(a, a, squares);
+		}
+
+		a = _mm256_hadd_pd(sum, squares);
+		a = _mm256_add_pd(a, _mm256_permute2f128_pd(a, a, 1));
+		shifted = _mm256_cvtsd_f64(a);
+		square = _mm256_cvtsd_f64(_mm256_permute_pd(a, 1));
+		for (; y < top + period; y++)
+		{
+			shifted += values[y] - s;
+			square += (values[y] - s) * (values[y] - s);
+		}
+
+		variance = (square - shifted * shifted / period) / period;
+		width[top] = sqrt((variance > 0) ? variance : 0) * deviations;
+
+		bottom = (top >= period - 1) ? top - period + 1 : 0;
+		sum = _mm256_set1_pd(shifted);
+		squares = _mm256_set1_pd(square);
+		for (row = top; row - 4 >= bottom; row -= 4)
+		{
+			a = _mm256_sub_pd(_mm256_loadu_pd(values + row - 4), shift);
+			b = _mm256_sub_pd(_mm256_loadu_pd(values + row - 4 + period), shift);
+			x = _mm256_sub_pd(a, b);
+			q = _mm256_sub_pd(_mm256_mul_pd(a, a), _mm256_mul_pd(b, b));
+			x = _mm256_add_pd(x, _mm256_blend_pd(_mm256_permute4x64_pd(x, _MM_SHUFFLE(3, 3, 2, 1)), zero, 0x8));
+			q = _mm256_add_pd(q, _mm256_blend_pd(_mm256_permute4x64_pd(q, _MM_SHUFFLE(3, 3, 2, 1)), zero, 0x8));
+			x = _mm256_add_pd(x, _mm256_blend_pd(_mm256_permute4x64_pd(x, _MM_SHUFFLE(3, 3, 3, 2)), zero, 0xC));
+			q = _mm256_add_pd(q, _mm256_blend_pd(_mm256_permute4x64_pd(q, _MM_SHUFFLE(3, 3, 3, 2)), zero, 0xC));
+			sum = _mm256_add_pd(x, sum);
+			squares = _mm256_add_pd(q, squares);
+
+			// (squares - sum * sum / period) / period, at least 0, with the divides as multiplies.
+			q = _mm256_max_pd(_mm256_mul_pd(_mm256_sub_pd(squares, _mm256_mul_pd(_mm256_mul_pd(sum, sum), scale)), scale), zero);
+			_mm256_storeu_pd(width + row - 4, _mm256_mul_pd(_mm256_sqrt_pd(q), times));
+			sum = _mm256_permute4x64_pd(sum, 0);
+			squares = _mm256_permute4x64_pd(squares, 0);
+		}
+
+		for (shifted = _mm256_cvtsd_f64(sum), square = _mm256_cvtsd_f64(squares), row--; row >= bottom; row--)
+		{
+			shifted += (values[row] - s) - (values[row + period] - s);
+			square += (values[row] - s) * (values[row] - s) - (values[row + period] - s) * (values[row + period] - s);
+			variance = (square - shifted * shifted / period) / period;
+			width[row] = sqrt((variance > 0) ? variance : 0) * deviations;
+		}
+	}
+}
+
+/**
+ * Four chunks of the rows smoothed side by side, one per lane, then joined up. See smooth_join().
+ */
+__attribute__((target("avx2,fma")))
+static void smooth_avx2(const double *values, long start, double alpha, long keep, double *out)
+{
+	const long lanes = 4;
+	__m256d a, b, e, x;
+	__m256i row, none, one;
+	double *local;
+	long chunk, t;
+
+	if (start < SIMD_MIN_ROWS)
+	{
+		smooth_scalar(values, start, alpha, keep, out);
+		return;
+	}
+
+	chunk = (start + lanes - 1) / lanes;
+	local = smooth_scratch.reserve((lanes + 1) * chunk);
+
+	a = _mm256_set1_pd(alpha);
+	b = _mm256_set1_pd(1 - alpha);
+	e = _mm256_set_pd(0, 0, 0, values[start]);
+	row = _mm256_set_epi64x(start - 1 - 3 * chunk, start - 1 - 2 * chunk, start - 1 - chunk, start - 1);
+	none = _mm256_set1_epi64x(-1);
+	one = _mm256_set1_epi64x(1);
+	for (t = 0; t < chunk; t++)
+	{
+		// The newest chunk can run out of rows before the others.
+		x = _mm256_mask_i64gather_pd(_mm256_setzero_pd(), values, row, _mm256_castsi256_pd(_mm256_cmpgt_epi64(row, none)), 8);
+		e = _mm256_fmadd_pd(b, e, _mm256_mul_pd(a, x));
+		_mm256_storeu_pd(local + t * lanes, e);
+		row = _mm256_sub_epi64(row, one);
+	}
+
+	smooth_join(local, lanes, chunk, start, alpha, keep, out);
+}
+
+__attribute__((target("avx2,fma")))
+static double highest_avx2(const double *values, long count)
+{
+	__m256d h0, h1, h2, h3;
+	double ret;
+	long row;
+
+	h0 = h1 = h2 = h3 = _mm256_set1_pd(values[0]);
+	for (row = 0; row + 16 <= count; row += 16)
+	{
+		h0 = _mm256_max_pd(h0, _mm256_loadu_pd(values + row));
+		h1 = _mm256_max_pd(h1, _mm256_loadu_pd(values + row + 4));
+		h2 = _mm256_max_pd(h2, _mm256_loadu_pd(values + row + 8));
+		h3 = _mm256_max_pd(h3, _mm256_loadu_pd(values + row + 12));
+	}
+	for (; row + 4 <= count; row += 4)
+		h0 = _mm256_max_pd(h0, _mm256_loadu_pd(values + row));
+
+	h0 = _mm256_max_pd(_mm256_max_pd(h0, h1), _mm256_max_pd(h2, h3));
+	h0 = _mm256_max_pd(h0, _mm256_permute4x64_pd(h0, _MM_SHUFFLE(1, 0, 3, 2)));
+	h0 = _mm256_max_pd(h0, _mm256_permute4x64_pd(h0, _MM_SHUFFLE(2, 3, 0, 1)));
+	ret = _mm256_cvtsd_f64(h0);
+
+	for (; row < count; row++)
+		if (ret < values[row])
+			ret = values[row];
+
+	return ret;
+}
+
+__attribute__((target("avx2,fma")))
+static double lowest_avx2(const double *values, long count)
+{
+	__m256d l0, l1, l2, l3;
+	double ret;
+	long row;
+
+	l0 = l1 = l2 = l3 = _mm256_set1_pd(values[0]);
+	for (row = 0; row + 16 <= count; row += 16)
+	{
+		l0 = _mm256_min_pd(l0, _mm256_loadu_pd(values + row));
+		l1 = _mm256_min_pd(l1, _mm256_loadu_pd(values + row + 4));
+		l2 = _mm256_min_pd(l2, _mm256_loadu_pd(values + row + 8));
+		l3 = _mm256_min_pd(l3, _mm256_loadu_pd(values + row + 12));
+	}
+	for (; row + 4 <= count; row += 4)
+		l0 = _mm256_min_pd(l0, _mm256_loadu_pd(values + row));
+
+	l0 = _mm256_min_pd(_mm256_min_pd(l0, l1), _mm256_min_pd(l2, l3));
+	l0 = _mm256_min_pd(l0, _mm256_permute4x64_pd(l0, _MM_SHUFFLE(1, 0, 3, 2)));
+	l0 = _mm256_min_pd(l0, _mm256_permute4x64_pd(l0, _MM_SHUFFLE(2, 3, 0, 1)));
+	ret = _mm256_cvtsd_f64(l0);
+
+	for (; row < count; row++)
+		if (ret > values[row])
+			ret = values[row];
+
+	return ret;
+}
+
+/**
+ * See mean_avx2(). Eight rows at a time.
+ */
+__attribute__((target("avx512f")))
+static void mean_avx512(const double *values, long start, int period, double *out)
+{
+	const __m512i next1 = _mm512_set_epi64(7, 7, 6, 5, 4, 3, 2, 1), next2 = _mm512_set_epi64(7, 7, 7, 6, 5, 4, 3, 2), next4 = _mm512_set_epi64(7, 7, 7, 7, 7, 6, 5, 4);
+	__m512d scale, sum, x;
+	double total = 0;
+	long row;
+
+	if (start < SIMD_MIN_ROWS)
+	{
+		mean_scalar(values, start, period, out);
+		return;
+	}
+
+	for (row = start - 1; row >= start - period; row--)
+		total += values[row];
+
+	scale = _mm512_set1_pd(1.0 / period);
+	sum = _mm512_set1_pd(total);
+	for (row = start - period; row >= 8; row -= 8)
+	{
+		x = _mm512_sub_pd(_mm512_loadu_pd(values + row - 8), _mm512_loadu_pd(values + row - 8 + period));
+		x = _mm512_add_pd(x, _mm512_maskz_permutexvar_pd(0x7F, next1, x));
+		x = _mm512_add_pd(x, _mm512_maskz_permutexvar_pd(0x3F, next2, x));
+		x = _mm512_add_pd(x, _mm512_maskz_permutexvar_pd(0x0F, next4, x));
+		_mm512_storeu_pd(out + row - 8, _mm512_mul_pd(_mm512_add_pd(x, sum), scale));
+		sum = _mm512_add_pd(sum, _mm512_maskz_permutexvar_pd(ALL_LANES, _mm512_setzero_si512(), x));
+	}
+
+	for (total = _mm512_cvtsd_f64(sum), row--; row >= 0; row--)
+	{
+		total += values[row] - values[row + period];
+		out[row] = total * (1.0 / period);
+	}
+}
+
+/**
+ * See deviation_avx2(). Eight rows at a time.
+ */
+__attribute__((target("avx512f")))
+static void deviation_avx512(const double *values, long start, int period, int deviations, double *middle, double *width)
+{
+	const __m512i next1 = _mm512_set_epi64(7, 7, 6, 5, 4, 3, 2, 1), next2 = _mm512_set_epi64(7, 7, 7, 6, 5, 4, 3, 2), next4 = _mm512_set_epi64(7, 7, 7, 7, 7, 6, 5, 4);
+	const __m512i newest = _mm512_setzero_si512();
+	__m512d zero, scale, times, shift, sum, squares, a, b, d, q;
+	double s, shifted, square, variance, lanes[16];
+	long row, top, bottom, y;
+	int x;
+
+	if (start < SIMD_MIN_ROWS)
+	{
+		deviation_scalar(values, start, period, deviations, middle, width);
+		return;
+	}
+
+	mean_avx512(values, start, period, middle);
+
+	zero = _mm512_setzero_pd();
+	scale = _mm512_set1_pd(1.0 / period);
+	times = _mm512_set1_pd(deviations);
+	for (top = start - period - 1; top >= 0; top -= period)
+	{
+		s = middle[top];
+		shift = _mm512_set1_pd(s);
+		sum = squares = zero;
+		for (y = top; y + 8 <= top + period; y += 8)
+		{
+			a = _mm512_sub_pd(_mm512_loadu_pd(values + y), shift);
+			sum = _mm512_add_pd(sum, a);
+			squares = _mm512_fmadd_pd(a, a, squares);
+		}
+
+		_mm512_storeu_pd(lanes, sum);
+		_mm512_storeu_pd(lanes + 8, squares);
+		for (shifted = square = 0, x = 0; x < 8; x++)
+		{
+			shifted += lanes[x];
+			square += lanes[x + 8];
+		}
+		for (; y < top + period; y++)
+		{
+			shifted += values[y] - s;
+			square += (values[y] - s) * (values[y] - s);
+		}
+
+		variance = (square - shifted * shifted / period) / period;
+		width[top] = sqrt((variance > 0) ? variance : 0) * deviations;
+
+		bottom = (top >= period - 1) ? top - period + 1 : 0;
+		sum = _mm512_set1_pd(shifted);
+		squares = _mm512_set1_pd(square);
+		for (row = top; row - 8 >= bottom; row -= 8)
+		{
+			a = _mm512_sub_pd(_mm512_loadu_pd(values + row - 8), shift);
+			b = _mm512_sub_pd(_mm512_loadu_pd(values + row - 8 + period), shift);
+			d = _mm512_sub_pd(a, b);
+			q = _mm512_sub_pd(_mm512_mul_pd(a, a), _mm512_mul_pd(b, b));
+			d = _mm512_add_pd(d, _mm512_maskz_permutexvar_pd(0x7F, next1, d));
+			q = _mm512_add_pd(q, _mm512_maskz_permutexvar_pd(0x7F, next1, q));
+			d = _mm512_add_pd(d, _mm512_maskz_permutexvar_pd(0x3F, next2, d));
+			q = _mm512_add_pd(q, _mm512_maskz_permutexvar_pd(0x3F, next2, q));
+			d = _mm512_add_pd(d, _mm512_maskz_permutexvar_pd(0x0F, next4, d));
+			q = _mm512_add_pd(q, _mm512_maskz_permutexvar_pd(0x0F, next4, q));
+			sum = _mm512_add_pd(d, sum);
+			squares = _mm512_add_pd(q, squares);
+
+			q = _mm512_maskz_max_pd(ALL_LANES, _mm512_mul_pd(_mm512_sub_pd(squares, _mm512_mul_pd(_mm512_mul_pd(sum, sum), scale)), scale), zero);
+			_mm512_storeu_pd(width + row - 8, _mm512_mul_pd(_mm512_maskz_sqrt_pd(ALL_LANES, q), times));
+			sum = _mm512_maskz_permutexvar_pd(ALL_LANES, newest, sum);
+			squares = _mm512_maskz_permutexvar_pd(ALL_LANES, newest, squares);
+		}
+
+		for (shifted = _mm512_cvtsd_f64(sum), square = _mm512_cvtsd_f64(squares), row--; row >= bottom; row--)
+		{
+			shifted += (values[row] - s) - (values[row + period] - s);
+			square += (values[row] - s) * (values[row] - s) - (values[row + period] - s) * (values[row + period] - s);
+			variance = (square - shifted * shifted / period) / period;
+			width[row] = sqrt((variance > 0) ? variance : 0) * deviations;
+		}
+	}
+}
+
+/**
+ * See smooth_avx2(). Eight chunks.
+ */
+__attribute__((target("avx512f")))
+static void smooth_avx512(const double *values, long start, double alpha, long keep, double *out)
+{
+	const long lanes = 8;
+	__m512d a, b, e, x;
+	__m512i row, zero, one;
+	double *local;
+	long chunk, t;
+
+	if (start < SIMD_MIN_ROWS)
+	{
+		smooth_scalar(values, start, alpha, keep, out);
+		return;
+	}
+
+	chunk = (start + lanes - 1) / lanes;
+	local = smooth_scratch.reserve((lanes + 1) * chunk);
+
+	a = _mm512_set1_pd(alpha);
+	b = _mm512_set1_pd(1 - alpha);
+	e = _mm512_set_pd(0, 0, 0, 0, 0, 0, 0, values[start]);
+	row = _mm512_set_epi64(start - 1 - 7 * chunk, start - 1 - 6 * chunk, start - 1 - 5 * chunk, start - 1 - 4 * chunk,
+			start - 1 - 3 * chunk, start - 1 - 2 * chunk, start - 1 - chunk, start - 1);
+	zero = _mm512_setzero_si512();
+	one = _mm512_set1_epi64(1);
+	for (t = 0; t < chunk; t++)
+	{
+		x = _mm512_mask_i64gather_pd(_mm512_setzero_pd(), _mm512_cmpge_epi64_mask(row, zero), row, values, 8);
+		e = _mm512_fmadd_pd(b, e, _mm512_mul_pd(a, x));
+		_mm512_storeu_pd(local + t * lanes, e);
+		row = _mm512_sub_epi64(row, one);
+	}
+
+	smooth_join(local, lanes, chunk, start, alpha, keep, out);
+}
+
+__attribute__((target("avx512f")))
+static double highest_avx512(const double *values, long count)
+{
+	__m512d h0, h1;
+	double ret, lanes[8];
+	long row;
+
+	h0 = h1 = _mm512_set1_pd(values[0]);
+	for (row = 0; row + 16 <= count; row += 16)
+	{
+		h0 = _mm512_maskz_max_pd(ALL_LANES, h0, _mm512_loadu_pd(values + row));
+		h1 = _mm512_maskz_max_pd(ALL_LANES, h1, _mm512_loadu_pd(values + row + 8));
+	}
+	for (; row + 8 <= count; row += 8)
+		h0 = _mm512_maskz_max_pd(ALL_LANES, h0, _mm512_loadu_pd(values + row));
+
+	_mm512_storeu_pd(lanes, _mm512_maskz_max_pd(ALL_LANES, h0, h1));
+	ret = *std::max_element(lanes, lanes + 8);
+	for (; row < count; row++)
+		if (ret < values[row])
+			ret = values[row];
+
+	return ret;
+}
+
+__attribute__((target("avx512f")))
+static double lowest_avx512(const double *values, long count)
+{
+	__m512d l0, l1;
+	double ret, lanes[8];
+	long row;
+
+	l0 = l1 = _mm512_set1_pd(values[0]);
+	for (row = 0; row + 16 <= count; row += 16)
+	{
+		l0 = _mm512_maskz_min_pd(ALL_LANES, l0, _mm512_loadu_pd(values + row));
+		l1 = _mm512_maskz_min_pd(ALL_LANES, l1, _mm512_loadu_pd(values + row + 8));
+	}
+	for (; row + 8 <= count; row += 8)
+		l0 = _mm512_maskz_min_pd(ALL_LANES, l0, _mm512_loadu_pd(values + row));
+
+	_mm512_storeu_pd(lanes, _mm512_maskz_min_pd(ALL_LANES, l0, l1));
+	ret = *std::min_element(lanes, lanes + 8);
+	for (; row < count; row++)
+		if (ret > values[row])
+			ret = values[row];
+
+	return ret;
+}
+
+#endif
+
+static const struct simd_kernels kernels[] = {
+	{simd_scalar, "scalar", mean_scalar, deviation_scalar, smooth_scalar, highest_scalar, lowest_scalar, strength_scalar},
+#ifdef SIMD_X86
+	{simd_avx2, "avx2", mean_avx2, deviation_avx2, smooth_avx2, highest_avx2, lowest_avx2, strength_fast},
+	{simd_avx512, "avx512", mean_avx512, deviation_avx512, smooth_avx512, highest_avx512, lowest_avx512, strength_fast},
+#endif
+};
+
+/**
+ * @return The best kernels that this CPU (and its OS) can run.
+ */
+simd_level simd_supported()
+{
+#ifdef SIMD_X86
+	static const simd_level supported = []() {
+		__builtin_cpu_init();
+		if (__builtin_cpu_supports("avx512f"))
+			return simd_avx512;
+		if (__builtin_cpu_supports("avx2") && __builtin_cpu_supports("fma"))
+			return simd_avx2;
+		return simd_scalar;
+	}();
+
+	return supported;
+#else
+	return simd_scalar;
+#endif
+}
+
+static std::atomic<int> selected(-1);
+
+/**
+ * Use kernels no better than level from now on, in every thread. simd_scalar gives the values that the
+ * indicators gave before they had vector kernels.
+ *
+ * @return The level now in use.
+ */
+simd_level simd_select(simd_level level)
+{
+	if (level > simd_supported())
+		level = simd_supported();
+
+	selected = level;
+	return level;
+}
+
+/**
+ * @return The kernels in use: the best supported, unless simd_select() said otherwise.
+ */
+const struct simd_kernels &simd()
+{
+	int level = selected;
+
+	return kernels[(level < 0) ? simd_supported() : level];
+}
+
+/**
+ * @return The kernels for level, or the best supported ones if this CPU cannot run it.
+ */
+const struct simd_kernels &simd(simd_level level)
+{
+	return kernels[(level > simd_supported()) ? simd_supported() : level];
+}
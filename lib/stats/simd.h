@@ -0,0 +1,39 @@
+#ifndef _simd_h
+#define _simd_h
+/**
+ * Vector kernels behind the indicators, picked for the CPU at run time. Each kernel reads a column newest first,
+ * like the indicators do. The scalar kernels are the loops the indicators have always run, and give the same
+ * values bit for bit. The vector kernels order their arithmetic differently, so they agree with the scalar ones
+ * to within a few ULP (see tests/lib/simd.cpp), except highest() and lowest(), which are exact.
+ * At the vector levels, strength() multiplies where the scalar loop divides, and agrees with it in the same way.
+ */
+enum simd_level {simd_scalar = 0, simd_avx2 = 1, simd_avx512 = 2};
+
+struct simd_kernels {
+	simd_level level;
+	const char *name;
+
+	// out[row] is the mean of values[row] to values[row + period - 1], for every row < start - period.
+	void (*mean)(const double *values, long start, int period, double *out);
+
+	// mean() into middle, and the population standard deviation of each window, times deviations, into width.
+	void (*deviation)(const double *values, long start, int period, int deviations, double *middle, double *width);
+
+	// Starting from e = values[start], e = alpha * values[row] + (1 - alpha) * e for each row from start - 1 down
+	// to 0. out[row] is e for every row < keep.
+	void (*smooth)(const double *values, long start, double alpha, long keep, double *out);
+
+	// The highest or lowest of values[0] to values[count - 1]. count must be positive.
+	double (*highest)(const double *values, long count);
+	double (*lowest)(const double *values, long count);
+
+	// The RSI of the changes from values[start] down to values[0], into out[row] for every row < count. The first
+	// period changes are averaged, then Wilder's smoothing takes over. start must be more than period.
+	void (*strength)(const double *values, long start, int period, long count, double *out);
+};
+
+simd_level simd_supported();
+simd_level simd_select(simd_level level);
+const struct simd_kernels &simd();
+const struct simd_kernels &simd(simd_level level);
+#endif
@@ -1,34 +1,114 @@
+#include <assert.h>
 #include <stdlib.h>
+#include <string.h>
 #include "lib/stats/simple_moving_average.h"
+#include "lib/stats/simd.h"
 
-double *simple_moving_average::generate(const stockinfo &data, int period, long count)
+simple_moving_average::simple_moving_average(int period)
 {
-	double sum = 0, *ret;
-	int row, start;
+	// The window of a longer period would not fit in the state, so such an SMA never takes a bar.
+	assert(period <= STREAM_MAX_PERIOD);
+	state.period = (period > 0) ? period : 20;
+
+	reset();
+}
+
+/**
+ * Allocate and fill in the SMA of count rows. See fill().
+ *
+ * @return series_size(count) values. The caller must free() them.
+ */
+double *simple_moving_average::generate(const stockinfo_view &data, int period, long count)
+{
+	double *ret = (double *)malloc(sizeof(double) * series_size(count));
+
+	fill(data, period, count, ret);
+
+	return ret;
+}
+
+/**
+ * Write the SMA of the newest count rows into out, which holds series_size(count) values.
+ *
+ * @return The number of values, from out[0], that have a full period behind them. The rest are 0.
+ */
+long simple_moving_average::fill(const stockinfo_view &data, int period, long count, double *out)
+{
+	long start;
 	long rows = data.length();
 
+	memset(out, 0, sizeof(double) * series_size(count));
 	if ((count <= 0) || (rows <= period + 1))
-	{
-		ret = (double *)malloc(sizeof(double));
-		ret[0] = 0;
-		return ret;
-	}
-
-	ret = (double *)malloc(sizeof(double) * (count + 1));
-	ret[count] = 0;
+		return 0;
 
 	start = (period + count < rows) ? period + count : rows;
+	simd().mean(data.closes(), start, period, out);
+
+	return start - period;
+}
 
-	for (row = start - 1; row >= 0; row--)
-	{
-		sum += data[row]->close;
-		if (row < start - period)
-		{
-			sum -= data[row + period]->close;
-			ret[row] = sum / period;
-		}
+/**
+ * Forget every bar, but keep the period.
+ */
+void simple_moving_average::reset()
+{
+	int period = state.period;
 
-	}
+	memset(&state, 0, sizeof(state));
+	state.period = period;
+}
 
-	return ret;
+/**
+ * Add the next bar. The window is a ring of the last period closes, and the sum is kept as closes enter and
+ * leave it.
+ *
+ * @param close The close of the new bar.
+ * @param day The day of the new bar, for advance().
+ * @return The SMA as of the new bar. See value().
+ */
+double simple_moving_average::update(double close, int32_t day)
+{
+	double *slot;
+
+	if (state.period > STREAM_MAX_PERIOD)
+		return 0;
+
+	slot = &state.window[state.bars % state.period];
+	if (state.bars++ >= state.period)
+		state.sum -= *slot;
+
+	*slot = close;
+	state.sum += close;
+	state.close = close;
+	state.day = day;
+
+	return value();
+}
+
+/**
+ * Feed in the rows of data after the last bar. See stream_advance().
+ */
+long simple_moving_average::advance(const stockinfo_view &data, int32_t since)
+{
+	return stream_advance(*this, data, since);
+}
+
+/**
+ * @return The SMA as of the last bar. 0 until there are more than period + 1 bars, like generate().
+ */
+double simple_moving_average::value() const
+{
+	return (state.bars > state.period + 1) ? state.sum / state.period : 0;
+}
+
+/**
+ * Carry on from a snapshot() of an SMA with the same period.
+ */
+bool simple_moving_average::restore(const simple_moving_average_state &saved)
+{
+	if ((saved.period != state.period) || (saved.bars < 0))
+		return false;
+
+	state = saved;
+	return true;
 }
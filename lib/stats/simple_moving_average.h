@@ -1,7 +1,35 @@
 #include "lib/stock.h"
+#include "lib/stats/stream.h"
+#include "lib/stats/series.h"
+
+#ifndef _simple_moving_average_h
+#define _simple_moving_average_h
+// Everything a streaming SMA needs to carry on from its last bar, including the closes in its window.
+struct simple_moving_average_state {
+	int32_t period;
+	int32_t day;
+	int64_t bars;
+	double close;
+	double sum;
+	double window[STREAM_MAX_PERIOD];
+};
 
 class simple_moving_average
 {
 	public:
-		double *generate(const stockinfo &data, int period = 20, long count = 0);
+		simple_moving_average(int period = 20);
+		double *generate(const stockinfo_view &data, int period = 20, long count = 0);
+		long fill(const stockinfo_view &data, int period, long count, double *out);
+
+		// Streaming, one bar at a time, oldest first. The period has to be at most STREAM_MAX_PERIOD.
+		void reset();
+		double update(double close, int32_t day = 0);
+		long advance(const stockinfo_view &data, int32_t since = INT32_MAX);
+		double value() const;
+		const simple_moving_average_state &snapshot() const { return state; }
+		bool restore(const simple_moving_average_state &saved);
+
+	private:
+		simple_moving_average_state state;
 };
+#endif
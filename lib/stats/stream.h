@@ -0,0 +1,45 @@
+#include <stdint.h>
+#include "lib/stock.h"
+
+#ifndef _stream_h
+#define _stream_h
+// The longest window that a streaming indicator keeps in its state.
+#define STREAM_MAX_PERIOD 200
+
+/**
+ * Feed a streaming indicator the rows of data that are newer than the last bar it saw, oldest first. The bars it
+ * saw have to be the oldest rows of data, as they were. Only the last of them is read again: if data does not have
+ * it, with the same close, or has more or fewer rows up to it, the indicator starts over from the oldest row. So it
+ * does if since is on or before the last bar it saw, because one of the bars it saw has changed.
+ *
+ * @param indicator Anything with snapshot(), reset() and update(close, day). The snapshot has day, bars and close.
+ * @param data The rows, in order.
+ * @param since The oldest day of data that was added or changed since the indicator last saw it, as for
+ *     stockinfo::roll_forward(). By default, only rows newer than the last bar it saw are new.
+ * @return The number of bars fed in.
+ */
+template<class T>
+long stream_advance(T &indicator, const stockinfo_view &data, int32_t since = INT32_MAX) {
+	const int32_t *days = data.days();
+	const double *closes = data.closes();
+	long rows = data.length(), start = rows, x;
+
+	if (!data.sorted())
+		return 0;
+
+	if (indicator.snapshot().bars > 0) {
+		for (start = 0; (start < rows) && (days[start] > indicator.snapshot().day); start++);
+
+		if ((start == rows) || (days[start] != indicator.snapshot().day) || (rows - start != indicator.snapshot().bars) ||
+				(closes[start] != indicator.snapshot().close) || (since <= indicator.snapshot().day)) {
+			indicator.reset();
+			start = rows;
+		}
+	}
+
+	for (x = start - 1; x >= 0; x--)
+		indicator.update(closes[x], days[x]);
+
+	return start;
+}
+#endif
@@ -1,95 +1,144 @@
 #include <sys/stat.h>
+#include <sys/mman.h>
+#include <signal.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <errno.h>
+#include <string.h>
 #include <stdlib.h>
 #include <stdio.h>
 #include <time.h>
+#include <assert.h>
 #include <algorithm>
 #include <chrono>
+#include <functional>
 
 #include <boost/log/trivial.hpp>
-#include <boost/date_time/gregorian/gregorian.hpp>
 
 #include "lib/comma_separated_values.h"
+#include "lib/bar_file.h"
+#include "lib/calendar.h"
 #include "lib/stock.h"
 
+static_assert(sizeof(time_t) == sizeof(int64_t), "Bar logs store timestamps as 64-bit values.");
+static_assert(sizeof(long) == sizeof(int64_t), "Bar files store volumes as 64-bit values.");
+static_assert(sizeof(struct stock_date) == BAR_FILE_DATE_WIDTH, "Bar log dates are fixed-width.");
+static_assert(sizeof(struct bar_log_record) == BAR_FILE_ALIGN, "Bar log records are one cache line each.");
+
+// Build with -DSTOCKINFO_CHECK_ORDER to re-check the order flags after every change. This scans every row.
+#ifdef STOCKINFO_CHECK_ORDER
+#define CHECK_ORDER() assert(check_order())
+#else
+#define CHECK_ORDER()
+#endif
+
+/**
+ * Update the order flags of c after rows [from, to) were inserted. Only those rows and their neighbours can
+ * break the order, so nothing else is checked.
+ */
+static void track_order(struct stock_columns &c, const long from, const long to) {
+	long x, end = std::min(to, (long)c.day_col.size() - 1);
+
+	for (x = std::max(from, 1L); c.sorted && (x <= end); x++) {
+		if (c.day_col[x-1] < c.day_col[x])
+			c.sorted = c.unique = false;
+		else if (c.day_col[x-1] == c.day_col[x])
+			c.unique = false;
+	}
+}
+
 /**
  * Class setup.
  */
-stockinfo::stockinfo(const stockinfo &init): orig_filename(nullptr), dirty(false) {
+stockinfo::stockinfo(): cols(empty_columns()), orig_filename(nullptr), dirty(false), persisted(0), log_rows(0) {
+}
+
+/**
+ * Share a set of columns, such as a cached roll-up.
+ */
+stockinfo::stockinfo(const std::shared_ptr<stock_columns> &cols): cols(cols), orig_filename(nullptr), dirty(cols->day_col.size() > 0), persisted(0), log_rows(0) {
+}
+
+/**
+ * Share the rows of init. Neither copy duplicates them until it is changed.
+ */
+stockinfo::stockinfo(const stockinfo &init): orig_filename(nullptr), dirty(false), persisted(0), log_rows(0) {
 	copy(init);
 }
 
 /**
- * Class clean-up.
+ * Take over the rows, and the file they came from, of init. init is left empty.
  */
-stockinfo::~stockinfo() {
-	long x, sz = data.size();;
-	for (x = 0; x < sz; x++) {
-		free(data[x].date);
+stockinfo::stockinfo(stockinfo &&init): cols(empty_columns()), orig_filename(nullptr), dirty(false), persisted(0), log_rows(0) {
+	take(init);
+}
+
+/**
+ * Copy the rows of a view. A view of every row shares them instead.
+ */
+stockinfo::stockinfo(const stockinfo_view &view): orig_filename(nullptr), dirty(view.length() > 0), persisted(0), log_rows(0) {
+	if (view.cols && (view.offset == 0) && (view.rows == (long)view.cols->day_col.size())) {
+		cols = std::const_pointer_cast<stock_columns>(view.cols);
+		return;
 	}
 
+	cols = std::make_shared<stock_columns>();
+	cols->day_col.assign(view.days(), view.days() + view.length());
+	cols->open_col.assign(view.opens(), view.opens() + view.length());
+	cols->high_col.assign(view.highs(), view.highs() + view.length());
+	cols->low_col.assign(view.lows(), view.lows() + view.length());
+	cols->close_col.assign(view.closes(), view.closes() + view.length());
+	cols->volume_col.assign(view.volumes(), view.volumes() + view.length());
+
+	// Any run of ordered rows is still in order.
+	cols->sorted = view.cols ? view.cols->sorted : true;
+	cols->unique = view.cols ? view.cols->unique : true;
+	CHECK_ORDER();
+}
+
+/**
+ * Class clean-up.
+ */
+stockinfo::~stockinfo() {
 	if (orig_filename != nullptr) {
 		free(orig_filename);
 	}
 }
 
 /**
- * Load a CSV file into the data struct.
+ * Load a CSV file into the data struct. The file is mapped into memory and parsed in place.
  */
 bool stockinfo::load_csv(const char *filename) {
 	comma_separated_values csv;
-	struct stock *s;
 	struct stat buf;
-	char *tmp, *ret = nullptr;
-	long x, rows;
-	FILE *re;
+	const char *map;
+	int fd;
 
 	// Ensure that the file exists before we load it.
-	if (stat(filename, &buf)) {
+	if ((fd = open(filename, O_RDONLY)) == -1) {
 		BOOST_LOG_TRIVIAL(trace) << "Unable to load CSV file: " << filename;
 		return false;
 	}
 
 	// Prep for the save_csv command.
-	x = strlen(filename);
-	orig_filename = (char *)malloc(x + 1);
-	strcpy(orig_filename, filename);
-	dirty = false;
+	set_filename(filename);
 
 	BOOST_LOG_TRIVIAL(trace) << "Reading stock data from: " << filename;
 
-	// Load the entire file into memory.
-	re = fopen(filename, "r");
-	tmp = (char *)malloc(2048);
-	while (fgets(tmp, 2048, re) != NULL) {
-		if (ret == nullptr) {
-			ret = (char *)malloc(strlen(tmp) + 1);
-			*ret = '\0';
-		}
-		else
-			ret = (char *)realloc(ret, strlen(ret) + strlen(tmp) + 1);
-
-		strcat(ret, tmp);
-	}
-
-	// File cleanup.
-	fclose(re);
-	free(tmp);
-
 	// Parse any CSV data in the file.
-	if (ret != nullptr) {
-		s = csv.parse(ret, &rows);
-		for (x = 0; x < rows; x++) {
-			s[x].timestamp = parse_csv_time(s[x].date);
-			data.push_back(s[x]);
-		}
-
-		// Free the file memory.
-		free(ret);
+	if ((fstat(fd, &buf) == 0) && (buf.st_size > 0)) {
+		map = (const char *)mmap(nullptr, buf.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+		if (map != MAP_FAILED) {
+			csv.parse(map, map + buf.st_size, *this);
+			munmap((void *)map, buf.st_size);
+		} else
+			BOOST_LOG_TRIVIAL(error) << "Unable to map CSV file " << filename << ": " << strerror(errno);
 	}
 
+	close(fd);
 	uniq();
 
-	BOOST_LOG_TRIVIAL(trace) << "Loaded records: " << data.size();
+	BOOST_LOG_TRIVIAL(trace) << "Loaded records: " << length();
 	return true;
 }
 
@@ -101,6 +150,7 @@ bool stockinfo::load_csv(const char *filename) {
  */
 bool stockinfo::save_csv(const char *filename) {
 	const char *fn = (filename == nullptr) ? orig_filename : filename;
+	struct stock_date date;
 	long x, sz;
 	FILE *wr;
 
@@ -111,23 +161,27 @@ bool stockinfo::save_csv(const char *filename) {
 	}
 
 	// Do not re-save if nothing has changed.
-	if (!dirty && (strcmp(fn, orig_filename) == 0)) {
+	if (!dirty && (orig_filename != nullptr) && (strcmp(fn, orig_filename) == 0)) {
 		BOOST_LOG_TRIVIAL(trace) << "No changes since we read the file. Skipping save operation.";
 		return false;
 	}
 
-	BOOST_LOG_TRIVIAL(trace) << "Writing stock data to: " << filename;
+	BOOST_LOG_TRIVIAL(trace) << "Writing stock data to: " << fn;
 
 	// Prepare to write.
 	nosig();
-	wr = fopen(filename, "w");
-	sz = data.size();
+	if ((wr = fopen(fn, "w")) == NULL) {
+		BOOST_LOG_TRIVIAL(error) << "Unable to open " << fn << " for writing: " << strerror(errno);
+		sig();
+		return false;
+	}
+	sz = length();
 
 	// Write the data.
 	for (x = 0; x < sz; x++)
 	{
-		if (data[x].date)
-			fprintf(wr, "%s,%g,%g,%g,%g,%li\n", data[x].date, data[x].open, data[x].high, data[x].low, data[x].close, data[x].volume);
+		format_civil_date(cols->day_col[x], date.text);
+		fprintf(wr, "%s,%g,%g,%g,%g,%li\n", date.text, cols->open_col[x], cols->high_col[x], cols->low_col[x], cols->close_col[x], cols->volume_col[x]);
 	}
 
 	// Clean up.
@@ -137,6 +191,300 @@ bool stockinfo::save_csv(const char *filename) {
 	return true;
 }
 
+/**
+ * Load a binary bar file (see lib/bar_file.h) into the data struct. The file is mapped into memory and
+ * each column is copied out in one piece, so there is nothing to parse.
+ *
+ * @param filename The file to read.
+ * @return boolean. True if the file existed and was valid.
+ */
+bool stockinfo::load_bars(const char *filename) {
+	struct stat buf;
+	const char *map;
+	int fd;
+
+	if ((fd = open(filename, O_RDONLY)) == -1) {
+		BOOST_LOG_TRIVIAL(trace) << "Unable to load bar file: " << filename;
+		return false;
+	}
+
+	if ((fstat(fd, &buf) == -1) || (buf.st_size < (off_t)sizeof(struct bar_file_header))) {
+		BOOST_LOG_TRIVIAL(error) << "Bar file is too short: " << filename;
+		close(fd);
+		return false;
+	}
+
+	map = (const char *)mmap(nullptr, buf.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+	close(fd);
+	if (map == MAP_FAILED) {
+		BOOST_LOG_TRIVIAL(error) << "Unable to map bar file " << filename << ": " << strerror(errno);
+		return false;
+	}
+
+	BOOST_LOG_TRIVIAL(trace) << "Reading stock data from: " << filename;
+
+	if (!read_bars(map, buf.st_size)) {
+		BOOST_LOG_TRIVIAL(error) << "Unrecognized bar file: " << filename;
+		munmap((void *)map, buf.st_size);
+		return false;
+	}
+
+	munmap((void *)map, buf.st_size);
+
+	// Prep for the save_bars command.
+	set_filename(filename);
+
+	// Replay any daily updates that were appended since the file was last written.
+	read_log(filename);
+	persisted = length();
+	dirty = false;
+
+	BOOST_LOG_TRIVIAL(trace) << "Loaded records: " << length();
+	return true;
+}
+
+/**
+ * Copy the columns of an in-memory bar file image into the data struct.
+ *
+ * @param map The start of the image (the bar file header).
+ * @param size The number of readable bytes at map.
+ * @return boolean. False if the image is not a valid bar file.
+ */
+bool stockinfo::read_bars(const char *map, const uint64_t size) {
+	const struct bar_file_header *header = (const struct bar_file_header *)map;
+	struct bar_file_columns layout;
+	long rows;
+
+	if (!bar_file_valid(header, size))
+		return false;
+
+	rows = header->rows;
+	layout = bar_file_layout(rows);
+	cols = std::make_shared<stock_columns>();
+	cols->day_col.assign((const int32_t *)(map + layout.day), (const int32_t *)(map + layout.day) + rows);
+	cols->open_col.assign((const double *)(map + layout.open), (const double *)(map + layout.open) + rows);
+	cols->high_col.assign((const double *)(map + layout.high), (const double *)(map + layout.high) + rows);
+	cols->low_col.assign((const double *)(map + layout.low), (const double *)(map + layout.low) + rows);
+	cols->close_col.assign((const double *)(map + layout.close), (const double *)(map + layout.close) + rows);
+	cols->volume_col.assign((const long *)(map + layout.volume), (const long *)(map + layout.volume) + rows);
+	track_order(*cols, 0, rows);
+	persisted = 0;
+	log_rows = 0;
+	CHECK_ORDER();
+
+	return true;
+}
+
+/**
+ * Apply the bar log that belongs to filename, if there is one. Records are stored oldest first, so they
+ * are reversed and put in front of the rows read from the bar file in one insert.
+ *
+ * @param filename The bar file. The log is "<filename>.log".
+ * @return boolean. True if a valid log was applied.
+ */
+bool stockinfo::read_log(const char *filename) {
+	const struct bar_log_record *records;
+	struct stock *s;
+	struct stat buf;
+	const char *map;
+	char *log_filename;
+	long x, rows;
+	bool ordered;
+	int fd;
+
+	log_filename = (char *)malloc(strlen(filename) + 5);
+	sprintf(log_filename, "%s.log", filename);
+	fd = open(log_filename, O_RDONLY);
+	free(log_filename);
+
+	if (fd == -1)
+		return false;
+
+	if ((fstat(fd, &buf) == -1) || (buf.st_size < (off_t)sizeof(struct bar_file_header)) ||
+	    ((map = (const char *)mmap(nullptr, buf.st_size, PROT_READ, MAP_PRIVATE, fd, 0)) == MAP_FAILED)) {
+		BOOST_LOG_TRIVIAL(error) << "Unable to read the log for " << filename;
+		close(fd);
+
+		// Make the next save rewrite the bar file, which removes the log.
+		log_rows = BAR_LOG_COMPACT_ROWS;
+		return false;
+	}
+	close(fd);
+
+	if (!bar_log_valid((const struct bar_file_header *)map, buf.st_size)) {
+		BOOST_LOG_TRIVIAL(error) << "Unrecognized bar log for " << filename;
+		munmap((void *)map, buf.st_size);
+		log_rows = BAR_LOG_COMPACT_ROWS;
+		return false;
+	}
+
+	// A torn final record is dropped. Compaction rewrites the log out of existence.
+	records = (const struct bar_log_record *)(map + sizeof(struct bar_file_header));
+	rows = (buf.st_size - sizeof(struct bar_file_header)) / sizeof(struct bar_log_record);
+	if ((buf.st_size - sizeof(struct bar_file_header)) % sizeof(struct bar_log_record) != 0)
+		log_rows = BAR_LOG_COMPACT_ROWS;
+
+	s = (struct stock *)malloc(sizeof(struct stock) * (rows + 1));
+	for (x = 0; x < rows; x++) {
+		const struct bar_log_record *r = &records[rows - x - 1];
+
+		s[x].date = nullptr;
+		s[x].timestamp = r->timestamp;
+		s[x].open = r->open;
+		s[x].high = r->high;
+		s[x].low = r->low;
+		s[x].close = r->close;
+		s[x].volume = r->volume;
+	}
+
+	store(s, rows, 0);
+	free(s);
+
+	ordered = true;
+	for (x = 0; (x < rows) && (x + 1 < length()); x++)
+		if (cols->day_col[x] <= cols->day_col[x+1])
+			ordered = false;
+
+	munmap((void *)map, buf.st_size);
+
+	// Logs of calendar bars replace the latest bar (see roll_forward()), so they can overlap the bar file and
+	// themselves. The newest record of a day is first, which is the one uniq() keeps.
+	if (!ordered)
+		uniq();
+
+	if (log_rows < BAR_LOG_COMPACT_ROWS)
+		log_rows = rows;
+
+	BOOST_LOG_TRIVIAL(trace) << "Applied " << rows << " logged records for " << filename;
+	return true;
+}
+
+/**
+ * Append the newest rows to the log of filename, oldest first.
+ *
+ * @param filename The bar file. The log is "<filename>.log".
+ * @param rows The number of rows, counted from index 0, to write.
+ * @return boolean. True if every record was written.
+ */
+bool stockinfo::append_log(const char *filename, const long rows) {
+	struct bar_file_header header = bar_log_new_header();
+	struct bar_log_record record;
+	char *log_filename;
+	long x, pos;
+	bool ret;
+	FILE *wr;
+
+	log_filename = (char *)malloc(strlen(filename) + 5);
+	sprintf(log_filename, "%s.log", filename);
+	wr = fopen(log_filename, "a");
+	free(log_filename);
+
+	if (wr == NULL) {
+		BOOST_LOG_TRIVIAL(error) << "Unable to open the log for " << filename << ": " << strerror(errno);
+		return false;
+	}
+
+	// A new log starts with its header.
+	pos = ftell(wr);
+	ret = (pos >= 0) && ((pos > 0) || (fwrite(&header, sizeof(header), 1, wr) == 1));
+
+	for (x = rows - 1; ret && (x >= 0); x--) {
+		record.timestamp = (int64_t)cols->day_col[x] * SECONDS_PER_DAY;
+		record.open = cols->open_col[x];
+		record.high = cols->high_col[x];
+		record.low = cols->low_col[x];
+		record.close = cols->close_col[x];
+		record.volume = cols->volume_col[x];
+		memset(record.date, 0, sizeof(record.date));
+		format_civil_date(cols->day_col[x], record.date);
+
+		ret = (fwrite(&record, sizeof(record), 1, wr) == 1);
+	}
+
+	return (fclose(wr) == 0) && ret;
+}
+
+/**
+ * Save the data struct as a binary bar file (see lib/bar_file.h).
+ *
+ * @param filename. Optional if load_bars() was called first.
+ * @return boolean. True if save was successful.
+ */
+bool stockinfo::save_bars(const char *filename) {
+	const char *fn = (filename == nullptr) ? orig_filename : filename;
+	bool ret, same = false;
+	char *log_filename;
+	long x, fresh;
+	FILE *wr;
+
+	// We cannot save unless we have a filename.
+	if (fn == nullptr) {
+		BOOST_LOG_TRIVIAL(trace) << "No filename provided. Unable to save.";
+		return false;
+	}
+
+	// Do not re-save if nothing has changed.
+	if (!dirty && (orig_filename != nullptr) && (strcmp(fn, orig_filename) == 0)) {
+		BOOST_LOG_TRIVIAL(trace) << "No changes since we read the file. Skipping save operation.";
+		return false;
+	}
+
+	BOOST_LOG_TRIVIAL(trace) << "Writing stock data to: " << fn;
+
+	// Rows that are newer than everything in the file can go in its log, until the log is due for compaction.
+	fresh = 0;
+	if ((orig_filename != nullptr) && (strcmp(fn, orig_filename) == 0) && (persisted > 0)) {
+		same = true;
+		fresh = length() - persisted;
+		for (x = 0; x < fresh; x++)
+			if (cols->day_col[x] <= cols->day_col[x+1])
+				fresh = 0;
+		if (log_rows + fresh >= BAR_LOG_COMPACT_ROWS)
+			fresh = 0;
+	}
+
+	// Prepare to write.
+	nosig();
+	if (fresh > 0) {
+		BOOST_LOG_TRIVIAL(trace) << "Appending " << fresh << " records to the log.";
+		if ((ret = append_log(fn, fresh)))
+			log_rows += fresh;
+	} else {
+		if ((wr = fopen(fn, "w")) == NULL) {
+			BOOST_LOG_TRIVIAL(error) << "Unable to open " << fn << " for writing: " << strerror(errno);
+			sig();
+			return false;
+		}
+
+		ret = write_bars(wr);
+		ret = (fclose(wr) == 0) && ret;
+
+		// The file now holds everything that was in its log.
+		log_filename = (char *)malloc(strlen(fn) + 5);
+		sprintf(log_filename, "%s.log", fn);
+		if (ret && (unlink(log_filename) == -1) && (errno != ENOENT)) {
+			BOOST_LOG_TRIVIAL(error) << "Unable to remove " << log_filename << ": " << strerror(errno);
+			ret = false;
+		}
+		free(log_filename);
+
+		if (ret && same)
+			log_rows = 0;
+	}
+
+	// Clean up.
+	sig();
+
+	if (!ret)
+		BOOST_LOG_TRIVIAL(error) << "Failed to write " << fn;
+	else if (same) {
+		persisted = length();
+		dirty = false;
+	}
+
+	return ret;
+}
+
 /**
  * Insert stock element at the desired pos. Moves any later elements up by 1, which can be slow.
  *
@@ -145,24 +493,59 @@ bool stockinfo::save_csv(const char *filename) {
  * @return A pointer to this class instance.
  */
 stockinfo &stockinfo::insert_at(const struct stock s, const long pos) {
-	struct stock tmp;
+	store(&s, 1, pos);
 
-	// Make our own copy of the data.
-	memcpy(&tmp, &s, sizeof(s));
-	if (s.date != nullptr) {
-		tmp.date = (char *)malloc(strlen(s.date));
-		strcpy(tmp.date, s.date);
+	// The data structure should be saved.
+	dirty = true;
 
-		// Parse the date into a timestamp, if needed.
-		tmp.timestamp = parse_csv_time(tmp.date);
-	}
+	return *this;
+}
 
-	// Retrieve an iterator that points to our insertion point.
-	std::vector<struct stock>::iterator p = data.begin();
-	p += pos;
+/**
+ * Insert count stock elements at the desired pos, in the order given. Later elements only move once.
+ *
+ * @param struct stock *s The elements to insert.
+ * @param long count The number of elements in s.
+ * @param long pos The place to insert s (default: 0).
+ * @return A pointer to this class instance.
+ */
+stockinfo &stockinfo::insert_at(const struct stock *s, const long count, const long pos) {
+	if (count <= 0)
+		return *this;
 
-	// Insert tmp.
-	data.insert(p, tmp);
+	store(s, count, pos);
+
+	// The data structure should be saved.
+	dirty = true;
+
+	return *this;
+}
+
+/**
+ * Insert every row of s at the desired pos, in the order given.
+ *
+ * @param stockinfo s The rows to insert.
+ * @param long pos The place to insert s (default: 0).
+ * @return A pointer to this class instance.
+ */
+stockinfo &stockinfo::insert_at(const stockinfo &s, const long pos) {
+	if ((s.length() == 0) || (this == &s))
+		return *this;
+
+	detach();
+
+	// Rows after the insert point are no longer the ones that were saved.
+	if (pos > length() - persisted)
+		persisted = 0;
+
+	cols->day_col.insert(cols->day_col.begin() + pos, s.cols->day_col.begin(), s.cols->day_col.end());
+	cols->open_col.insert(cols->open_col.begin() + pos, s.cols->open_col.begin(), s.cols->open_col.end());
+	cols->high_col.insert(cols->high_col.begin() + pos, s.cols->high_col.begin(), s.cols->high_col.end());
+	cols->low_col.insert(cols->low_col.begin() + pos, s.cols->low_col.begin(), s.cols->low_col.end());
+	cols->close_col.insert(cols->close_col.begin() + pos, s.cols->close_col.begin(), s.cols->close_col.end());
+	cols->volume_col.insert(cols->volume_col.begin() + pos, s.cols->volume_col.begin(), s.cols->volume_col.end());
+	track_order(*cols, pos, pos + s.length());
+	CHECK_ORDER();
 
 	// The data structure should be saved.
 	dirty = true;
@@ -174,50 +557,70 @@ stockinfo &stockinfo::insert_at(const struct stock s, const long pos) {
  * Return the number of items in the data struct.
  */
 const long stockinfo::length() const {
-	return data.size();
+	return cols->day_col.size();
 }
 const long stockinfo::length() {
-	return data.size();
+	return cols->day_col.size();
 }
 
 /**
  * Remove the first element and return it.
+ *
+ * @note The returned date is a copy that the caller must free().
  */
 struct stock stockinfo::shift() {
-	struct stock ret;
+	struct stock ret = {};
 
-	if (data.size() > 0) {
-		memcpy(&ret, &data[0], sizeof(data[0]));
-		if (data[0].date != nullptr) {
-			ret.date = (char *)malloc(strlen(data[0].date));
-			strcpy(ret.date, data[0].date);
-		}
+	if (length() > 0) {
+		ret = *(*this)[0];
+		ret.date = (char *)malloc(sizeof(struct stock_date));
+		format_civil_date(cols->day_col[0], ret.date);
+
+		erase(0);
+		dirty = true;
 	}
 
 	return ret;
 }
 
+/**
+ * Gather row index from each column.
+ */
+static stock_row gather_row(const struct stock_columns &cols, const long index) {
+	struct stock ret;
+
+	ret.date = nullptr;
+	ret.timestamp = (time_t)cols.day_col[index] * SECONDS_PER_DAY;
+	ret.open = cols.open_col[index];
+	ret.high = cols.high_col[index];
+	ret.low = cols.low_col[index];
+	ret.close = cols.close_col[index];
+	ret.volume = cols.volume_col[index];
+
+	return stock_row(ret);
+}
+
 /**
  * Allow us to read data from the data struct.
  *
  * @param index The desired data point.
  * @return The data point requested. nullptr if index does not exist.
  */
-const struct stock *stockinfo::operator [](const long index) const {
-	if (index < 0 || index >= data.size()) {
-		if (data.size() == 0) {
+const stock_row stockinfo::operator [](const long index) const {
+	if (index < 0 || index >= length()) {
+		if (length() == 0) {
 			BOOST_LOG_TRIVIAL(trace) << "Tried to access record " << index << " but no records exist!";
 		} else {
-			BOOST_LOG_TRIVIAL(trace) << "Tried to access record " << index << " but highest record is " << data.size() - 1 << "!";
+			BOOST_LOG_TRIVIAL(trace) << "Tried to access record " << index << " but highest record is " << length() - 1 << "!";
 		}
-		return nullptr;
+		return stock_row();
 	}
 
-	return &data[index];
+	return gather_row(*cols, index);
 }
-const struct stock *stockinfo::operator [](const long index) {
+const stock_row stockinfo::operator [](const long index) {
 	// Scott Meyers on reducing code duplication. https://stackoverflow.com/a/123995/850782
-	return const_cast<struct stock *>(static_cast<const stockinfo &>(*this)[index]);
+	return static_cast<const stockinfo &>(*this)[index];
 }
 
 /**
@@ -226,20 +629,7 @@ const struct stock *stockinfo::operator [](const long index) {
  * @return Pointer to the current class instance.
  */
 stockinfo &stockinfo::operator +=(const struct stock s) {
-	struct stock tmp;
-
-	// Make our own copy of the data.
-	memcpy(&tmp, &s, sizeof(s));
-	if (s.date != nullptr) {
-		tmp.date = (char *)malloc(strlen(s.date));
-		strcpy(tmp.date, s.date);
-
-		// Parse the date into a timestamp, if needed.
-		tmp.timestamp = parse_csv_time(tmp.date);
-	}
-
-	// Insert tmp.
-	data.push_back(tmp);
+	store(&s, 1, length());
 
 	// The data structure should be saved.
 	dirty = true;
@@ -248,148 +638,305 @@ stockinfo &stockinfo::operator +=(const struct stock s) {
 }
 
 stockinfo &stockinfo::operator =(const stockinfo &s) {
-	copy(s);
+	if (this != &s)
+		copy(s);
+
+	return *this;
+}
+
+stockinfo &stockinfo::operator =(stockinfo &&s) {
+	if (this != &s)
+		take(s);
+
 	return *this;
 }
 
 /**
- * Sort the data structure by timestamp, then check for duplicate timestamps.
+ * Copy row x of one set of columns onto the end of another.
+ */
+static void append_row(struct stock_columns &to, const struct stock_columns &from, const long x) {
+	to.day_col.push_back(from.day_col[x]);
+	to.open_col.push_back(from.open_col[x]);
+	to.high_col.push_back(from.high_col[x]);
+	to.low_col.push_back(from.low_col[x]);
+	to.close_col.push_back(from.close_col[x]);
+	to.volume_col.push_back(from.volume_col[x]);
+}
+
+/**
+ * Check whether two rows hold the same bar.
+ */
+static bool same_row(const struct stock_columns &a, const long x, const struct stock_columns &b, const long y) {
+	return (a.day_col[x] == b.day_col[y]) && (a.open_col[x] == b.open_col[y]) && (a.high_col[x] == b.high_col[y]) &&
+	       (a.low_col[x] == b.low_col[y]) && (a.close_col[x] == b.close_col[y]) && (a.volume_col[x] == b.volume_col[y]);
+}
+
+/**
+ * Sort the data structure by day, then remove duplicate days in one pass. The first row of each day is kept.
+ * Sorting is stable, so that is the row that was nearest the front, which is where new rows are inserted.
  *
  * @return Pointer to the current class instance.
  */
 stockinfo &stockinfo::uniq() {
-	long x, length;
+	long x, kept, last = -1, length;
 
-	// The data must be sorted by timestamp before we can check for duplicate timestamps.
+	if (cols->unique)
+		return *this;
+
+	// The data must be sorted by day before we can check for duplicate days.
 	sort();
 
-	// Check neighbors for duplicate timestamps.
-	length = data.size() - 1;
-	for (x = 0; x < length; x++) {
-		// Determine if the next element matches the current timestamp.
-		if (data[x].timestamp == data[x+1].timestamp) {
-			BOOST_LOG_TRIVIAL(info) << "Removing duplicate: " << x;
+	// Leave data without duplicates alone.
+	length = this->length();
+	for (x = 1; (x < length) && (cols->day_col[x] != cols->day_col[x-1]); x++);
+	if (x >= length) {
+		cols->unique = true;
+		return *this;
+	}
+
+	// Slide each row we keep down over the duplicates.
+	detach();
+	for (kept = x; x < length; x++) {
+		if (cols->day_col[x] == cols->day_col[kept-1]) {
+			last = x;
+			continue;
+		}
+
+		cols->day_col[kept] = cols->day_col[x];
+		cols->open_col[kept] = cols->open_col[x];
+		cols->high_col[kept] = cols->high_col[x];
+		cols->low_col[kept] = cols->low_col[x];
+		cols->close_col[kept] = cols->close_col[x];
+		cols->volume_col[kept] = cols->volume_col[x];
+		kept++;
+	}
+
+	BOOST_LOG_TRIVIAL(info) << "Removed " << (length - kept) << " duplicates.";
+
+	cols->day_col.resize(kept);
+	cols->open_col.resize(kept);
+	cols->high_col.resize(kept);
+	cols->low_col.resize(kept);
+	cols->close_col.resize(kept);
+	cols->volume_col.resize(kept);
+	cols->unique = true;
+	CHECK_ORDER();
+
+	// Only the rows after the last duplicate are still where they were saved.
+	persisted = std::min(persisted, length - last - 1);
+	dirty = true;
+
+	return *this;
+}
+
+/**
+ * Merge a batch of bars into the data structure in one pass over both, dropping duplicate days.
+ *
+ * @param stockinfo incoming The new bars. Any order.
+ * @param merge_policy policy Which bar to keep when both have the same day. Default: newer_wins.
+ * @return Pointer to the current class instance.
+ */
+stockinfo &stockinfo::merge(const stockinfo &incoming, const merge_policy policy) {
+	std::shared_ptr<stock_columns> merged;
+	const struct stock_columns *a, *b;
+	long x = 0, y = 0, a_rows, b_rows, unchanged = 0;
+	bool changed = false;
+	int32_t day;
+
+	if (this == &incoming)
+		return uniq();
 
-			// Remove the duplicate element.
-			std::vector<struct stock>::iterator p = data.begin();
-			p += x;
-			data.erase(p);
+	if (incoming.length() == 0)
+		return *this;
 
-			// We have modified the data structure.
-			dirty = true;
+	// Both sides must be in order.
+	if (!incoming.cols->sorted) {
+		stockinfo sorted(incoming);
+		return merge(sorted.sort(), policy);
+	}
+	sort();
 
-			// Decrease the run length since we removed an element.
-			length--;
+	a = cols.get();
+	b = incoming.cols.get();
+	a_rows = length();
+	b_rows = incoming.length();
+
+	merged = std::make_shared<stock_columns>();
+	merged->day_col.reserve(a_rows + b_rows);
+	merged->open_col.reserve(a_rows + b_rows);
+	merged->high_col.reserve(a_rows + b_rows);
+	merged->low_col.reserve(a_rows + b_rows);
+	merged->close_col.reserve(a_rows + b_rows);
+	merged->volume_col.reserve(a_rows + b_rows);
+
+	while ((x < a_rows) || (y < b_rows)) {
+		// Take the newest day from either side. On a tie, the policy picks the side.
+		if ((y >= b_rows) || ((x < a_rows) && (a->day_col[x] > b->day_col[y]))) {
+			day = a->day_col[x];
+			append_row(*merged, *a, x++);
+			unchanged++;
+		} else if ((x >= a_rows) || (b->day_col[y] > a->day_col[x])) {
+			day = b->day_col[y];
+			append_row(*merged, *b, y++);
+			changed = true;
+			unchanged = 0;
+		} else {
+			day = a->day_col[x];
+			if ((policy == keep_existing) || same_row(*a, x, *b, y)) {
+				append_row(*merged, *a, x);
+				unchanged++;
+			} else {
+				append_row(*merged, *b, y);
+				changed = true;
+				unchanged = 0;
+			}
+			x++;
+			y++;
+		}
+
+		// Anything else for the same day is a duplicate.
+		for (; (x < a_rows) && (a->day_col[x] == day); x++) {
+			changed = true;
+			unchanged = 0;
 		}
+		for (; (y < b_rows) && (b->day_col[y] == day); y++);
 	}
 
+	if (!changed)
+		return *this;
+
+	// The rows after the last change are still the ones that were saved.
+	cols = merged;
+	CHECK_ORDER();
+	persisted = std::min(persisted, unchanged);
+	dirty = true;
+
 	return *this;
 }
 
 /**
- * Sort the data structure by timestamp, in descending order.
+ * Rearrange a column so that row x holds what used to be row order[x].
+ */
+template<class T>
+static void reorder(column<T> &col, const std::vector<long> &order) {
+	column<T> tmp(col.size());
+	long x, length = col.size();
+
+	for (x = 0; x < length; x++)
+		tmp[x] = col[order[x]];
+
+	col.swap(tmp);
+}
+
+/**
+ * Sort the data structure by day, in descending order. Rows with the same day keep their order.
  *
  * @todo Should we update set the dirty flag?
  * @return Pointer to the current class instance.
  */
 stockinfo &stockinfo::sort() {
-	std::sort(data.begin(), data.end(), [](const auto& lhs, const auto& rhs) {
-		return lhs.timestamp > rhs.timestamp;
+	std::vector<long> order;
+	long x;
+
+	if (cols->sorted)
+		return *this;
+	order.resize(length());
+
+	// Sort row numbers rather than rows, then gather every column into the new order.
+	for (x = 0; x < length(); x++)
+		order[x] = x;
+
+	std::stable_sort(order.begin(), order.end(), [this](const long lhs, const long rhs) {
+		return cols->day_col[lhs] > cols->day_col[rhs];
 	});
 
+	// Leave data that is already in order alone, so that it still matches what was saved.
+	for (x = 0; (x < length()) && (order[x] == x); x++);
+	if (x < length()) {
+		persisted = 0;
+		detach();
+
+		reorder(cols->day_col, order);
+		reorder(cols->open_col, order);
+		reorder(cols->high_col, order);
+		reorder(cols->low_col, order);
+		reorder(cols->close_col, order);
+		reorder(cols->volume_col, order);
+	}
+
+	cols->sorted = cols->unique = true;
+	track_order(*cols, 0, length());
+	CHECK_ORDER();
+
 	return *this;
 }
 
 /**
- * NOTE: data must be sorted before this is called.
+ * Check the order flags against the rows. Debug builds call this after every change; see CHECK_ORDER().
+ *
+ * @return boolean. False if the flags claim an order that the rows do not have.
  */
-template<class T>
-stockinfo stockinfo::rollup_iterator(T &iterator, int number) {
-	boost::gregorian::date d;
-	bool add = false, init = true;
-	struct stock tmp;
-	struct tm last;
-	long x, length;
-	stockinfo ret;
-	boost::gregorian::date current_date;
-
-	length = data.size();
-	BOOST_LOG_TRIVIAL(info) << "Rollup size: " << length;
-
-	// Go back to the last [number iterator period] on record.
-	if (length > 0) {
-		localtime_r(&data[0].timestamp, &last);
-		current_date = boost::gregorian::date(last.tm_year + 1900, last.tm_mon + 1, last.tm_mday);
-		x = 0;
-		while (iterator > current_date) {
-			multi_decrement(iterator, number);
-			x++;
-		}
+bool stockinfo::check_order() const {
+	long x;
 
-		BOOST_LOG_TRIVIAL(info) << "First date is " << (x * number) << " periods back.";
+	if (cols->unique && !cols->sorted) {
+		BOOST_LOG_TRIVIAL(error) << "Rows are flagged unique but not sorted.";
+		return false;
 	}
 
-	// Loop through the dates and collect them.
-	for (x = 0; x < length; x++) {
-		localtime_r(&data[x].timestamp, &last);
-		current_date = boost::gregorian::date(last.tm_year + 1900, last.tm_mon + 1, last.tm_mday);
-
-		// Is it time to switch to decrement the iterator?
-		if (iterator >= current_date) {
-			BOOST_LOG_TRIVIAL(info) << "Decrement iterator.";
-			multi_decrement(iterator, number);
-			init = true;
-
-			// New week.
-			if (add)
-				ret += tmp;
-		}
-
-		if (init) {
-			// Re-set the object data for the new week..
-			tmp.open = data[x].open;
-			tmp.high = data[x].high;
-			tmp.low = data[x].low;
-			tmp.close = data[x].close;
-			tmp.volume = data[x].volume;
-			BOOST_LOG_TRIVIAL(info) << "Set high: " << data[x].high << ", low: " << data[x].low << ", volume = " << data[x].volume;
-			init = false;
-		} else {
-			// Update the existing week.
-			if (data[x].high > tmp.high) {
-				BOOST_LOG_TRIVIAL(info) << "Bumped high to: " << data[x].high;
-				tmp.high = data[x].high;
-			}
-			if (data[x].low < tmp.low) {
-				BOOST_LOG_TRIVIAL(info) << "Bumped low to: " << data[x].low;
-				tmp.low = data[x].low;
-			}
-			BOOST_LOG_TRIVIAL(info) << "Added volume: " << data[x].volume;
-			tmp.open = data[x].open;
-			tmp.volume += data[x].volume;
+	for (x = 1; cols->sorted && (x < length()); x++) {
+		if ((cols->day_col[x-1] < cols->day_col[x]) || (cols->unique && (cols->day_col[x-1] == cols->day_col[x]))) {
+			BOOST_LOG_TRIVIAL(error) << "Rows " << (x - 1) << " and " << x << " are out of order.";
+			return false;
 		}
+	}
 
-		// Capture the earliest day of the week.
-		tmp.timestamp = data[x].timestamp;
-		tmp.date = data[x].date;
+	return true;
+}
 
-		// Start saving after the first run.
-		add = true;
+/**
+ * Return the first day after bucket count of a roll-up, counting back from anchor. Bucket 0 ends on anchor.
+ */
+static int32_t bucket_edge(const int32_t anchor, const timeperiods period, const long count) {
+	switch (period) {
+		case day:
+			return anchor - count;
+		case week:
+			return anchor - 7 * count;
+		case month:
+			return add_months(anchor, -count);
+		case quarter:
+			return add_months(anchor, -3 * count);
+		case year:
+			return add_months(anchor, -12 * count);
 	}
 
-	if (add)
-		ret += tmp;
-
-	return ret;
+	return anchor;
 }
 
-template<class T>
-T &stockinfo::multi_decrement(T &iterator, int number) {
-	for (int x = 0; x < number; x++) {
-		--iterator;
+/**
+ * Return the last day of the calendar period that holds a day. Weeks end on Sunday.
+ */
+static int32_t period_end(const int32_t days, const timeperiods period) {
+	unsigned mm, dd;
+	int yy;
+
+	civil_from_days(days, &yy, &mm, &dd);
+	switch (period) {
+		case day:
+			return days;
+		case week:
+			return days + (7 - weekday_from_days(days)) % 7;
+		case month:
+			return days_from_civil(yy, mm, days_in_month(yy, mm));
+		case quarter:
+			mm = (mm + 2) / 3 * 3;
+			return days_from_civil(yy, mm, days_in_month(yy, mm));
+		case year:
+			return days_from_civil(yy, 12, 31);
 	}
 
-	return iterator;
+	return days;
 }
 
 /**
@@ -403,88 +950,395 @@ T &stockinfo::multi_decrement(T &iterator, int number) {
  * @return New stockinfo object.
  */
 stockinfo stockinfo::rollup(int number, timeperiods period, bool align_week) {
-	if (data.size() < 2) {
+	// This only works if the data is in order. It does not necessarily have to be unique...
+	if (length() >= 2)
+		sort();
+
+	return stockinfo_view(*this).rollup(number, period, align_week);
+}
+
+stockinfo stockinfo::weekly(bool align_week) {
+	return rollup(1, week, align_week);
+}
+
+/**
+ * Roll daily data up into calendar weeks (Monday to Sunday), months, quarters or years. Sorts the data first.
+ *
+ * Unlike rollup(), the buckets do not move as new days arrive, so only the latest bar can change.
+ *
+ * @param timeperiods period.
+ * @return New stockinfo object.
+ */
+stockinfo stockinfo::calendar(timeperiods period) {
+	if (length() >= 2)
+		sort();
+
+	return stockinfo_view(*this).calendar(period);
+}
+
+/**
+ * Bring calendar bars (see calendar()) up to date with the daily bars they were made from. Only the latest
+ * bar, and any after it, are rolled up again. Bars that do not start on the first day of daily, or that a
+ * changed day before the latest bar makes stale, are rebuilt.
+ *
+ * Roll-ups of daily use the result from then on, instead of rolling every row up again.
+ *
+ * @param daily The daily bars, in order.
+ * @param period The period of these bars.
+ * @param since The oldest day of daily that was added or changed since these bars were rolled up.
+ * @return Pointer to the current object.
+ */
+stockinfo &stockinfo::roll_forward(const stockinfo &daily, timeperiods period, int32_t since) {
+	const int32_t *days = daily.days();
+	long rows = daily.length(), x;
+	int32_t edge = 0;
+
+	if ((rows == 0) || !daily.sorted())
 		return *this;
+
+	if (length() > 0)
+		edge = bucket_edge(period_end(this->days()[0], period), period, 1);
+
+	if ((length() == 0) || (this->days()[length()-1] != days[rows-1]) || (since <= edge)) {
+		BOOST_LOG_TRIVIAL(trace) << "Rebuilding " << rows << " rows of calendar bars.";
+		copy(stockinfo_view(daily).calendar(period));
+	} else {
+		// Roll up the days from the start of the latest bar onwards.
+		for (x = 0; (x < rows) && (days[x] > edge); x++);
+		merge(stockinfo_view(daily, 0, x).calendar(period));
 	}
 
-	// This only works if the data is in order. It does not necessarily have to be unique...
-	sort();
+	std::lock_guard<std::mutex> guard(daily.cols->rollups.lock);
+	daily.cols->rollups.bars[std::make_tuple(1, (int)period, (int)align_calendar)] = cols;
 
-	struct tm first;
-	localtime_r(&data[0].timestamp, &first);
+	return *this;
+}
 
-	boost::gregorian::date d(first.tm_year + 1900, first.tm_mon + 1, first.tm_mday);
+/**
+ * View every row of data from offset onwards, or length rows of it.
+ */
+stockinfo_view::stockinfo_view(const stockinfo &data, const long offset, const long length): cols(data.cols) {
+	this->offset = std::min(std::max(offset, 0L), data.length());
+	rows = data.length() - this->offset;
+	if ((length >= 0) && (length < rows))
+		rows = length;
+}
 
-	if (align_week) {
-		BOOST_LOG_TRIVIAL(info) << "Boost Sunday alignment start: " << d;
-  	auto at_saturday   = boost::gregorian::greg_weekday(boost::gregorian::Sunday);
-  	d = next_weekday(d, at_saturday);
-		BOOST_LOG_TRIVIAL(info) << "Boost Sunday alignment finish: " << d;
+/**
+ * Allow us to read data from the view.
+ *
+ * @param index The desired data point, relative to the start of the view.
+ * @return The data point requested. nullptr if index does not exist.
+ */
+const stock_row stockinfo_view::operator [](const long index) const {
+	if (index < 0 || index >= rows) {
+		BOOST_LOG_TRIVIAL(trace) << "Tried to access record " << index << " of a view with " << rows << " records!";
+		return stock_row();
 	}
 
-	boost::gregorian::day_iterator itr_day(d);
-	boost::gregorian::week_iterator itr_week(d);
-	boost::gregorian::month_iterator itr_month(d);
-	boost::gregorian::year_iterator itr_year(d);
-	stockinfo ret;
+	return gather_row(*cols, offset + index);
+}
 
-	switch (period) {
-		case day:
-			ret = rollup_iterator(itr_day, number);
-			break;
-		case week:
-			ret = rollup_iterator(itr_week, number);
-			break;
-		case month:
-			ret = rollup_iterator(itr_month, number);
-			break;
-		case year:
-			ret = rollup_iterator(itr_year, number);
-			break;
+/**
+ * Drop the newest count rows from the view. Nothing is copied.
+ *
+ * @return Pointer to the current view.
+ */
+stockinfo_view &stockinfo_view::shift(const long count) {
+	long n = std::min(std::max(count, 0L), rows);
+
+	offset += n;
+	rows -= n;
+
+	return *this;
+}
+
+/**
+ * @return The column of one of the prices. Index 0 is the most recent row in the view.
+ */
+const double *stockinfo_view::prices(price_field field) const {
+	switch (field) {
+		case price_open:
+			return opens();
+		case price_high:
+			return highs();
+		case price_low:
+			return lows();
 		default:
-			// TODO: Return default.
-			ret = *this;
-			break;
+			return closes();
 	}
+}
 
-	return ret;
+/**
+ * Check that the rows are in descending order by day. Any run of rows from sorted columns is sorted.
+ */
+bool stockinfo_view::sorted() const {
+	const int32_t *days = this->days();
+	long x;
+
+	if (cols && cols->sorted)
+		return true;
+
+	for (x = 1; x < rows; x++)
+		if (days[x-1] < days[x])
+			return false;
+
+	return true;
 }
 
-stockinfo stockinfo::weekly(bool align_week) {
+/**
+ * Roll the rows of the view up into larger time periods. See stockinfo::rollup().
+ *
+ * @return New stockinfo object.
+ */
+stockinfo stockinfo_view::rollup(int number, timeperiods period, bool align_week) const {
+	return roll(number, period, align_week ? align_sunday : align_latest);
+}
+
+stockinfo stockinfo_view::weekly(bool align_week) const {
 	return rollup(1, week, align_week);
 }
 
 /**
- * Parse YYYY-MM-DD or d-Mmm-YY dates into something machine-readable.
+ * Roll the rows of the view up into calendar periods. See stockinfo::calendar().
+ *
+ * @return New stockinfo object.
+ */
+stockinfo stockinfo_view::calendar(timeperiods period) const {
+	return roll(1, period, align_calendar);
+}
+
+/**
+ * Roll the rows of the view up. Buckets are counted back from an anchor: the latest day, the Sunday after it,
+ * or the end of its calendar period, depending on align. Bucket k holds the days after edge k+1, up to and
+ * including edge k. Each bar takes the open of its oldest day, the close of its newest, the extremes of its
+ * highs and lows, the sum of its volumes, and the date of its oldest day.
+ *
+ * @return New stockinfo object.
+ */
+stockinfo stockinfo_view::roll(int number, timeperiods period, rollup_alignment align) const {
+	const int32_t *days = this->days();
+	const double *opens = this->opens(), *highs = this->highs(), *lows = this->lows(), *closes = this->closes();
+	const long *volumes = this->volumes();
+	std::shared_ptr<stock_columns> ret;
+	int32_t anchor, edge;
+	double high, low;
+	long x, k, volume;
+
+	if ((length() < 2) || (period < day) || (period > quarter)) {
+		return stockinfo(*this);
+	}
+
+	// This only works if the data is in order. Views cannot sort in place, so roll up a sorted copy.
+	if (!sorted()) {
+		stockinfo tmp(*this);
+		return stockinfo_view(tmp).roll(number, period, align);
+	}
+
+	if (number < 1)
+		number = 1;
+
+	// Roll-ups of every row are kept with the rows, until they change.
+	auto key = std::make_tuple(number, (int)period, (int)align);
+	bool whole = (offset == 0) && (rows == (long)cols->day_col.size());
+	if (whole) {
+		std::lock_guard<std::mutex> guard(cols->rollups.lock);
+		auto found = cols->rollups.bars.find(key);
+		if (found != cols->rollups.bars.end())
+			return stockinfo(found->second);
+	}
+
+	// Calendar bars do not move when the newest rows are dropped, as the walk-back mode does, so a view that runs
+	// to the oldest row shares all but its newest bar with the (cached) roll-up of every row.
+	if (!whole && (align == align_calendar) && cols->sorted && (offset + rows == (long)cols->day_col.size())) {
+		stockinfo_view all(*this);
+		all.offset = 0;
+		all.rows = cols->day_col.size();
+		return latest_bar(all.roll(number, period, align));
+	}
+
+	anchor = days[0];
+	if (align == align_sunday)
+		anchor = period_end(anchor, week);
+	else if (align == align_calendar)
+		anchor = period_end(anchor, period);
+
+	// Find the bucket that the latest day is in.
+	for (k = 0; (edge = bucket_edge(anchor, period, (k + 1) * number)) >= days[0]; k++);
+
+	ret = std::make_shared<stock_columns>();
+	high = highs[0];
+	low = lows[0];
+	volume = 0;
+	ret->close_col.push_back(closes[0]);
+
+	for (x = 0; x < rows; x++) {
+		if (days[x] <= edge) {
+			// Close the bar before this row, then skip any buckets without rows.
+			ret->day_col.push_back(days[x-1]);
+			ret->open_col.push_back(opens[x-1]);
+			ret->high_col.push_back(high);
+			ret->low_col.push_back(low);
+			ret->volume_col.push_back(volume);
+
+			do {
+				edge = bucket_edge(anchor, period, (++k + 1) * number);
+			} while (days[x] <= edge);
+
+			high = highs[x];
+			low = lows[x];
+			volume = 0;
+			ret->close_col.push_back(closes[x]);
+		}
+
+		high = std::max(high, highs[x]);
+		low = std::min(low, lows[x]);
+		volume += volumes[x];
+	}
+
+	ret->day_col.push_back(days[rows-1]);
+	ret->open_col.push_back(opens[rows-1]);
+	ret->high_col.push_back(high);
+	ret->low_col.push_back(low);
+	ret->volume_col.push_back(volume);
+
+	if (whole) {
+		std::lock_guard<std::mutex> guard(cols->rollups.lock);
+		cols->rollups.bars.emplace(key, ret);
+	}
+
+	return stockinfo(ret);
+}
+
+/**
+ * A calendar roll-up of the view, from the same roll-up of rows that run from the view's newest row or later down
+ * to its oldest. The bars older than the view's newest one are copied. The newest is rolled up again, as it may be
+ * missing some of its days.
+ *
+ * @return New stockinfo object.
+ */
+stockinfo stockinfo_view::latest_bar(const stockinfo &later) const {
+	const int32_t *days = this->days(), *bars = later.days();
+	const double *highs = this->highs(), *lows = this->lows();
+	const long *volumes = this->volumes();
+	std::shared_ptr<stock_columns> ret = std::make_shared<stock_columns>();
+	const stock_columns &from = *later.cols;
+	double high = highs[0], low = lows[0];
+	long x, bar, volume = 0;
+
+	// Bars are dated by their oldest day, so the newest bar is the first one from on or before the newest day.
+	bar = std::lower_bound(bars, bars + later.length(), days[0], std::greater<int32_t>()) - bars;
+	for (x = 0; (x < rows) && (days[x] >= bars[bar]); x++) {
+		high = std::max(high, highs[x]);
+		low = std::min(low, lows[x]);
+		volume += volumes[x];
+	}
+
+	ret->day_col.push_back(days[x-1]);
+	ret->open_col.push_back(opens()[x-1]);
+	ret->high_col.push_back(high);
+	ret->low_col.push_back(low);
+	ret->close_col.push_back(closes()[0]);
+	ret->volume_col.push_back(volume);
+
+	ret->day_col.insert(ret->day_col.end(), from.day_col.begin() + bar + 1, from.day_col.end());
+	ret->open_col.insert(ret->open_col.end(), from.open_col.begin() + bar + 1, from.open_col.end());
+	ret->high_col.insert(ret->high_col.end(), from.high_col.begin() + bar + 1, from.high_col.end());
+	ret->low_col.insert(ret->low_col.end(), from.low_col.begin() + bar + 1, from.low_col.end());
+	ret->close_col.insert(ret->close_col.end(), from.close_col.begin() + bar + 1, from.close_col.end());
+	ret->volume_col.insert(ret->volume_col.end(), from.volume_col.begin() + bar + 1, from.volume_col.end());
+
+	return stockinfo(ret);
+}
+
+/**
+ * Parse YYYY-MM-DD or d-Mmm-YY dates into a day number. Rows of a file are usually parsed in order, so the
+ * last result is remembered.
  *
  * @param char *date The date to parse.
- * @return time_t
+ * @return Days since 1970-01-01, or 0 if the date could not be parsed.
  */
-time_t stockinfo::parse_csv_time(const char *date) {
-	struct tm parsed;
-	time_t ret = 0;
+int32_t stockinfo::parse_csv_day(const char *date) {
+	static thread_local struct stock_date last = {};
+	static thread_local int32_t last_ret = 0;
+	int32_t ret;
 
 	if (date == nullptr) {
-		return ret;
+		return 0;
 	}
 
-	// Zero out the time sections. We don't care about them yet (TODO?)
-	parsed.tm_hour = 0;
-	parsed.tm_min = 0;
-	parsed.tm_sec = 1;
-	parsed.tm_isdst = -1;
+	if ((*date != '\0') && (strncmp(date, last.text, sizeof(last.text)) == 0))
+		return last_ret;
 
 	// Yahoo's format was: %Y-%m-%d. Google's is %d-%B-%y.
-	if (!strptime(date, "%Y-%m-%d", &parsed)) {
-		if (!strptime(date, "%d-%B-%y", &parsed)) {
-			BOOST_LOG_TRIVIAL(info) << "Failed to parse date: " << date;
-			return ret;
-		}
+	if (!parse_civil_date(date, &ret)) {
+		BOOST_LOG_TRIVIAL(info) << "Failed to parse date: " << date;
+		return 0;
+	}
+
+	if (strlen(date) < sizeof(last.text)) {
+		strcpy(last.text, date);
+		last_ret = ret;
 	}
 
-	// Convert <struct tm> into <time_t>.
-	ret = mktime(&parsed);
-	return ret == -1 ? 0 : ret;
+	return ret;
+}
+
+/**
+ * Write the data struct as a bar file image, starting at the current position of wr.
+ *
+ * @return boolean. True if every byte was written.
+ */
+bool stockinfo::write_bars(FILE *wr) const {
+	struct bar_file_header header;
+	struct bar_file_columns layout;
+	long base = ftell(wr), rows = length();
+	bool ret;
+
+	header = bar_file_new_header(rows);
+	layout = bar_file_layout(rows);
+
+	// Write the header, then each column at its aligned offset.
+	ret = (base >= 0) && (fwrite(&header, sizeof(header), 1, wr) == 1);
+	ret = ret && write_column(wr, base + layout.day, cols->day_col.data(), rows * sizeof(int32_t));
+	ret = ret && write_column(wr, base + layout.open, cols->open_col.data(), rows * sizeof(double));
+	ret = ret && write_column(wr, base + layout.high, cols->high_col.data(), rows * sizeof(double));
+	ret = ret && write_column(wr, base + layout.low, cols->low_col.data(), rows * sizeof(double));
+	ret = ret && write_column(wr, base + layout.close, cols->close_col.data(), rows * sizeof(double));
+	ret = ret && write_column(wr, base + layout.volume, cols->volume_col.data(), rows * sizeof(int64_t));
+	ret = ret && write_column(wr, base + layout.size, nullptr, 0);
+
+	return ret;
+}
+
+/**
+ * Pad a bar file out to offset, then write a column's bytes.
+ */
+bool stockinfo::write_column(FILE *wr, const long offset, const void *column, const long bytes) const {
+	static const char padding[BAR_FILE_ALIGN] = {};
+	long pos = ftell(wr);
+
+	if ((pos < 0) || (pos > offset) || (offset - pos > BAR_FILE_ALIGN))
+		return false;
+
+	if ((offset > pos) && (fwrite(padding, offset - pos, 1, wr) != 1))
+		return false;
+
+	return (bytes == 0) || (fwrite(column, bytes, 1, wr) == 1);
+}
+
+/**
+ * Remember which file we loaded, so that it can be re-saved without naming it again.
+ */
+void stockinfo::set_filename(const char *filename) {
+	if (orig_filename != nullptr)
+		free(orig_filename);
+
+	orig_filename = (char *)malloc(strlen(filename) + 1);
+	strcpy(orig_filename, filename);
+	dirty = false;
+	persisted = 0;
+	log_rows = 0;
 }
 
 /**
@@ -514,20 +1368,131 @@ void stockinfo::sig()
 }
 
 void stockinfo::copy(const stockinfo &s) {
-	struct stock tmp;
-	long x, length;
-
-	length = s.length();
-	for (x = 0; x < length; x++) {
-		memcpy(&tmp, s[x], sizeof(tmp));
-		if (s[x]->date) {
-			tmp.date = (char *)malloc(strlen(s[x]->date));
-			strcpy(tmp.date, s[x]->date);
-		}
+	cols = s.cols;
+	persisted = 0;
+	log_rows = 0;
+
+	if (s.length() > 0)
+		dirty = true;
+}
+
+void stockinfo::take(stockinfo &s) {
+	if (orig_filename != nullptr)
+		free(orig_filename);
+
+	cols = std::move(s.cols);
+	orig_filename = s.orig_filename;
+	dirty = s.dirty;
+	persisted = s.persisted;
+	log_rows = s.log_rows;
+
+	s.cols = empty_columns();
+	s.orig_filename = nullptr;
+	s.dirty = false;
+	s.persisted = 0;
+	s.log_rows = 0;
+}
+
+/**
+ * Give this object its own copy of the columns before they are changed, if any other object shares them.
+ * Roll-ups of the old rows no longer apply.
+ */
+void stockinfo::detach() {
+	if (cols.use_count() > 1)
+		cols = std::make_shared<stock_columns>(*cols);
+	else
+		cols->rollups.bars.clear();
+}
+
+/**
+ * Every empty stockinfo shares one set of columns, so that making one does not allocate.
+ */
+const std::shared_ptr<stock_columns> &stockinfo::empty_columns() {
+	static const std::shared_ptr<stock_columns> empty = std::make_shared<stock_columns>();
+
+	return empty;
+}
+
+/**
+ * Remove the row at pos from every column.
+ */
+void stockinfo::erase(const long pos) {
+	if (pos >= length() - persisted)
+		persisted = 0;
+
+	detach();
 
-		data.push_back(tmp);
+	cols->day_col.erase(cols->day_col.begin() + pos);
+	cols->open_col.erase(cols->open_col.begin() + pos);
+	cols->high_col.erase(cols->high_col.begin() + pos);
+	cols->low_col.erase(cols->low_col.begin() + pos);
+	cols->close_col.erase(cols->close_col.begin() + pos);
+	cols->volume_col.erase(cols->volume_col.begin() + pos);
+
+	// Removing a row cannot break the order.
+	CHECK_ORDER();
+}
+
+/**
+ * Copy count struct stocks into every column at pos. Parses each date into a day number, if one was given.
+ */
+void stockinfo::store(const struct stock *s, const long count, const long pos) {
+	column<int32_t> days(count);
+	column<double> opens(count), highs(count), lows(count), closes(count);
+	column<long> volumes(count);
+	long x;
+
+	// Rows after the insert point are no longer the ones that were saved.
+	if (pos > length() - persisted)
+		persisted = 0;
+
+	detach();
+	for (x = 0; x < count; x++) {
+		days[x] = (s[x].date != nullptr) ? parse_csv_day(s[x].date) : days_from_time(s[x].timestamp);
+		opens[x] = s[x].open;
+		highs[x] = s[x].high;
+		lows[x] = s[x].low;
+		closes[x] = s[x].close;
+		volumes[x] = s[x].volume;
 	}
 
-	if (length > 0)
-		dirty = true;
+	cols->day_col.insert(cols->day_col.begin() + pos, days.begin(), days.end());
+	cols->open_col.insert(cols->open_col.begin() + pos, opens.begin(), opens.end());
+	cols->high_col.insert(cols->high_col.begin() + pos, highs.begin(), highs.end());
+	cols->low_col.insert(cols->low_col.begin() + pos, lows.begin(), lows.end());
+	cols->close_col.insert(cols->close_col.begin() + pos, closes.begin(), closes.end());
+	cols->volume_col.insert(cols->volume_col.begin() + pos, volumes.begin(), volumes.end());
+	track_order(*cols, pos, pos + count);
+	CHECK_ORDER();
+}
+
+/**
+ * Copy a struct stock onto the end of every column. Parses the date into a day number, if one was given.
+ */
+void stockinfo::push(const struct stock &s) {
+	detach();
+	cols->day_col.push_back((s.date != nullptr) ? parse_csv_day(s.date) : days_from_time(s.timestamp));
+	cols->open_col.push_back(s.open);
+	cols->high_col.push_back(s.high);
+	cols->low_col.push_back(s.low);
+	cols->close_col.push_back(s.close);
+	cols->volume_col.push_back(s.volume);
+	track_order(*cols, length() - 1, length());
+	CHECK_ORDER();
+
+	// The oldest rows have changed.
+	persisted = 0;
+}
+
+/**
+ * Make room for rows in every column.
+ */
+void stockinfo::reserve(const long rows) {
+	detach();
+	cols->day_col.reserve(rows);
+	cols->open_col.reserve(rows);
+	cols->high_col.reserve(rows);
+	cols->low_col.reserve(rows);
+	cols->close_col.reserve(rows);
+	cols->volume_col.reserve(rows);
 }
@@ -2,13 +2,22 @@
  * @todo Rename this file from "stock.h" to "stockinfo.h"
  */
 #include <vector>
+#include <map>
+#include <tuple>
+#include <mutex>
+#include <memory>
+#include <cstddef>
+#include <cstdint>
+#include <cstdio>
 #include <ctime>
+#include "lib/aligned_allocator.h"
+#include "lib/calendar.h"
 
 #ifndef _stock_h
 #define _stock_h
 struct stock {
 	char *date; // TODO: Remove.
-	time_t timestamp; // Preferred over date.
+	time_t timestamp; // Midnight UTC. Preferred over date.
 	double open;
 	double high;
 	double low;
@@ -16,46 +25,216 @@ struct stock {
 	long volume;
 };
 
-enum timeperiods {day = 0, week = 1, month = 2, year = 3};
+enum timeperiods {day = 0, week = 1, month = 2, year = 3, quarter = 4};
 
+// Which bar to keep when a merge finds the same day on both sides.
+enum merge_policy {keep_existing = 0, newer_wins = 1};
+
+// Where roll-up buckets are counted back from: the latest day, the Sunday after it, or the end of its
+// calendar period.
+enum rollup_alignment {align_latest = 0, align_sunday = 1, align_calendar = 2};
+
+// One of the prices of a bar, for indicators that can read any of them.
+enum price_field {price_open = 0, price_high = 1, price_low = 2, price_close = 3};
+
+// Contiguous, cache-line aligned storage for one field of every row.
+template<class T>
+using column = std::vector<T, aligned_allocator<T>>;
+
+// Fixed-width date text, for parsers and older bar files.
+struct stock_date {
+	char text[16];
+};
+
+/**
+ * Read-only copy of a single stockinfo row. Acts like the `const struct stock *` that stockinfo used to
+ * hand out: compare it against nullptr, then use -> to read the fields. The date is formatted from the
+ * timestamp the first time the row is read.
+ */
+class stock_row {
+	public:
+		stock_row(): valid(false), row() {};
+		stock_row(const struct stock &s): valid(true), row(s) { row.date = nullptr; };
+		stock_row(const stock_row &r): valid(r.valid), row(r.row) { row.date = nullptr; };
+
+		stock_row &operator =(const stock_row &r) {
+			valid = r.valid;
+			row = r.row;
+			row.date = nullptr;
+			return *this;
+		}
+
+		const struct stock *operator ->() const { return &get(); }
+		const struct stock &operator *() const { return get(); }
+		bool operator ==(std::nullptr_t) const { return !valid; }
+		bool operator !=(std::nullptr_t) const { return valid; }
+
+	private:
+		const struct stock &get() const {
+			if (valid && (row.date == nullptr)) {
+				format_civil_date(days_from_time(row.timestamp), date.text);
+				row.date = date.text;
+			}
+
+			return row;
+		}
+
+		bool valid;
+		mutable struct stock row;
+		mutable struct stock_date date;
+};
+
+struct stock_columns;
+
+/**
+ * Roll-ups that were made from one set of columns, keyed by (number, period, alignment). Copies start out
+ * empty, since copies of columns are only made to be changed.
+ */
+struct rollup_cache {
+	rollup_cache() {};
+	rollup_cache(const rollup_cache &) {};
+	rollup_cache &operator =(const rollup_cache &) { return *this; };
+
+	std::mutex lock;
+	std::map<std::tuple<int, int, int>, std::shared_ptr<stock_columns>> bars;
+};
+
+// Every column of a stockinfo. Index 0 is the most recent row.
+struct stock_columns {
+	column<int32_t> day_col;
+	column<double> open_col;
+	column<double> high_col;
+	column<double> low_col;
+	column<double> close_col;
+	column<long> volume_col;
+
+	// What is known about the order of the rows: days never increase, and also never repeat.
+	bool sorted = true;
+	bool unique = true;
+
+	mutable rollup_cache rollups;
+};
+
+class stockinfo_view;
+
+/**
+ * Daily bars for one ticker. Copies share their columns until one of them is changed (copy-on-write), so
+ * passing a stockinfo around, or returning one, does not copy its rows.
+ */
 class stockinfo {
 	friend class config;
+	friend class bar_store;
+	friend class comma_separated_values;
+	friend class stockinfo_view;
 	public:
+		stockinfo();
 		stockinfo(const stockinfo &init);
-		stockinfo(): orig_filename(nullptr), dirty(false) {};
+		stockinfo(stockinfo &&init);
+		explicit stockinfo(const stockinfo_view &view);
 		~stockinfo();
 		bool load_csv(const char *filename);
 		bool save_csv(const char *filename = nullptr);
+		bool load_bars(const char *filename);
+		bool save_bars(const char *filename = nullptr);
 		stockinfo &insert_at(const struct stock s, const long pos = 0);
+		stockinfo &insert_at(const struct stock *s, const long count, const long pos = 0);
+		stockinfo &insert_at(const stockinfo &s, const long pos = 0);
 		const long length() const;
 		const long length();
 
 		struct stock shift();
 
-		const struct stock *operator [](const long index) const;
-		const struct stock *operator [](const long index);
+		const stock_row operator [](const long index) const;
+		const stock_row operator [](const long index);
 		stockinfo &operator +=(const struct stock s);
 		stockinfo &operator =(const stockinfo &s);
+		stockinfo &operator =(stockinfo &&s);
+
+		// Direct, read-only access to each column. Index 0 is the most recent row.
+		const int32_t *days() const { return cols->day_col.data(); }
+		const double *opens() const { return cols->open_col.data(); }
+		const double *highs() const { return cols->high_col.data(); }
+		const double *lows() const { return cols->low_col.data(); }
+		const double *closes() const { return cols->close_col.data(); }
+		const long *volumes() const { return cols->volume_col.data(); }
 
 		stockinfo &uniq();
 		stockinfo &sort();
+		stockinfo &merge(const stockinfo &incoming, const merge_policy policy = newer_wins);
+		bool sorted() const { return cols->sorted; }
+		bool unique() const { return cols->unique; }
+		bool check_order() const;
 
-		template<class T>
-		stockinfo rollup_iterator(T &iterator, int number);
 		stockinfo rollup(int number = 1, timeperiods period = week, bool align_week = false);
 		stockinfo weekly(bool align_week = false);
+		stockinfo calendar(timeperiods period);
+		stockinfo &roll_forward(const stockinfo &daily, timeperiods period, int32_t since);
 
 	private:
-		time_t parse_csv_time(const char *date);
+		int32_t parse_csv_day(const char *date);
 		void nosig();
 		void sig();
 		void copy(const stockinfo &s);
+		void take(stockinfo &s);
+		void detach();
+		static const std::shared_ptr<stock_columns> &empty_columns();
+		explicit stockinfo(const std::shared_ptr<stock_columns> &cols);
+		void set_filename(const char *filename);
+		bool read_bars(const char *map, const uint64_t size);
+		bool write_bars(FILE *wr) const;
+		bool write_column(FILE *wr, const long offset, const void *column, const long bytes) const;
+		bool read_log(const char *filename);
+		bool append_log(const char *filename, const long rows);
+		void erase(const long pos);
+		void store(const struct stock *s, const long count, const long pos);
+		void push(const struct stock &s);
+		void reserve(const long rows);
 
-		template<class T>
-		T &multi_decrement(T &iterator, int number = 1);
-
-		std::vector<struct stock> data;
+		std::shared_ptr<stock_columns> cols;
 		char *orig_filename;
 		bool dirty;
+
+		// Rows at the end of the columns that are already in orig_filename, and how many of those live in its log.
+		long persisted;
+		long log_rows;
+};
+/**
+ * A read-only window onto the rows of a stockinfo, without copying them. Row 0 of the view is row offset of
+ * the stockinfo. Dropping the newest rows, as the walk-back mode does once per day, only moves the offset.
+ *
+ * The view shares the stockinfo's columns, so it stays valid after the stockinfo changes or goes away. It
+ * keeps seeing the rows as they were when it was made.
+ */
+class stockinfo_view {
+	friend class stockinfo;
+	public:
+		stockinfo_view(): offset(0), rows(0) {};
+		stockinfo_view(const stockinfo &data, const long offset = 0, const long length = -1);
+
+		const long length() const { return rows; }
+		const stock_row operator [](const long index) const;
+		stockinfo_view &shift(const long count = 1);
+
+		// Direct, read-only access to each column. Index 0 is the most recent row in the view.
+		const int32_t *days() const { return cols ? cols->day_col.data() + offset : nullptr; }
+		const double *opens() const { return cols ? cols->open_col.data() + offset : nullptr; }
+		const double *highs() const { return cols ? cols->high_col.data() + offset : nullptr; }
+		const double *lows() const { return cols ? cols->low_col.data() + offset : nullptr; }
+		const double *closes() const { return cols ? cols->close_col.data() + offset : nullptr; }
+		const long *volumes() const { return cols ? cols->volume_col.data() + offset : nullptr; }
+		const double *prices(price_field field) const;
+
+		bool sorted() const;
+		stockinfo rollup(int number = 1, timeperiods period = week, bool align_week = false) const;
+		stockinfo weekly(bool align_week = false) const;
+		stockinfo calendar(timeperiods period) const;
+
+	private:
+		stockinfo roll(int number, timeperiods period, rollup_alignment align) const;
+		stockinfo latest_bar(const stockinfo &later) const;
+
+		std::shared_ptr<const stock_columns> cols;
+		long offset;
+		long rows;
 };
 #endif
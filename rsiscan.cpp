@@ -29,6 +29,7 @@
 /* Universal headers */
 #include <netinet/in.h>
 #include <sys/socket.h>
+#include <sys/time.h>
 #include <arpa/inet.h>
 #include <signal.h>
 #include <string.h>
@@ -36,6 +37,11 @@
 #include <errno.h>
 #include <ctype.h>
 #include <string>
+#include <algorithm>
+#include <vector>
+#include <thread>
+#include <atomic>
+#include <mutex>
 #include <boost/log/core.hpp>
 #include <boost/log/trivial.hpp>
 #include <boost/log/expressions.hpp>
@@ -44,6 +50,8 @@
 #include "lib/config.h"
 #include "lib/rsiscript.h"
 #include "lib/http.h"
+#include "lib/bar_store.h"
+#include "lib/calendar.h"
 #include "lib/comma_separated_values.h"
 #include "lib/stock.h"
 #include "lib/stats/moving_average_convergence_divergence.h"
@@ -52,6 +60,9 @@
 #include "lib/stats/bollinger.h"
 #include "lib/stats/high.h"
 #include "lib/stats/low.h"
+#include "lib/stats/live_indicators.h"
+#include "lib/stats/indicator_cache.h"
+#include "lib/stats/divergence.h"
 
 /* Linux-only headers */
 #ifndef WIN32
@@ -65,12 +76,6 @@
 #       include <time.h>
 #endif
 
-#define IGNORED 0
-#define HIGHERHIGH 1
-#define LOWERHIGH 2
-#define HIGHERLOW 3
-#define LOWERLOW 4
-
 #define UP 0
 #define DOWN 1
 
@@ -89,6 +94,23 @@ const char *i_servers[] = { "download.finance.yahoo.com",
 			    ""
 			  };
 
+/* A ticker's history, and the series that every day of its walk-back reads. */
+struct ticker_walk
+{
+	const char *ticker;
+	stockinfo_view all_data;
+	long rows, all_rows;
+	const double *sma5, *low52_data, *high52_data;
+	const live_indicators *live;
+};
+
+/* What one thread screens with. It is kept from ticker to ticker, so that it stops allocating. */
+struct screener
+{
+	indicator_cache indicators, shifted;
+	rsiscript rs;
+};
+
 /* 1.1 - Basic program functionality */
 void create_config();
 void create_dir(char *path);
@@ -104,29 +126,40 @@ char *retrieve_data(FILE *in, const char *ticker);
 void recursive_free(stock *data, long rows);
 
 /* 1.3 - Functions which extrapolate from data */
+void find_tickers();
+void convert_cache(bool to_csv);
+void pack_store();
+void update_store();
+bool newer_than_store(const char *bars_file);
+void saved_outside_store();
 void update_tickers();
-stockinfo load_ticker(const char *ticker); //, stock **data, long *rows);
+void walk_days(const ticker_walk &walk, std::vector<screener> &screeners, long days);
+void screen_days(const ticker_walk &walk, screener &with, long first, long last);
+stockinfo load_ticker(const char *ticker, int32_t *changed, bool *fresh); //, stock **data, long *rows);
+void save_ticker(const char *ticker, stockinfo &s, int32_t changed, bool fresh, const live_indicators &live, bool advanced);
 time_t get_last_date(stockinfo &data);
-long average_volume(const stockinfo &data, long n = 10);
+long average_volume(const stockinfo_view &data, long n = 10);
 //stock *make_weekly(const stock *data, long rows, long *w_rows);
-stockinfo stock_bump_day(stockinfo &data);
-bool diverge(const char *ticker, const stockinfo &data, const char *desc);
-double *stock_reduce_close(const stock *data, long rows);
+stockinfo_view stock_bump_day(const stockinfo_view &data);
 //void tails(const char *ticker, const stockinfo &data);
-bool bbands_narrow(const char *ticker, const stockinfo &data);
-void low52wk(const char *ticker, const stockinfo &data);
+bool bbands_narrow(const char *ticker, indicator_cache &indicators);
+void low52wk(const char *ticker, const stockinfo_view &data, double low52, double high52);
 //void test_screener(const char *ticker, const stockinfo &data);
-void analyze(const char *ticker, const stockinfo data);
-int divergence(const double *values, long rows, long reset_high, long reset_low, long *pos = NULL);
-bool chart_patterns(const stockinfo &data, bool print, const char *period);
-const char *exec_script(const char* const script, const stockinfo &data);
+void analyze(const char *ticker, indicator_cache &indicators);
+bool chart_patterns(const stockinfo_view &data, bool print, const char *period);
+const char *exec_script(const char* const script, const stockinfo_view &data);
 
 /* Global variables */
-bool verbose, save_config, offline, intraday, walk_back, find_divergence, find_tails, low52, narrow_bbands; //, test;
-int percent, seconds;
+bool verbose, save_config, offline, intraday, walk_back, find_divergence, find_tails, low52, narrow_bbands, import_csv, export_csv, use_store, build_store; //, test;
+int percent, seconds, threads;
+rollup_alignment week_alignment; // Weeks of the weekly screens.
 enum server source;
 char const *script;
 config conf;
+bar_store store;
+bool store_behind; // Files in the cache were written since the store was.
+std::mutex conf_lock; // Screens run on several threads at once while walking back.
+thread_local FILE *screen_out = stdout; // Where the screens print. Each chunk of a walk-back prints to its own.
 
 /*****************************
  * 1.0 - Program entry point
@@ -136,15 +169,21 @@ int main(int argc, char **argv)
 	verbose = intraday = false;
 
 	percent = 0;
+	threads = std::max(1U, std::thread::hardware_concurrency());
 
 	script = nullptr;
 	offline = false;
 	walk_back = false;
+	week_alignment = align_latest;
 	low52 = false;
 	//test = false;
 	find_tails = false;
 	narrow_bbands = false;
 	find_divergence = false;
+	import_csv = false;
+	export_csv = false;
+	use_store = false;
+	build_store = false;
 
 	source = google;
 	create_config();
@@ -162,7 +201,18 @@ int main(int argc, char **argv)
 
 	// Start the main program.
 	read_args(argc, argv);
-	update_tickers();
+	if (build_store)
+		pack_store();
+	else if (import_csv || export_csv)
+		convert_cache(export_csv);
+	else
+	{
+		if (use_store && !store.open(conf.store_file))
+			fprintf(stderr, "Warning: Unable to open %s. Run with --build-store first.\n", (char *)conf.store_file);
+		store_behind = store.older_than(conf.stock_dir);
+
+		update_tickers();
+	}
 
 	free(logfile);
 
@@ -198,6 +248,8 @@ void read_args(int argc, char **argv)
 			percent = atoi(argv[x] + 5);
 		else if ((strncmp(argv[x], "--sleep=", 8) == 0) && (strlen(argv[x]) > 8))
 			seconds = atoi(argv[x] + 8);
+		else if ((strncmp(argv[x], "--threads=", 10) == 0) && (atoi(argv[x] + 10) > 0))
+			threads = atoi(argv[x] + 10);
 		else if (strcmp(argv[x], "--offline") == 0)
 			offline = true;
 		//else if (strcmp(argv[x], "--intraday") == 0) - TODO: service discontinued Nov. 2017
@@ -206,6 +258,8 @@ void read_args(int argc, char **argv)
 			walk_back = true;
 		else if (strcmp(argv[x], "--divergence") == 0)
 			find_divergence = true;
+		else if (strcmp(argv[x], "--calendar-weeks") == 0)
+			week_alignment = align_calendar;
 		else if (strcmp(argv[x], "--tails") == 0)
 			//find_tails = true;
 			// TODO: Check for 3-4 days?
@@ -217,6 +271,14 @@ void read_args(int argc, char **argv)
 		else if (strcmp(argv[x], "--test") == 0)
 			//test = true;
 			script = "{vol} > 500000 & ({close} > {bb_top} | {close} < {bb_bottom})";
+		else if (strcmp(argv[x], "--import-csv") == 0)
+			import_csv = true;
+		else if (strcmp(argv[x], "--export-csv") == 0)
+			export_csv = true;
+		else if (strcmp(argv[x], "--store") == 0)
+			use_store = true;
+		else if (strcmp(argv[x], "--build-store") == 0)
+			build_store = true;
 		else if (strncmp(argv[x], "--script=", 9) == 0) {
 			script = argv[x] + 9;
 		}
@@ -253,12 +315,18 @@ void print_help(const char *prog)
 	printf("    --offline    Do not download any data for this run\n");
 	//printf("    --intraday   Temporarily use intraday quotes for today's closing information\n");
 	printf("    --walk       Walk back through the stock histories\n");
+	printf("    --threads=## Threads to walk back with [default: one per core]\n");
 	printf("    --low52      Stocks near their 52-week low\n");
 	printf("    --test       A test screener...\n");
 	printf("    --script=\"...\" For advanced, on-the-fly processing\n");
 	printf("    --divergence Look for divergences in the RSI, MACD, and MACD histogram\n");
+	printf("    --calendar-weeks Weekly screens use calendar weeks instead of weeks ending on the latest day\n");
 	printf("    --tails      Look for lows outside BB, with closes inside 3 out of 4 days\n");
 	printf("    --narrow-bbands Narrow Bollinger Bands.\n");
+	printf("    --import-csv Convert cached CSV files into binary bar files and exit\n");
+	printf("    --export-csv Convert cached binary bar files back into CSV files and exit\n");
+	printf("    --store      Read tickers from the single-file store built by --build-store\n");
+	printf("    --build-store Pack every cached ticker into a single-file store and exit\n");
 	printf("    --verbose    Print debug data along the way\n");
 	printf("    --help       Print this text and exit\n\n");
 
@@ -351,7 +419,7 @@ char *get_path(const char *ticker, time_t from) {
 	time(&epoch);
 	memcpy(&date_finish, localtime(&epoch), sizeof(struct tm));
 	epoch = ((from == 0) ? epoch - 31536000 : from + 86400);
-	date_start = localtime(&epoch);
+	date_start = (from == 0) ? localtime(&epoch) : gmtime(&epoch);
 
 	if (source == yahoo)
 		sprintf(ret, "/table.csv?s=%s&a=%i&b=%i&c=%i&d=%i&e=%i&f=%i&g=d&ignore=.csv", ticker,
@@ -508,55 +576,261 @@ void recursive_free(stock *data, long rows)
 /****************************************************
  * 1.3 - Functions which extrapolate from data
  ****************************************************
- * Call load_ticker() for each stock locally cached */
-void update_tickers()
+ * Fill conf.tickers from the local cache, unless tickers were listed on the command line.
+ * The store's index is used when it is open. Otherwise, a .csv file is skipped when the
+ * same ticker also has a .bars file. */
+void find_tickers()
 {
-	long x, pos, position, rows = 0, /*weekly_rows = 0, divergence_rows = 0,*/ all_rows = 0, vol = 0, distance1, distance2;
-	stockinfo data, all_data, weekly_data, divergence_data;
-	bool diverge_daily, diverge_weekly, found_setup, cont;
-	moving_average_convergence_divergence macd;
-	double *sma5 = nullptr, *macd_h = nullptr;
-	int len, direction1, direction2;
-	double res, movement1, movement2;
-	simple_moving_average sma;
 	struct dirent *file;
-	rsiscript rs;
+	struct stat buf;
 	DIR *saved;
 	char *tmp, *filename;
-	std::string result;
+	bool found;
+	long x;
+	int len;
 
-	if (save_config && (!conf.tickers.size()))
+	if (!save_config || conf.tickers.size())
+		return;
+
+	if (store.is_open())
 	{
-		if ((saved = opendir(conf.stock_dir)) == NULL)
+		for (x = 0; x < store.length(); x++)
+			conf.tickers.push_back(strdup(store.symbol(x)));
+
+		return;
+	}
+
+	if ((saved = opendir(conf.stock_dir)) == NULL)
+	{
+		fprintf(stderr, "Error opening %s: %s\n", (char *)conf.stock_dir, strerror(errno));
+		return;
+	}
+
+	while ((file = readdir(saved)))
+	{
+		len = strlen(file->d_name);
+
+		if ((len > 4) && (strcasecmp(file->d_name + len - 4, ".csv") == 0))
 		{
-			fprintf(stderr, "Error opening %s: %s\n", (char *)conf.stock_dir, strerror(errno));
-			return;
+			// Prefer the binary copy of this ticker, if there is one.
+			filename = (char *)malloc(strlen(conf.stock_dir) + len + 3);
+			sprintf(filename, "%s/%.*s.bars", (char *)conf.stock_dir, len - 4, file->d_name);
+			found = (stat(filename, &buf) == 0);
+			free(filename);
+
+			if (found)
+				continue;
 		}
+		else if ((len <= 5) || (strcasecmp(file->d_name + len - 5, ".bars") != 0))
+			continue;
+		else if (strchr(file->d_name, '.') != file->d_name + len - 5)
+			continue; // Roll-ups, like "aapl.week.bars", go with the daily bars.
 
-		while ((file = readdir(saved)))
+		tmp = file->d_name;
+		while ((*tmp != '\0') && (*tmp != '.'))
 		{
-			len = strlen(file->d_name);
-			len = len > 4 ? len - 4 : 0;
+			*tmp = toupper(*tmp);
+			tmp++;
+		}
+		*tmp = 0;
 
-			if (strcasecmp(file->d_name + len, ".csv") != 0)
-				continue;
+		filename = (char *)malloc(strlen(file->d_name) + 1);
+		strcpy(filename, file->d_name);
+		conf.tickers.push_back(filename);
+	}
 
-			tmp = file->d_name;
-			while ((*tmp != '\0') && (*tmp != '.'))
-			{
-				*tmp = toupper(*tmp);
-				tmp++;
-			}
-			*tmp = 0;
+	closedir(saved);
 
-			filename = (char *)malloc(strlen(file->d_name) + 1);
-			strcpy(filename, file->d_name);
-			conf.tickers.push_back(filename);
+	return;
+}
+
+/* Convert every cached ticker between CSV and binary bar files */
+void convert_cache(bool to_csv)
+{
+	char *csv_file, *bars_file;
+	bool success;
+	size_t x;
+
+	find_tickers();
+
+	for (x = 0; x < conf.tickers.size(); x++)
+	{
+		stockinfo data;
+
+		csv_file = conf.get_filename(conf.tickers[x]);
+		bars_file = conf.get_filename(conf.tickers[x], "bars");
+
+		if (to_csv)
+			success = data.load_bars(bars_file) && data.save_csv(csv_file);
+		else
+			success = data.load_csv(csv_file) && data.save_bars(bars_file);
+
+		if (!success)
+			printf("Failed to convert %s\n", conf.tickers[x]);
+		else if (verbose)
+			printf("%s: %li rows written to %s\n", conf.tickers[x], data.length(), to_csv ? csv_file : bars_file);
+
+		free(csv_file);
+		free(bars_file);
+	}
+
+	// Bar files that were written over in place do not change the directory.
+	if (!to_csv)
+		saved_outside_store();
+
+	return;
+}
+
+/**
+ * Pack cached tickers into the single-file store, with their calendar weeks and the state of their live
+ * indicators. With no store open, that is every ticker in the cache, read from its own files. With a store open,
+ * it is every ticker in the store, which leaves out the blocks that were replaced.
+ */
+void pack_store()
+{
+	std::vector<std::string> symbols;
+	struct live_indicators_file state;
+	char *csv_file, *bars_file;
+	bar_store packed;
+	bool loaded, has_live;
+	long x, count = 0;
+
+	if (store.is_open())
+	{
+		for (x = 0; x < store.length(); x++)
+			symbols.push_back(store.symbol(x));
+	}
+	else
+	{
+		find_tickers();
+		symbols.assign(conf.tickers.begin(), conf.tickers.end());
+	}
+
+	if (!packed.create(conf.store_file))
+	{
+		fprintf(stderr, "Error creating %s: %s\n", (char *)conf.store_file, strerror(errno));
+		return;
+	}
+
+	for (x = 0; x < (long)symbols.size(); x++)
+	{
+		stockinfo data, weeks;
+		live_indicators live;
+
+		if (store.is_open())
+		{
+			loaded = store.load(symbols[x].c_str(), data);
+			store.load(symbols[x].c_str(), weeks, store_week_bars);
+			has_live = store.read(symbols[x].c_str(), store_live, &state, sizeof(state));
+		}
+		else
+		{
+			csv_file = conf.get_filename(symbols[x].c_str());
+			bars_file = conf.get_filename(symbols[x].c_str(), "bars");
+			loaded = data.load_bars(bars_file) || data.load_csv(csv_file);
+			free(csv_file);
+			free(bars_file);
+
+			bars_file = conf.get_filename(symbols[x].c_str(), "week.bars");
+			weeks.load_bars(bars_file);
+			free(bars_file);
+
+			bars_file = conf.get_filename(symbols[x].c_str(), "live");
+			if ((has_live = live.load(bars_file)))
+				state = live.snapshot();
+			free(bars_file);
 		}
 
-		closedir(saved);
+		if (!loaded || !data.length())
+		{
+			if (verbose)
+				printf("Skipping %s: no data.\n", symbols[x].c_str());
+		}
+		else if (packed.append(symbols[x].c_str(), data, &weeks, has_live ? &state : nullptr, sizeof(state)))
+			count++;
+		else
+			printf("Failed to pack %s\n", symbols[x].c_str());
 	}
 
+	if (!packed.commit())
+		fprintf(stderr, "Error writing %s\n", (char *)conf.store_file);
+	else if (verbose)
+		printf("%li tickers packed into %s\n", count, (char *)conf.store_file);
+
+	return;
+}
+
+/**
+ * Save the tickers that were replaced in the open store during this run. Their old blocks are left unused, so
+ * once half of the store is unused, the whole store is packed again.
+ */
+void update_store()
+{
+	if (!store.save())
+		fprintf(stderr, "Error updating %s\n", (char *)conf.store_file);
+	else if (verbose)
+		printf("Updated %s in place.\n", (char *)conf.store_file);
+
+	if (store.unused() * 2 > store.size())
+		pack_store();
+
+	return;
+}
+
+/**
+ * Whether a ticker's bar file, or the log of updates next to it, was written since the store was. The bar file
+ * is then the newer copy of the ticker. Runs without the store touch the data directory whenever they save, so
+ * the files are only looked at when it is newer than the store.
+ */
+bool newer_than_store(const char *bars_file)
+{
+	char *log_file;
+	bool ret;
+
+	if (!store_behind)
+		return false;
+
+	log_file = (char *)malloc(strlen(bars_file) + 5);
+	sprintf(log_file, "%s.log", bars_file);
+	ret = store.older_than(bars_file) || store.older_than(log_file);
+	free(log_file);
+
+	return ret;
+}
+
+/**
+ * Mark the data directory as written, for runs with --store to notice. Appending to a log, or writing over a
+ * file, does not change the directory by itself.
+ */
+void saved_outside_store()
+{
+	if (utimes(conf.stock_dir, NULL) == -1)
+		BOOST_LOG_TRIVIAL(error) << "Unable to touch " << (char *)conf.stock_dir << ": " << strerror(errno);
+
+	return;
+}
+
+/* Call load_ticker() for each stock locally cached */
+void update_tickers()
+{
+	long x, rows = 0, /*weekly_rows = 0, divergence_rows = 0,*/ all_rows = 0;
+	stockinfo history;
+	stockinfo_view data;
+	double *sma5 = nullptr, *low52_data = nullptr, *high52_data = nullptr;
+	simple_moving_average sma;
+	series_buffer sma5_buffer, low52_buffer, high52_buffer;
+	low lows;
+	high highs;
+	std::vector<screener> screeners(walk_back ? threads : 1);
+	struct ticker_walk walk;
+	live_indicators live;
+	struct live_indicators_file state;
+	char *live_file;
+	int32_t changed;
+	bool fresh, advanced;
+
+	find_tickers();
+
 	//if (!offline && intraday)
 	//	download_intraday_data();
 
@@ -566,168 +840,286 @@ void update_tickers()
 	for (x = 0; x < conf.tickers.size(); x++)
 	{
 		// Load the ticker data and remember our spot.
-		stockinfo data = load_ticker(conf.tickers[x]); //, &data, &rows);
-		all_data = data;
+		history = load_ticker(conf.tickers[x], &changed, &fresh); //, &data, &rows);
+		data = stockinfo_view(history);
 		all_rows = rows;
 		rows = data.length();
 
 		// If we loaded data...
 		if (rows)
 		{
+			// Carry the live indicators on from the last run, with just the new bars.
+			if (!store.is_open())
+			{
+				live_file = conf.get_filename(conf.tickers[x], "live");
+				live.load(live_file);
+				free(live_file);
+			}
+			else if (!store.read(conf.tickers[x], store_live, &state, sizeof(state)) || !live.restore(state))
+				live.reset();
+			advanced = (live.advance(data, changed) > 0);
+			save_ticker(conf.tickers[x], history, changed, fresh, live, advanced);
+
+			// A walk-back screens the history a day shorter each time, and follows each setup up with the 5-day SMA.
 			if (walk_back)
 			{
-				sma5 = sma.generate(data, 5, rows - 11);
+				sma5 = sma5_buffer.reserve(series_size(rows - 11));
+				sma.fill(data, 5, rows - 11, sma5);
 			}
 
-			// Review the data.
-			do {
-				found_setup = false;
-				if (walk_back && verbose)
-					printf("**%s**\n", data[0]->date);
+			// The 52-week range of every day that the screen looks at, in one pass.
+			if (low52)
+			{
+				low52_data = low52_buffer.reserve(series_size(rows));
+				high52_data = high52_buffer.reserve(series_size(rows));
+				lows.fill(data, price_low, 251, walk_back ? rows : 1, low52_data);
+				highs.fill(data, price_high, 251, walk_back ? rows : 1, high52_data);
+			}
 
-				vol = average_volume(data);
+			// Review the data, a day at a time if walking back.
+			walk.ticker = conf.tickers[x];
+			walk.all_data = data;
+			walk.rows = rows;
+			walk.all_rows = all_rows;
+			walk.sma5 = sma5;
+			walk.low52_data = low52_data;
+			walk.high52_data = high52_data;
+			walk.live = &live;
+			walk_days(walk, screeners, (walk_back && (rows > 100)) ? rows : 1);
+		}
+		else
+		{
+			printf("Failed to load stock: %s\n", conf.tickers[x]);
+		}
+	}
 
-				if (script != nullptr) {
-					result = rs.parse(script, data);
-					res = atof(result.c_str());
+	// Keep the store in step with anything we saved.
+	if (store.pending())
+		update_store();
 
-					if (res) {
-						printf("%5s: %s.\n", conf.tickers[x], rs.last_variables.c_str());
-					}
-				}
-				else if (find_divergence)
-				{
-					// TODO: Detect MACD cross-over signal after divergence ->
-					macd_h = macd.histogram(data, 12, 26, 9, rows - 26);
-					if (((*macd_h > 0) && (macd_h[1] < 0)) || ((*macd_h < 0) && (macd_h[1] > 0))) {
-						divergence_data = data;
-						divergence_data.shift();
-						diverge(conf.tickers[x], divergence_data, "MACD x-over after daily");
-					}
+	return;
+}
+
+/**
+ * Screen the days of a ticker's walk-back in chunks, spread over a thread per screener, and print the results of
+ * each chunk in the order of its days. Day 0 is the newest.
+ */
+void walk_days(const ticker_walk &walk, std::vector<screener> &screeners, long days)
+{
+	std::vector<std::thread> pool;
+	std::vector<char *> text;
+	std::vector<size_t> sizes;
+	std::atomic<long> next(0);
+	long chunks, x;
+
+	// Series that start from the oldest day are worked out once per screener for the whole history, and each day
+	// reads them from its own newest day.
+	if (walk_back)
+		for (x = 0; x < (long)screeners.size(); x++)
+		{
+			screeners[x].indicators.walk(walk.all_data);
+			screeners[x].shifted.walk(walk.all_data);
+		}
+
+	// A few chunks per thread, so that none is left with the longest of them at the end.
+	chunks = std::min(days, (long)screeners.size() * 4);
+	if ((screeners.size() < 2) || (chunks < 2))
+	{
+		screen_days(walk, screeners[0], 0, days);
+		return;
+	}
 
-					diverge_daily = diverge(conf.tickers[x], data, "potential daily");
+	text.assign(chunks, nullptr);
+	sizes.assign(chunks, 0);
+	for (x = 0; x < (long)screeners.size(); x++)
+		pool.emplace_back([&, x]()
+		{
+			long chunk;
 
-					weekly_data = data.weekly();
-					diverge_weekly = diverge(conf.tickers[x], weekly_data, "potential weekly");
+			while ((chunk = next++) < chunks)
+			{
+				screen_out = open_memstream(&text[chunk], &sizes[chunk]);
+				screen_days(walk, screeners[x], chunk * days / chunks, (chunk + 1) * days / chunks);
+				fclose(screen_out);
+			}
+			screen_out = stdout;
+		});
 
-					found_setup = (diverge_daily || diverge_weekly);
-					if (diverge_daily && diverge_weekly)
-						printf("\n%s, %s: Daily and Weekly triple divergence!\n\n", data[0]->date, conf.tickers[x]);
+	for (x = 0; x < (long)pool.size(); x++)
+		pool[x].join();
 
-					if (macd_h)
-						free(macd_h);
-				}
-				//else if (find_tails)
-				//	tails(conf.tickers[x], data);
-				else if (low52)
-					low52wk(conf.tickers[x], data);
-				else if (narrow_bbands)
-					found_setup = bbands_narrow(conf.tickers[x], data);
-				//else if (test)
-				//	test_screener(conf.tickers[x], data);
-				else //if (vol > 1000000)
-					analyze(conf.tickers[x], data);
-				//else if (verbose)
-				//	printf("%s, %s: volume = %li\n", data[0]->date, conf.tickers[x], vol);
-
-				// TODO?: There are more efficient ways to do this than to re-run the full test for every day.
-				if (walk_back && (rows > 100))
+	for (x = 0; x < chunks; x++)
+	{
+		fwrite(text[x], 1, sizes[x], stdout);
+		free(text[x]);
+	}
+
+	return;
+}
+
+/**
+ * Screen days first to last - 1 of a ticker's walk-back, or just its newest day when not walking back.
+ */
+void screen_days(const ticker_walk &walk, screener &with, long first, long last)
+{
+	const char *ticker = walk.ticker;
+	const double *sma5 = walk.sma5, *low52_data = walk.low52_data, *high52_data = walk.high52_data;
+	const double *macd_h;
+	long day, pos, position, rows = walk.rows, all_rows = walk.all_rows, vol = 0, distance1, distance2;
+	stockinfo_view data(walk.all_data), all_data(walk.all_data), divergence_data;
+	bool diverge_daily, diverge_weekly, found_setup, cont;
+	int direction1, direction2;
+	double res, movement1, movement2;
+	std::string result;
+
+	data.shift(first);
+	for (day = first; day < last; day++)
+	{
+		found_setup = false;
+		if (walk_back && verbose)
+			fprintf(screen_out, "**%s**\n", data[0]->date);
+
+		vol = average_volume(data);
+		with.indicators.reset(data);
+
+		if (script != nullptr) {
+			with.rs.out = screen_out;
+			result = with.rs.parse(script, data, walk.live, &with.indicators);
+			res = atof(result.c_str());
+
+			if (res) {
+				fprintf(screen_out, "%5s: %s.\n", ticker, with.rs.last_variables.c_str());
+			}
+		}
+		else if (find_divergence)
+		{
+			// TODO: Detect MACD cross-over signal after divergence ->
+			macd_h = with.indicators.histogram(12, 26, 9, rows - 26);
+			if (((*macd_h > 0) && (macd_h[1] < 0)) || ((*macd_h < 0) && (macd_h[1] > 0))) {
+				divergence_data = data;
+				divergence_data.shift();
+				with.shifted.reset(divergence_data);
+				diverge(ticker, with.shifted, "MACD x-over after daily", screen_out, verbose);
+			}
+
+			diverge_daily = diverge(ticker, with.indicators, "potential daily", screen_out, verbose);
+			diverge_weekly = diverge(ticker, with.indicators.timeframe(1, week, week_alignment), "potential weekly", screen_out, verbose);
+
+			found_setup = (diverge_daily || diverge_weekly);
+			if (diverge_daily && diverge_weekly)
+				fprintf(screen_out, "\n%s, %s: Daily and Weekly triple divergence!\n\n", data[0]->date, ticker);
+		}
+		//else if (find_tails)
+		//	tails(conf.tickers[x], data);
+		else if (low52)
+			low52wk(ticker, data, low52_data[all_data.length() - data.length()], high52_data[all_data.length() - data.length()]);
+		else if (narrow_bbands)
+			found_setup = bbands_narrow(ticker, with.indicators);
+		//else if (test)
+		//	test_screener(conf.tickers[x], data);
+		else //if (vol > 1000000)
+			analyze(ticker, with.indicators);
+		//else if (verbose)
+		//	printf("%s, %s: volume = %li\n", data[0]->date, conf.tickers[x], vol);
+
+		if (walk_back && (rows > 100))
+		{
+			// Determine follow-up movement.
+			if (found_setup)
+			{
+				// TODO: Weak direction comparison.
+				position = pos = all_rows - rows;
+				if (position > 3)
 				{
-					// Determine follow-up movement.
-					if (found_setup)
+					direction1 = ((sma5[pos] > sma5[pos - 1]) || ((sma5[pos] == sma5[pos - 1]) && (sma5[pos - 1] == sma5[pos - 2]))) ? DOWN : UP;
+					distance1 = 0;
+					movement1 = 0;
+					do
 					{
-						// TODO: Weak direction comparison.
-						position = pos = all_rows - rows;
-						if (position > 3)
+						pos--;
+						if (direction1 == UP)
 						{
-							direction1 = ((sma5[pos] > sma5[pos - 1]) || ((sma5[pos] == sma5[pos - 1]) && (sma5[pos - 1] == sma5[pos - 2]))) ? DOWN : UP;
-							distance1 = 0;
-							movement1 = 0;
-							do
-							{
-								pos--;
-								if (direction1 == UP)
-								{
-									if (all_data[pos]->close - all_data[position]->close > movement1)
-										movement1 = all_data[pos]->close - all_data[position]->close;
-									cont = (sma5[pos - 1] >= sma5[pos]);
-								}
-								else
-								{
-									if (all_data[position]->close - all_data[pos]->close < movement1)
-										movement1 = all_data[pos]->close - all_data[position]->close;
-									cont = (sma5[pos] >= sma5[pos - 1]);
-								}
-								//printf("%s (%s vs. %s): %.02f (%li), %.02f (%li), %.02f\n", direction1 == UP ? "UP" : "DOWN", all_data[position]->date, all_data[pos]->date, all_data[position].close, position, all_data[pos].close, pos, movement1);
-								distance1++;
-							} while ((pos > 1) && cont);
-							//for (distance1 = 1; (pos > 1) && (sma5[pos] >= sma5[pos -  1]); pos--);
-							direction2 = (direction1 == UP) ? DOWN : UP;
-							distance2 = 0;
-							movement2 = 0;
-							position = pos;
-							cont = true;
-							pos--;
-							for (; (pos > 1) && cont; pos--)
-							{
-								if (direction2 == UP)
-								{
-									if (all_data[pos]->close - all_data[position]->close > movement2)
-										movement2 = all_data[pos]->close - all_data[position]->close;
-									cont = (sma5[pos - 1] >= sma5[pos]);
-								}
-								else
-								{
-									if (all_data[pos]->close - all_data[position]->close < movement2)
-										movement2 = all_data[pos]->close - all_data[position]->close;
-									cont = (sma5[pos] >= sma5[pos - 1]);
-								}
-								//printf("%s (%s vs. %s): %.02f (%li), %.02f (%li), %.02f\n", direction2 == UP ? "UP" : "DOWN", all_data[position].date, all_data[pos].date, all_data[position].close, position, all_data[pos].close, pos, movement2);
-								distance2++;
-							}
-
-							printf("    Follow-up: %s for %li (%+.02f); %s for %li (%+.02f)\n\n", (direction1 == UP ? "UP" : "DOWN"), distance1, movement1, (direction2 == UP ? "UP" : "DOWN"), distance2, movement2);
+							if (all_data[pos]->close - all_data[position]->close > movement1)
+								movement1 = all_data[pos]->close - all_data[position]->close;
+							cont = (sma5[pos - 1] >= sma5[pos]);
 						}
+						else
+						{
+							if (all_data[position]->close - all_data[pos]->close < movement1)
+								movement1 = all_data[pos]->close - all_data[position]->close;
+							cont = (sma5[pos] >= sma5[pos - 1]);
+						}
+						//printf("%s (%s vs. %s): %.02f (%li), %.02f (%li), %.02f\n", direction1 == UP ? "UP" : "DOWN", all_data[position]->date, all_data[pos]->date, all_data[position].close, position, all_data[pos].close, pos, movement1);
+						distance1++;
+					} while ((pos > 1) && cont);
+					//for (distance1 = 1; (pos > 1) && (sma5[pos] >= sma5[pos -  1]); pos--);
+					direction2 = (direction1 == UP) ? DOWN : UP;
+					distance2 = 0;
+					movement2 = 0;
+					position = pos;
+					cont = true;
+					pos--;
+					for (; (pos > 1) && cont; pos--)
+					{
+						if (direction2 == UP)
+						{
+							if (all_data[pos]->close - all_data[position]->close > movement2)
+								movement2 = all_data[pos]->close - all_data[position]->close;
+							cont = (sma5[pos - 1] >= sma5[pos]);
+						}
+						else
+						{
+							if (all_data[pos]->close - all_data[position]->close < movement2)
+								movement2 = all_data[pos]->close - all_data[position]->close;
+							cont = (sma5[pos] >= sma5[pos - 1]);
+						}
+						//printf("%s (%s vs. %s): %.02f (%li), %.02f (%li), %.02f\n", direction2 == UP ? "UP" : "DOWN", all_data[position].date, all_data[pos].date, all_data[position].close, position, all_data[pos].close, pos, movement2);
+						distance2++;
 					}
 
-					data = stock_bump_day(data);
+					fprintf(screen_out, "    Follow-up: %s for %li (%+.02f); %s for %li (%+.02f)\n\n", (direction1 == UP ? "UP" : "DOWN"), distance1, movement1, (direction2 == UP ? "UP" : "DOWN"), distance2, movement2);
 				}
-			} while (walk_back && data.length() && (rows > 100));
+			}
 
-			// Clean up.
-			if (walk_back && sma5)
-				free(sma5);
-		}
-		else
-		{
-			printf("Failed to load stock: %s\n", conf.tickers[x]);
+			data = stock_bump_day(data);
 		}
 	}
 
 	return;
 }
 
-/* Load ticker data (file, then internet) and parse */
-stockinfo load_ticker(const char *ticker) //, stock **data, long *rows)
+/* Load ticker data (file, then internet) and parse. changed is set to the oldest day that was added or corrected,
+ * or INT32_MIN if it is not known which days the last run saw. fresh is set if the bars need saving. */
+stockinfo load_ticker(const char *ticker, int32_t *changed, bool *fresh) //, stock **data, long *rows)
 {
-	long x; //, len;
-	char /* *tmp,*/ *block, *blocknew, *filename;
+	char /* *tmp,*/ *block, *blocknew, *filename, *csv_file;
 	comma_separated_values csv;
+	bool from_store, from_csv = false;
 	stockinfo s;
-	long rows;
+	long rows = 0;
 	time_t from;
 
-	filename = conf.get_filename(ticker);
-	if (!s.load_csv(filename)) {
+	// Prefer the store, unless the bar file was written since. Fall back to CSV data from before either existed.
+	filename = conf.get_filename(ticker, "bars");
+	csv_file = conf.get_filename(ticker);
+	from_store = store.is_open() && !newer_than_store(filename) && store.load(ticker, s);
+	*fresh = false;
+	if (!from_store && !s.load_bars(filename) && !(from_csv = s.load_csv(csv_file))) {
 		if (offline || ((block = download_eod_data(ticker, 0)) == NULL))
 		{
 			if (verbose)
 				printf("Unable to load %s from server. Giving up.\n", ticker);
 
+			*changed = INT32_MIN;
+			free(filename);
+			free(csv_file);
 			return s;
 		}
 	}
 
+	// CSV data was not seen as bars, so nothing made from it can be carried on.
+	*changed = from_csv ? INT32_MIN : INT32_MAX;
+
 	if (s.length()) {
 		if ((from = get_last_date(s)) != 0) {
 			if (!offline && ((blocknew = download_eod_data(ticker, from)) != NULL)) {
@@ -737,72 +1129,111 @@ stockinfo load_ticker(const char *ticker) //, stock **data, long *rows)
 				//tmp = (char *)malloc(strlen(block) + strlen(blocknew) + 2);
 				//sprintf(tmp, "%s\n%s", blocknew, block);
 
-				free(blocknew);
-
-				stock *temp = csv.parse(blocknew, &rows);
-				for (x = 0; x < rows; x++) {
-					s.insert_at(temp[x], x);
+				stockinfo fresh;
+				if ((rows = csv.parse(blocknew, blocknew + strlen(blocknew), fresh)) > 0) {
+					*changed = std::min(*changed, *std::min_element(fresh.days(), fresh.days() + fresh.length()));
+					s.merge(fresh);
 				}
-				free(temp);
+				free(blocknew);
 			}
 		}
 
-		s.save_csv(filename);
+		// Data from the store only needs saving if it changed.
+		*fresh = !from_store || (rows > 0);
 	} else {
 		// TODO: Delist?
 	}
 
 	free(filename);
+	free(csv_file);
 
 	return s;
 }
 
+/**
+ * Keep what this run worked out for a ticker: its bars if they are fresh, its calendar weeks with
+ * --calendar-weeks, and the state of its live indicators if they advanced. With --store, they go in the store
+ * together, and are only written to files next to the daily bars if the store cannot take them.
+ */
+void save_ticker(const char *ticker, stockinfo &s, int32_t changed, bool fresh, const live_indicators &live, bool advanced)
+{
+	struct live_indicators_file state;
+	stockinfo weeks;
+	char *filename;
+
+	if (store.is_open())
+	{
+		if (!fresh && !advanced)
+			return;
+
+		// Only the latest calendar week changes, unless the download corrected an older day. Nothing reads
+		// calendar months or years.
+		if (week_alignment == align_calendar) {
+			store.load(ticker, weeks, store_week_bars);
+			weeks.roll_forward(s, week, changed);
+		}
+
+		state = live.snapshot();
+		if (store.replace(ticker, s, &weeks, &state, sizeof(state)))
+			return;
+	}
+
+	filename = conf.get_filename(ticker, "bars");
+	if (fresh && s.save_bars(filename))
+		saved_outside_store();
+	free(filename);
+
+	if (week_alignment == align_calendar) {
+		stockinfo bars;
+		filename = conf.get_filename(ticker, "week.bars");
+		bars.load_bars(filename);
+		bars.roll_forward(s, week, changed).save_bars(filename);
+		free(filename);
+	}
+
+	if (advanced || store.is_open()) {
+		filename = conf.get_filename(ticker, "live");
+		live.save(filename);
+		free(filename);
+	}
+
+	return;
+}
+
 /* Get the last date we have data for, skip weekends */
 time_t get_last_date(stockinfo &data)
 {
-	struct tm last, now;
-	time_t tmp, ret = 0;
-
-	last.tm_hour = 0;
-	last.tm_min = 0;
-	last.tm_sec = 1;
-	last.tm_isdst = -1;
-	if (!strptime(data[0]->date, "%Y-%m-%d", &last))
-		if (!strptime(data[0]->date, "%d-%B-%y", &last))
-			return 0;
-
-	if ((tmp = mktime(&last)) == -1)
+	struct tm now;
+	int32_t last, ret, today;
+	time_t tmp;
+
+	if (data.length() == 0)
 		return 0;
 
-	ret = tmp;
-	tmp += 86400;
-	memcpy(&last, localtime(&tmp), sizeof(struct tm));
-	if ((last.tm_wday == 0) || (last.tm_wday == 6))
+	ret = last = data.days()[0];
+	last++;
+	if ((weekday_from_days(last) == 0) || (weekday_from_days(last) == 6))
 	{
-		ret = tmp;
-		tmp += 86400;
-		memcpy(&last, localtime(&tmp), sizeof(struct tm));
-		if ((last.tm_wday == 0) || (last.tm_wday == 6))
-			ret = tmp;
+		ret = last;
+		last++;
+		if ((weekday_from_days(last) == 0) || (weekday_from_days(last) == 6))
+			ret = last;
 	}
 
 	time(&tmp);
-	if (ret > tmp)
-		ret = 0;
-
-	time(&tmp);
-	memcpy(&now, localtime(&tmp), sizeof(struct tm));
+	localtime_r(&tmp, &now);
+	today = days_from_civil(now.tm_year + 1900, now.tm_mon + 1, now.tm_mday);
 
-	if ((now.tm_mday == last.tm_mday) && (now.tm_mon  == last.tm_mon) && (now.tm_year == last.tm_year))
-		ret = 0;
+	if ((ret > today) || (last == today))
+		return 0;
 
-	return ret;
+	return (time_t)ret * SECONDS_PER_DAY;
 }
 
 /**
  * Average the stocks volume from the last two weeks.
  */
-long average_volume(const stockinfo &data, long n)
+long average_volume(const stockinfo_view &data, long n)
 {
 	long rows = data.length();
 	long ret = 0;
@@ -878,167 +1309,13 @@ long average_volume(const stockinfo &data, long n)
 /**
  * Bump the latest day/week from loaded stock data.
  *
- * @returns A new stockinfo object
- */
-stockinfo stock_bump_day(stockinfo &data)
-{
-	long rows = data.length();
-	stockinfo ret;
-
-	if (rows < 1)
-		return ret;
-
-	ret = data;
-	ret.shift();
-	return ret;
-}
-
-/**
- * Reduce a loaded stock struct to an array of close prices.
- */
-double *stock_reduce_close(const stockinfo &data, long rows) {
-	double *ret = NULL;
-	long x;
-
-	if (rows <= 0)
-	{
-		ret = (double *)malloc(sizeof(double));
-		ret[0] = 0;
-		return ret;
-	}
-
-	ret = (double *)malloc(sizeof(double) * (rows + 1));
-	for (x = 0; x < rows; x++)
-		ret[x] = data[x]->close;
-
-	return ret;
-}
-
-/**
- * Try to find triple divergences, as defined by Chris Verheigh (The Option Trainer).
- *
- * TODO: Generate a list of highs/lows from BB resets, then compare their placement to each other. The
- * code currently finds "divergences" of different indicators at different locations - which means they
- * aren't really divergences.
- *
- * TODO: We need a strength indicator.
+ * @returns A view of the same rows, less the latest one. Nothing is copied.
  */
-bool diverge(const char *ticker, const stockinfo &data, const char *desc)
+stockinfo_view stock_bump_day(const stockinfo_view &data)
 {
-	const char *debug_modes[] = {"IGNORED", "HIGHER HIGH", "LOWER HIGH", "HIGHER LOW", "LOWER LOW"};
-
-	moving_average_convergence_divergence macd;
-	relative_strength_index rsi;
-	simple_moving_average sma;
-	bollinger bb;
-	bool is_uptrend, is_diverging = false;
-	double *stock_close = NULL, /* *sma_weekly = NULL,*/ *sma_data = NULL, *bb_data = NULL, *rsi_data = NULL, *macd_data = NULL, *macd_h = NULL;
-	long trend_change = 0, reset_h = 0, reset_l = 0, found_divergence = 0, x;
-	int d_stock, d_rsi, d_macd, d_macd_h;
-	long rows = data.length();
+	stockinfo_view ret = data;
 
-	//sma_weekly = sma.generate(data, 5, rows - 11);
-	sma_data = sma.generate(data, 20, rows - 26);
-	bb_data = bb.bands(data, 20, 2, rows - 26);
-
-	// Find the current "trend" - "up" or "down."
-	x = 0;
-	do
-	{
-		x++;
-		is_uptrend = (sma_data[x] > sma_data[x-1]);
-	} while (sma_data[x] == sma_data[x-1]);
-
-	for (; x < rows; x++)
-	{
-		// If the SMA trend direction changed.
-		if (is_uptrend ? (sma_data[x - 1] > sma_data[x]) : (sma_data[x] > sma_data[x - 1]))
-		{
-			trend_change = x;
-			break;
-		}
-	}
-
-	// We can use shorter values, but 1-3 are almost useless.
-	if (trend_change > 5)
-		trend_change = 5;
-
-	// Prices outside the Bollinger Bands reset are reset points for our "high" and "low" patterns. I think CV said to do this sometime.
-	for (x = trend_change; x < rows; x++)
-	{
-		if ((reset_h == 0) && (data[x]->close > sma_data[x] + bb_data[x]))
-			reset_h = x;
-
-		if ((reset_l == 0) && (data[x]->close < sma_data[x] - bb_data[x]))
-			reset_l = x;
-
-		if ((reset_h > 0) && (reset_l > 0))
-			break;
-	}
-
-	// stock trend
-	stock_close = stock_reduce_close(data, rows);
-	d_stock = divergence(stock_close, rows - 26, reset_h, reset_l, NULL);
-
-	// rsi trend
-	d_rsi = IGNORED;
-	if ((d_stock == HIGHERHIGH) || (d_stock == LOWERLOW))
-	{
-		rsi_data = rsi.generate(data, 14, data.length() - 26);
-		d_rsi = divergence(rsi_data, data.length() - 26, reset_h, reset_l, &found_divergence);
-	}
-
-	// MACD trend
-	d_macd = IGNORED;
-	if (d_rsi && found_divergence)
-	{
-		macd_data = macd.generate(data, 12, 26, rows - 26);
-		d_macd = divergence(macd_data - 26, rows, reset_h, reset_l, &found_divergence);
-	}
-
-	// MACD histogram trend
-	d_macd_h = IGNORED;
-	if (d_macd)
-	{
-		macd_h = macd.histogram(data, 12, 26, 9, rows - 26);
-		if (((d_stock == HIGHERHIGH) && (macd_h[0] > 0)) || ((d_stock == LOWERLOW) && (macd_h[0] < 0)))
-			d_macd_h = divergence(macd_h, rows - 26, reset_h, reset_l, &found_divergence);
-	}
-
-	// Look for the divergence.
-	if (d_macd_h)
-	{
-		if (((d_stock == HIGHERHIGH) && (d_rsi == LOWERHIGH) && (d_macd == LOWERHIGH) && (d_macd_h == LOWERHIGH)) ||
-	    	    ((d_stock == LOWERLOW) && (d_rsi == HIGHERLOW) && (d_macd == HIGHERLOW) && (d_macd_h == HIGHERLOW)))
-		{
-			printf("%s, %s is in \033[%im%s\033[0m triple divergence\n", data[0]->date, ticker, (strncmp(desc, "potential", 6) == 0) ? 31 : 32, desc);
-			printf("    \033[%im%s\033[0m; Distance: %li, %s; %.02f, %.02f; RSI: %.02f, %.02f, %s; MACD: %.02f, %.02f, %s; MACD histogram: %.02f, %.02f, %s; high reset: %li/%s, low reset: %li/%s; Volume: %li!\n\n", (d_stock == HIGHERHIGH) ? 31 : 32, debug_modes[d_stock], found_divergence, data[found_divergence]->date, stock_close[found_divergence], *stock_close,
-					rsi_data[found_divergence], *rsi_data, debug_modes[d_rsi],
-					macd_data[found_divergence], *macd_data, debug_modes[d_macd],
-					macd_h[found_divergence], *macd_h, debug_modes[d_macd_h],
-					reset_h, data[reset_h]->date, reset_l, data[reset_l]->date, data[0]->volume);
-			is_diverging = true;
-		}
-		else if (verbose)
-			printf("%s, Stock: %s/%s, RSI: %s, MACD: %s, Histogram: %s\n", data[0]->date, ticker, debug_modes[d_stock], debug_modes[d_rsi], debug_modes[d_macd], debug_modes[d_macd_h]);
-	}
-	else if (verbose)
-		printf("%s, Stock: %s/%s, RSI: %s, MACD: %s, Histogram: %s\n", data[0]->date, ticker, debug_modes[d_stock], debug_modes[d_rsi], debug_modes[d_macd], debug_modes[d_macd_h]);
-
-	if (stock_close)
-		free(stock_close);
-	if (macd_h)
-		free(macd_h);
-	if (macd_data)
-		free(macd_data);
-	if (rsi_data)
-		free(rsi_data);
-	if (sma_data)
-		free(sma_data);
-	if (bb_data)
-		free(bb_data);
-
-	return is_diverging;
+	return ret.shift();
 }
 
 /**
@@ -1083,7 +1360,7 @@ bool diverge(const char *ticker, const stockinfo &data, const char *desc)
 	}
 
 	if ((count >= 4) || (count <= -4))
-		printf("%s, %s, strength: %i\n", data[0]->date, ticker, count);
+		fprintf(screen_out, "%s, %s, strength: %i\n", data[0]->date, ticker, count);
 
 	if (sma_data)
 		free(sma_data);
@@ -1096,30 +1373,30 @@ bool diverge(const char *ticker, const stockinfo &data, const char *desc)
 /**
  * Narrow bollinger bands.
  */
-bool bbands_narrow(const char *ticker, const stockinfo &data)
+bool bbands_narrow(const char *ticker, indicator_cache &indicators)
 {
-	simple_moving_average sma;
-	bollinger bb;
-	double *sma_data = nullptr, *bb_data = nullptr, narrowest = 0, widest = 0;
+	const stockinfo_view &data = indicators.bars();
+	struct bollinger_bands bands;
+	double *bb_data, narrowest = 0, widest = 0;
 	bool in_bands, ret = false;
 	long days_in_bands, x;
 	long rows = data.length();
 
-	sma_data = sma.generate(data, 20, rows - 26);
-	bb_data = bb.bands(data, 20, 2, rows - 26);
-
 	// TODO: Generalize me. Something like ./rsiscan '(volume > 100000) && (bb_top_daily < last_trade)'.
 	if (average_volume(data) < 500000)
 	{
 		if (verbose)
-			printf("%s, %s: Ignored for low volume.\n", data[0]->date, ticker);
+			fprintf(screen_out, "%s, %s: Ignored for low volume.\n", data[0]->date, ticker);
 		return ret;
 	}
 
-	if (!sma_data || !sma_data[0])
+	bands = indicators.bands(20, 2, rows - 26);
+	bb_data = bands.width;
+
+	if (!bands.middle[0])
 	{
 		if (verbose)
-			printf("%s, %s: Ignored because we have no SMA.\n", data[0]->date, ticker);
+			fprintf(screen_out, "%s, %s: Ignored because we have no SMA.\n", data[0]->date, ticker);
 		return ret;
 	}
 
@@ -1135,7 +1412,7 @@ bool bbands_narrow(const char *ticker, const stockinfo &data)
 			widest = bb_data[x];
 
 		//printf("%.02f, %.02f. %.02f\n", sma_data[x], bb_data[x], data[x].close);
-		if (in_bands && (sma_data[x] + bb_data[x] > data[x]->close) && (data[x]->close > sma_data[x] - bb_data[x]))
+		if (in_bands && (bands.upper[x] > data[x]->close) && (data[x]->close > bands.lower[x]))
 			days_in_bands++;
 		else
 			in_bands = false;
@@ -1145,7 +1422,7 @@ bool bbands_narrow(const char *ticker, const stockinfo &data)
 
 	if (ret)
 	{
-		printf("%s, \033[%im%s\033[0m: Narrow bands (In Bands: %li, Close: %.02f, Width: %.02f, Narrowest: %.02f, Widest: %.02f).\n", data[0]->date, (days_in_bands > 20) ? 32 : 0, ticker, days_in_bands, data[0]->close, bb_data[0], narrowest, widest);
+		fprintf(screen_out, "%s, \033[%im%s\033[0m: Narrow bands (In Bands: %li, Close: %.02f, Width: %.02f, Narrowest: %.02f, Widest: %.02f).\n", data[0]->date, (days_in_bands > 20) ? 32 : 0, ticker, days_in_bands, data[0]->close, bb_data[0], narrowest, widest);
 	}
 
 	return ret;
@@ -1153,28 +1430,27 @@ bool bbands_narrow(const char *ticker, const stockinfo &data)
 
 /**
  * Find stocks near their 52-week low.
+ *
+ * @param low52 The lowest low of the 251 rows from data[0], as low::find() gives it, or 0 without enough rows.
+ * @param high52 The highest high, as high::find() gives it.
  */
-void low52wk(const char *ticker, const stockinfo &data)
+void low52wk(const char *ticker, const stockinfo_view &data, double low52, double high52)
 {
-	low low;
-	high high;
-	double low52, high52, close;
+	double close;
 
 	close = data[0]->close;
-	low52 = low.find(data, 251);
-	high52 = high.find(data, 251);
 
 	if ((low52 == 0) || (high52 == 0))
 	{
 		if (verbose)
-			printf("%s, %s: close = %.2f, low52 = %.2f, high52 = %.2f\n", data[0]->date, ticker, close, low52, high52);
+			fprintf(screen_out, "%s, %s: close = %.2f, low52 = %.2f, high52 = %.2f\n", data[0]->date, ticker, close, low52, high52);
 		/*conf.delist(ticker);*/
 		return;
 	}
 
 	/* 15% */
 	if (close < (low52 + ((high52 - low52) * 0.15)))
-		printf("%s, %s: close = %.2f, low52 = %.2f, high52 = %.2f, range = %.2f\n", data[0]->date, ticker, close, low52, high52, high52 - low52);
+		fprintf(screen_out, "%s, %s: close = %.2f, low52 = %.2f, high52 = %.2f, range = %.2f\n", data[0]->date, ticker, close, low52, high52, high52 - low52);
 
 	return;
 }
@@ -1199,49 +1475,51 @@ void low52wk(const char *ticker, const stockinfo &data)
 	if (average_volume(data) < 500000)
 	{
 		if (verbose)
-			printf("%s, %s: Ignored for low volume.\n", data[0]->date, ticker);
+			fprintf(screen_out, "%s, %s: Ignored for low volume.\n", data[0]->date, ticker);
 		return;
 	}
 
 	if (!sma_data || !sma_data[0])
 	{
 		if (verbose)
-			printf("%s, %s: Ignored because we have no SMA.\n", data[0]->date, ticker);
+			fprintf(screen_out, "%s, %s: Ignored because we have no SMA.\n", data[0]->date, ticker);
 		return;
 	}
 
 	if ((data[0]->close > sma_data[0] + bb_data[0]) && (data[2]->close > sma_data[2] + bb_data[2]))
 	{
-		printf("%s, %s: Above Bollinger Bands (Close: %.02f, SMA: %.02f, BB: %.02f, volume: %li).\n", data[0]->date, ticker, data[0]->close, sma_data[0], bb_data[0], data[0]->volume);
+		fprintf(screen_out, "%s, %s: Above Bollinger Bands (Close: %.02f, SMA: %.02f, BB: %.02f, volume: %li).\n", data[0]->date, ticker, data[0]->close, sma_data[0], bb_data[0], data[0]->volume);
 	}
 	else if (data[0]->close < sma_data[0] - bb_data[0])
 	{
-		printf("%s, %s: Below Bollinger Bands (Close: %.02f, SMA: %.02f, BB: %.02f, volume: %li).\n", data[0]->date, ticker, data[0]->close, sma_data[0], bb_data[0], data[0]->volume);
+		fprintf(screen_out, "%s, %s: Below Bollinger Bands (Close: %.02f, SMA: %.02f, BB: %.02f, volume: %li).\n", data[0]->date, ticker, data[0]->close, sma_data[0], bb_data[0], data[0]->volume);
 	}
 }*/
 
 /* Print our analysis of the stock */
-void analyze(const char *ticker, stockinfo data)
+void analyze(const char *ticker, indicator_cache &indicators)
 {
-	relative_strength_index rsi;
-	double amount, *daily_rsi, *weekly_rsi;
-	stockinfo weekly;
+	const stockinfo_view &data = indicators.bars();
+	const double *daily_rsi, *weekly_rsi;
+	double amount;
 	bool list = false;
 	//long w_rows;
 
-	daily_rsi = rsi.generate(data, 14, 1);
+	daily_rsi = indicators.rsi(14, 1);
 
 	/* delisted or bought out */
 	if ((*daily_rsi == 0) || (*daily_rsi == 100))
 	{
 		if (verbose)
-			printf("%s, %s: rsi = %f\n", data[0]->date, ticker, *daily_rsi);
-		conf.delist(ticker);
+			fprintf(screen_out, "%s, %s: rsi = %f\n", data[0]->date, ticker, *daily_rsi);
+		std::lock_guard<std::mutex> guard(conf_lock);
+		conf.delist(ticker, &store);
 		return;
 	}
 
-	weekly = data.weekly();
-	weekly_rsi = rsi.generate(weekly, 14, 12);
+	indicator_cache &weekly_indicators = indicators.timeframe(1, week, week_alignment);
+	const stockinfo_view &weekly = weekly_indicators.bars();
+	weekly_rsi = weekly_indicators.rsi(14, 12);
 
 	/* Decide whether to show the stock or not */
 	amount = (data[0]->close - data[1]->close) / data[0]->close * 100;
@@ -1263,92 +1541,29 @@ void analyze(const char *ticker, stockinfo data)
 		if (percent > 0)
 		{
 			if (amount > percent)
-				printf("%s, %+.2f: %s\n", data[0]->date, amount, ticker);
+				fprintf(screen_out, "%s, %+.2f: %s\n", data[0]->date, amount, ticker);
 		}
 		else
 		{
-			printf("%s, %s:\n", data[0]->date, ticker);
+			fprintf(screen_out, "%s, %s:\n", data[0]->date, ticker);
 			if (*daily_rsi < 30)
-				printf("\tDaily RSI: %03.2f < 30\n", *daily_rsi);
+				fprintf(screen_out, "\tDaily RSI: %03.2f < 30\n", *daily_rsi);
 			else if (*daily_rsi > 70)
-				printf("\tDaily RSI: %03.2f > 70\n", *daily_rsi);
+				fprintf(screen_out, "\tDaily RSI: %03.2f > 70\n", *daily_rsi);
 			if (*weekly_rsi < 30)
-				printf("\tWeekly RSI: %03.2f < 30\n", *weekly_rsi);
+				fprintf(screen_out, "\tWeekly RSI: %03.2f < 30\n", *weekly_rsi);
 			else if (*weekly_rsi > 70)
-				printf("\tWeekly RSI: %03.2f > 70\n", *weekly_rsi);
+				fprintf(screen_out, "\tWeekly RSI: %03.2f > 70\n", *weekly_rsi);
 
 			chart_patterns(data, true, "daily");
 			chart_patterns(weekly, true, "weekly");
 		}
 	}
 
-	free(daily_rsi);
-	free(weekly_rsi);
-
 	return;
 }
 
-/**
- * Trend: Determine whether the current value (values[0]) is a Higher High, Lower High, Higher Low, or Lower Low.
- *
- * @param values The values to check against each other.
- * @param rows The number of values we have.
- * @param reset_high How far back do we go before we stop checking for additional highs?
- * @param reset_low How far back do we go before we stop checking for additional lows?
- * @param pos - NULL => Ignored. 0 => Return location we found. +/- => Try to find a divergence near pos.
- */
-int divergence(const double *values, long rows, long reset_high, long reset_low, long *pos)
-{
-	int ret = IGNORED;
-	bool matches_direction;
-	long x, start, stop, found = 0;
-
-	if ((rows < 3) || (rows <= reset_high) || (rows <= reset_low))
-		return ret;
-
-	// Find highs.
-	if ((reset_low > 0) && (values[0] > values[1]) && (values[0] > values[2]))
-	{
-		ret = HIGHERHIGH;
-		start = (pos && *pos) ? *pos - 1 : 2;
-		stop = (pos && *pos) ? *pos + 2 : reset_low;
-		for (x = start; x < stop; x++)
-		{
-			matches_direction = true; //((values[0] < 0) && (values[x] < 0)) || ((values[0] > 0) && (values[x] > 0));
-			if (values[x] > values[found] && matches_direction)
-			{
-				ret = LOWERHIGH;
-				found = x;
-				break;
-			}
-		}
-	}
-
-	// Find lows.
-	else if ((reset_high > 0) && (values[0] < values[1]) && (values[0] < values[2]))
-	{
-		ret = LOWERLOW;
-		start = (pos && *pos) ? *pos - 1 : 2;
-		stop = (pos && *pos) ? *pos + 2 : reset_high;
-		for (x = start; x < stop; x++)
-		{
-			matches_direction = true; //((values[0] < 0) && (values[x] < 0)) || ((values[0] > 0) && (values[x] > 0));
-			if ((values[x] < values[found]) && matches_direction)
-			{
-				ret = HIGHERLOW;
-				found = x;
-				break;
-			}
-		}
-	}
-
-	if (pos)
-		*pos = found;
-
-	return ret;
-}
-
-bool chart_patterns(const stockinfo &data, bool print, const char *period)
+bool chart_patterns(const stockinfo_view &data, bool print, const char *period)
 {
 	//struct tm last;
 	bool ret = false;
@@ -1367,13 +1582,13 @@ bool chart_patterns(const stockinfo &data, bool print, const char *period)
 		{
 			if (!print)
 			       return true;
-			printf("\t%s: Dragonfly on the %s (high = open = close)!\n", data[0]->date, period);
+			fprintf(screen_out, "\t%s: Dragonfly on the %s (high = open = close)!\n", data[0]->date, period);
 		}
 		else if (data[0]->close == data[0]->open == data[0]->low)
 		{
 			if (!print)
 				return true;
-			printf("\t%s, Tombstone on the %s (low = open = close)!\n", data[0]->date, period);
+			fprintf(screen_out, "\t%s, Tombstone on the %s (low = open = close)!\n", data[0]->date, period);
 		}
 	}
 
@@ -1418,13 +1633,13 @@ bool chart_patterns(const stockinfo &data, bool print, const char *period)
 	{
 		if (!print)
 			return true;
-		printf("\t%s, 52-week low: $%d\n", data[0]->date, low);
+		fprintf(screen_out, "\t%s, 52-week low: $%d\n", data[0]->date, low);
 	}
 	if (high > 0)
 	{
 		if (!print)
 			return true;
-		printf("\t%s, 52-week high: $%d\n", data[0]->date, high);
+		fprintf(screen_out, "\t%s, 52-week high: $%d\n", data[0]->date, high);
 	}*/
 
 	return ret;
@@ -0,0 +1,241 @@
+#include "lib/third_party/catch2/catch.hpp"
+#include <string.h>
+#include <unistd.h>
+#include <sys/time.h>
+#include "lib/bar_store.h"
+using namespace Catch;
+
+TEST_CASE("Pack and read a store", "[bar_store]") {
+	stockinfo aaa, bbb, loaded;
+	bar_store writer, reader;
+	struct stock s;
+
+	s.date = (char *)"2017-10-09";
+	s.open = 2;
+	s.high = 4;
+	s.low = 1;
+	s.close = 3;
+	s.volume = 2;
+	aaa += s;
+
+	s.date = (char *)"2017-10-10";
+	s.close = 7;
+	bbb += s;
+	s.date = (char *)"2017-10-09";
+	s.close = 6;
+	bbb += s;
+
+	REQUIRE(writer.create("rsiscan-test.store") == true);
+	REQUIRE(writer.append("aaa", aaa) == true);
+	REQUIRE(writer.append("BBB", bbb) == true);
+	REQUIRE(writer.commit() == true);
+
+	REQUIRE(reader.open("rsiscan-test.store") == true);
+	unlink("rsiscan-test.store");
+
+	// Symbols are stored in upper case, in the order they were added.
+	REQUIRE(reader.length() == 2);
+	REQUIRE_THAT(reader.symbol(0), Equals("AAA"));
+	REQUIRE_THAT(reader.symbol(1), Equals("BBB"));
+	REQUIRE(reader.symbol(2) == nullptr);
+
+	// Look tickers up in any case.
+	REQUIRE(reader.load("bbb", loaded) == true);
+	REQUIRE(loaded.length() == 2);
+	REQUIRE(loaded[0]->close == 7);
+	REQUIRE(loaded[1]->close == 6);
+
+	REQUIRE(reader.load("AAA", loaded) == true);
+	REQUIRE(loaded.length() == 1);
+	REQUIRE(loaded[0]->close == 3);
+
+	REQUIRE(reader.load("CCC", loaded) == false);
+}
+
+TEST_CASE("Replace tickers in an open store", "[bar_store]") {
+	stockinfo aaa, bbb, ccc, loaded;
+	bar_store writer, store, reader;
+	struct stock s = {};
+	uint64_t size;
+
+	s.date = (char *)"2017-10-09";
+	s.close = 3;
+	aaa += s;
+	bbb += s;
+	s.date = (char *)"2017-10-10";
+	s.close = 7;
+	ccc += s;
+
+	REQUIRE(writer.create("rsiscan-test.store") == true);
+	REQUIRE(writer.append("AAA", aaa) == true);
+	REQUIRE(writer.append("BBB", bbb) == true);
+	REQUIRE(writer.commit() == true);
+
+	REQUIRE(store.open("rsiscan-test.store") == true);
+	REQUIRE(store.unused() == 0);
+	size = store.size();
+
+	// Nothing changes for readers until the store is saved.
+	bbb += s;
+	REQUIRE(store.replace("bbb", bbb) == true);
+	REQUIRE(store.replace("CCC", aaa) == true);
+	REQUIRE(store.replace("ccc", ccc) == true);
+	REQUIRE(reader.open("rsiscan-test.store") == true);
+	REQUIRE(reader.length() == 2);
+	REQUIRE(reader.load("BBB", loaded) == true);
+	REQUIRE(loaded.length() == 1);
+
+	REQUIRE(store.save() == true);
+	REQUIRE(store.length() == 3);
+	REQUIRE_THAT(store.symbol(2), Equals("CCC"));
+	REQUIRE(store.size() > size);
+	REQUIRE(store.unused() > 0);
+
+	REQUIRE(reader.open("rsiscan-test.store") == true);
+	unlink("rsiscan-test.store");
+	REQUIRE(reader.length() == 3);
+	REQUIRE(reader.load("AAA", loaded) == true);
+	REQUIRE(loaded.length() == 1);
+	REQUIRE(loaded[0]->close == 3);
+	REQUIRE(reader.load("BBB", loaded) == true);
+	REQUIRE(loaded.length() == 2);
+	REQUIRE(loaded[1]->close == 7);
+	REQUIRE(reader.load("CCC", loaded) == true);
+	REQUIRE(loaded.length() == 1);
+	REQUIRE(loaded[0]->close == 7);
+}
+
+TEST_CASE("Reject a store whose symbols do not end", "[bar_store]") {
+	struct bar_store_header header;
+	stockinfo aaa;
+	bar_store writer, reader;
+	struct stock s = {};
+	FILE *fp;
+
+	s.date = (char *)"2017-10-09";
+	s.close = 3;
+	aaa += s;
+
+	REQUIRE(writer.create("rsiscan-test.store") == true);
+	REQUIRE(writer.append("AAA", aaa) == true);
+	REQUIRE(writer.commit() == true);
+
+	// Fill the first symbol of the index right up.
+	REQUIRE((fp = fopen("rsiscan-test.store", "r+")) != NULL);
+	REQUIRE(fread(&header, sizeof(header), 1, fp) == 1);
+	REQUIRE(fseek(fp, header.index, SEEK_SET) == 0);
+	REQUIRE(fwrite("AAAAAAAAAAAAAAAA", BAR_STORE_SYMBOL_WIDTH, 1, fp) == 1);
+	fclose(fp);
+
+	REQUIRE(reader.open("rsiscan-test.store") == false);
+	REQUIRE(reader.length() == 0);
+	unlink("rsiscan-test.store");
+}
+
+TEST_CASE("Cut a failed replacement out of the store", "[bar_store]") {
+	stockinfo aaa, loaded;
+	bar_store writer, store;
+	struct stock s = {};
+	uint64_t size;
+
+	s.date = (char *)"2017-10-09";
+	s.close = 3;
+	aaa += s;
+
+	REQUIRE(writer.create("rsiscan-test.store") == true);
+	REQUIRE(writer.append("AAA", aaa) == true);
+	REQUIRE(writer.commit() == true);
+	REQUIRE(store.open("rsiscan-test.store") == true);
+	size = store.size();
+
+	// A symbol that is too long fails before anything is saved, and leaves the file as it was.
+	REQUIRE(store.replace("AAA", aaa) == true);
+	REQUIRE(store.replace("ABCDEFGHIJKLMNOPQRSTUVWXYZ", aaa) == false);
+	REQUIRE(store.save() == false);
+	REQUIRE(store.open("rsiscan-test.store") == true);
+	REQUIRE(store.size() == size);
+	REQUIRE(store.load("AAA", loaded) == true);
+	unlink("rsiscan-test.store");
+}
+
+TEST_CASE("Keep calendar weeks and other blocks with a ticker", "[bar_store]") {
+	stockinfo aaa, weeks, loaded;
+	bar_store writer, store, reader;
+	struct stock s = {};
+	char live[100], out[100];
+
+	s.date = (char *)"2017-10-10";
+	s.close = 4;
+	aaa += s;
+	s.date = (char *)"2017-10-09";
+	s.close = 3;
+	aaa += s;
+	weeks.roll_forward(aaa, week, INT32_MIN);
+	memset(live, 7, sizeof(live));
+
+	REQUIRE(writer.create("rsiscan-test.store") == true);
+	REQUIRE(writer.append("AAA", aaa, &weeks, live, sizeof(live)) == true);
+	REQUIRE(writer.append("BBB", aaa) == true);
+	REQUIRE(writer.commit() == true);
+
+	REQUIRE(store.open("rsiscan-test.store") == true);
+	REQUIRE(store.load("AAA", loaded, store_week_bars) == true);
+	REQUIRE(loaded.length() == 1);
+	REQUIRE(loaded[0]->close == 4);
+	REQUIRE(store.read("AAA", store_live, out, sizeof(out)) == true);
+	REQUIRE(memcmp(live, out, sizeof(out)) == 0);
+
+	// A ticker without them, or a block of another size, reads nothing.
+	REQUIRE(store.load("BBB", loaded, store_week_bars) == false);
+	REQUIRE(store.read("BBB", store_live, out, sizeof(out)) == false);
+	REQUIRE(store.read("AAA", store_live, out, sizeof(out) - 1) == false);
+
+	// Replacing a ticker replaces all of its blocks.
+	REQUIRE(store.replace("AAA", aaa, nullptr, live, sizeof(live) / 2) == true);
+	REQUIRE(store.pending() == true);
+	REQUIRE(store.save() == true);
+	REQUIRE(store.pending() == false);
+
+	REQUIRE(reader.open("rsiscan-test.store") == true);
+	unlink("rsiscan-test.store");
+	REQUIRE(reader.load("AAA", loaded) == true);
+	REQUIRE(loaded.length() == 2);
+	REQUIRE(reader.load("AAA", loaded, store_week_bars) == false);
+	REQUIRE(reader.read("AAA", store_live, out, sizeof(out) / 2) == true);
+}
+
+TEST_CASE("Tell files written after the store", "[bar_store]") {
+	stockinfo aaa;
+	bar_store writer, store;
+	struct stock s = {};
+	struct timeval times[2];
+	FILE *fp;
+
+	s.date = (char *)"2017-10-09";
+	s.close = 3;
+	aaa += s;
+
+	REQUIRE(writer.create("rsiscan-test.store") == true);
+	REQUIRE(writer.append("AAA", aaa) == true);
+	REQUIRE(writer.commit() == true);
+	REQUIRE(store.open("rsiscan-test.store") == true);
+
+	REQUIRE((fp = fopen("rsiscan-test.bars", "w")) != NULL);
+	fclose(fp);
+	REQUIRE(store.older_than("rsiscan-test.missing") == false);
+
+	// A minute before the store, then a minute after it.
+	REQUIRE(gettimeofday(&times[0], nullptr) == 0);
+	times[0].tv_sec -= 60;
+	times[1] = times[0];
+	REQUIRE(utimes("rsiscan-test.bars", times) == 0);
+	REQUIRE(store.older_than("rsiscan-test.bars") == false);
+
+	times[0].tv_sec += 120;
+	times[1] = times[0];
+	REQUIRE(utimes("rsiscan-test.bars", times) == 0);
+	REQUIRE(store.older_than("rsiscan-test.bars") == true);
+
+	unlink("rsiscan-test.bars");
+	unlink("rsiscan-test.store");
+}
@@ -0,0 +1,128 @@
+#include "lib/third_party/catch2/catch.hpp"
+#include <math.h>
+#include <stdlib.h>
+#include "lib/stats/bollinger.h"
+#include "lib/stats/simd.h"
+#include "lib/stats/simple_moving_average.h"
+#include "tests/prices.h"
+using namespace Catch;
+
+/**
+ * The bands as they were made before generate(): an SMA, then the whole window again for every row.
+ */
+static double *legacy_bands(const stockinfo_view &data, int period, int deviations, long count) {
+	simple_moving_average sma;
+	double sum, *sma_data, *ret;
+	int row, y, start;
+	long rows = data.length();
+	const double *close = data.closes();
+
+	if ((count <= 0) || (rows <= period + 1)) {
+		ret = (double *)malloc(sizeof(double));
+		ret[0] = 0;
+		return ret;
+	}
+
+	ret = (double *)malloc(sizeof(double) * (count + 1));
+	ret[count] = 0;
+
+	start = (period + count < rows) ? count : rows - period;
+	sma_data = sma.generate(data, period, count);
+
+	for (row = start - 1; row >= 0; row--) {
+		sum = 0;
+		for (y = row; y < row + period; y++)
+			sum += pow(close[y] - sma_data[row], 2);
+
+		ret[row] = sqrt(sum / period) * deviations;
+	}
+
+	free(sma_data);
+
+	return ret;
+}
+
+TEST_CASE("Bollinger bands in one pass", "[bollinger]") {
+	const double bases[] = {100, 100000};
+	simple_moving_average sma;
+	bollinger bb;
+	struct bollinger_bands bands;
+	double *expected, *middle;
+	long rows, x;
+	int y;
+
+	// Far from zero, sums of squares lose their precision. The shifted sums do not.
+	for (y = 0; y < 2; y++) {
+		stockinfo si = test_prices(600, 0, bases[y]);
+		rows = si.length();
+		bands = bb.generate(si, 20, 2, rows - 26);
+		expected = legacy_bands(si, 20, 2, rows - 26);
+		middle = sma.generate(si, 20, rows - 26);
+
+		for (x = 0; x < rows - 26; x++) {
+			REQUIRE(bands.middle[x] == middle[x]);
+			REQUIRE(bands.width[x] == Approx(expected[x]).epsilon(1e-9));
+			REQUIRE(bands.upper[x] == bands.middle[x] + bands.width[x]);
+			REQUIRE(bands.lower[x] == bands.middle[x] - bands.width[x]);
+			REQUIRE(bands.bandwidth[x] == Approx(2 * expected[x] / middle[x]).epsilon(1e-9));
+		}
+
+		bb.release(bands);
+		free(expected);
+		free(middle);
+	}
+
+	// Too few rows give one zero in each series.
+	stockinfo si = test_prices(21, 0, 100);
+	bands = bb.generate(si, 20, 2, 5);
+	REQUIRE(bands.upper[0] == 0);
+	REQUIRE(bands.bandwidth[0] == 0);
+	bb.release(bands);
+	REQUIRE(bands.upper == nullptr);
+
+	expected = bb.bands(test_prices(100, 0, 100), 20, 2, 50);
+	middle = legacy_bands(test_prices(100, 0, 100), 20, 2, 50);
+	REQUIRE(expected[0] == Approx(middle[0]));
+	REQUIRE(expected[50] == 0);
+	free(expected);
+	free(middle);
+}
+
+TEST_CASE("Bollinger band throughput", "[.][bollinger][benchmark]") {
+	const int periods[] = {20, 200};
+	stockinfo si = test_prices(20 * 252, 0, 100);
+	simple_moving_average sma;
+	bollinger bb;
+	struct bollinger_bands bands;
+	double *sma_data, *bb_data, total = 0, seconds;
+	const int runs = 20;
+	long rows = si.length();
+	int y, level, period;
+
+	// A long period shows up any kernel that goes back over the whole window for every row.
+	for (y = 0; y < 2; y++) {
+		period = periods[y];
+
+		seconds = time_per_run(runs, [&]() {
+			sma_data = sma.generate(si, period, rows - period - 6);
+			bb_data = legacy_bands(si, period, 2, rows - period - 6);
+			total += sma_data[0] + bb_data[0];
+			free(sma_data);
+			free(bb_data);
+		});
+		printf("SMA and window-by-window bands(%d) of 20 years: %.3f ms\n", period, seconds * 1000);
+
+		for (level = simd_scalar; level <= simd_supported(); level++) {
+			simd_select((simd_level)level);
+			seconds = time_per_run(runs, [&]() {
+				bands = bb.generate(si, period, 2, rows - period - 6);
+				total += bands.upper[0];
+				bb.release(bands);
+			});
+			printf("%-7s one-pass bands(%d) of 20 years: %.3f ms\n", simd().name, period, seconds * 1000);
+		}
+	}
+
+	simd_select(simd_avx512);
+	REQUIRE(total > 0);
+}
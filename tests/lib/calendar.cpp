@@ -0,0 +1,82 @@
+#include "lib/third_party/catch2/catch.hpp"
+#include <stdlib.h>
+#include <time.h>
+#include "lib/calendar.h"
+using namespace Catch;
+
+TEST_CASE("Convert between dates and day numbers", "[calendar]") {
+	unsigned month, day;
+	int32_t days;
+	struct tm tm;
+	time_t t;
+	int year;
+
+	REQUIRE(days_from_civil(1970, 1, 1) == 0);
+	REQUIRE(days_from_civil(2000, 3, 1) == 11017);
+	REQUIRE(days_from_civil(1969, 12, 31) == -1);
+
+	// Out of range days roll over, like mktime().
+	REQUIRE(days_from_civil(2017, 2, 30) == days_from_civil(2017, 3, 2));
+
+	// Every day from 1900 to 2100 agrees with the C library.
+	for (days = days_from_civil(1900, 1, 1); days < days_from_civil(2100, 1, 1); days++) {
+		t = (time_t)days * SECONDS_PER_DAY;
+		gmtime_r(&t, &tm);
+		civil_from_days(days, &year, &month, &day);
+
+		REQUIRE(year == tm.tm_year + 1900);
+		REQUIRE(month == (unsigned)tm.tm_mon + 1);
+		REQUIRE(day == (unsigned)tm.tm_mday);
+		REQUIRE(days_from_civil(year, month, day) == days);
+		REQUIRE(days_from_time(t + 43200) == days);
+	}
+}
+
+TEST_CASE("Parse CSV dates", "[calendar]") {
+	int32_t days;
+
+	REQUIRE(parse_civil_date("2017-10-09", &days) == true);
+	REQUIRE(days == days_from_civil(2017, 10, 9));
+
+	REQUIRE(parse_civil_date("9-Oct-17", &days) == true);
+	REQUIRE(days == days_from_civil(2017, 10, 9));
+
+	REQUIRE(parse_civil_date("31-december-99", &days) == true);
+	REQUIRE(days == days_from_civil(1999, 12, 31));
+
+	REQUIRE(parse_civil_date("01-JAN-68", &days) == true);
+	REQUIRE(days == days_from_civil(2068, 1, 1));
+
+	REQUIRE(parse_civil_date("1date", &days) == false);
+	REQUIRE(parse_civil_date("2017-13-01", &days) == false);
+	REQUIRE(parse_civil_date("", &days) == false);
+}
+
+TEST_CASE("Read calendar fields from day numbers", "[calendar]") {
+	char text[16];
+	int32_t days;
+	struct tm tm;
+	time_t t;
+	int year;
+
+	REQUIRE(weekday_from_days(days_from_civil(2017, 10, 9)) == 1);
+	REQUIRE(weekday_from_days(days_from_civil(1969, 12, 28)) == 0);
+
+	// ISO weeks belong to the year of their Thursday.
+	REQUIRE(iso_week_from_days(days_from_civil(2021, 1, 3), &year) == 53);
+	REQUIRE(year == 2020);
+	REQUIRE(iso_week_from_days(days_from_civil(2019, 12, 30), &year) == 1);
+	REQUIRE(year == 2020);
+
+	for (days = days_from_civil(1950, 1, 1); days < days_from_civil(2050, 1, 1); days += 13) {
+		t = (time_t)days * SECONDS_PER_DAY;
+		gmtime_r(&t, &tm);
+		REQUIRE(weekday_from_days(days) == tm.tm_wday);
+
+		strftime(text, sizeof(text), "%V", &tm);
+		REQUIRE(iso_week_from_days(days) == atoi(text));
+	}
+
+	format_civil_date(days_from_civil(2017, 1, 9), text);
+	REQUIRE_THAT(text, Equals("2017-01-09"));
+}
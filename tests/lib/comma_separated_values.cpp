@@ -1,14 +1,132 @@
 #include "lib/third_party/catch2/catch.hpp"
+#include <stdlib.h>
+#include <string.h>
 #include "lib/comma_separated_values.h"
+#include "tests/prices.h"
 using namespace Catch;
 
 TEST_CASE("Parse 5 columns into a stock struct", "[csv]") {
 	comma_separated_values csv;
 	long rows;
-	struct stock *values = csv.parse("1date,4,10,1,3,100000\r\n2date,7,10,1,8,50", &rows);
+	struct stock *values = csv.parse("2017-10-10,4,10,1,3,100000\r\n9-Oct-17,7,10,1,8,50", &rows);
 
 	REQUIRE(rows == 2);
-	REQUIRE_THAT(values[0].date, Equals("1date"));
-	REQUIRE_THAT(values[1].date, Equals("2date"));
+	REQUIRE_THAT(values[0].date, Equals("2017-10-10"));
+	REQUIRE_THAT(values[1].date, Equals("2017-10-09"));
 	REQUIRE(values[1].volume == 50);
+
+	free(values[0].date);
+	free(values[1].date);
+	free(values);
+}
+
+TEST_CASE("Parse CSV data straight into stockinfo", "[csv]") {
+	comma_separated_values csv;
+	stockinfo si;
+	const char *block = "Date,Open,High,Low,Close,Volume\n2017-10-10,3.1,6.25,-2,5e1,100\n\n2017-10-09,0.07,123.456,1,,50,extra\r\n";
+	const char *values[] = {"0.1", "1.7976931348623157e308", "123456.789012", "0.000001", "99999999999999999.5", "-0"};
+	char line[128];
+	double expected;
+	long x;
+
+	REQUIRE(csv.parse(block, block + strlen(block), si) == 2);
+	REQUIRE(si.length() == 2);
+	REQUIRE_THAT(si[0]->date, Equals("2017-10-10"));
+	REQUIRE(si[0]->open == 3.1);
+	REQUIRE(si[0]->high == 6.25);
+	REQUIRE(si[0]->low == -2);
+	REQUIRE(si[0]->close == 50);
+	REQUIRE(si[0]->volume == 100);
+	REQUIRE(si[1]->open == 0.07);
+	REQUIRE(si[1]->close == 0);
+	REQUIRE(si[1]->volume == 50);
+	REQUIRE(si[1]->timestamp > 0);
+
+	// Conversions match strtod() exactly.
+	for (x = 0; x < 6; x++) {
+		stockinfo sj;
+
+		sprintf(line, "2017-10-10,%s,0,0,0,0", values[x]);
+		REQUIRE(csv.parse(line, line + strlen(line), sj) == 1);
+		expected = strtod(values[x], NULL);
+		REQUIRE(memcmp(sj.opens(), &expected, sizeof(double)) == 0);
+	}
+
+	// Too few columns.
+	strcpy(line, "a,b,c\n1,2,3,4,5,6");
+	REQUIRE(csv.parse(line, line + strlen(line), si) == -1);
+}
+
+/**
+ * The strsep() based parser that parse(begin, end, data) replaced, kept as a yardstick.
+ */
+static struct stock *legacy_parse(const char *block, long *rows) {
+	char *data, *line, *ptr, *field;
+	struct stock *ret;
+	long x;
+
+	ptr = data = strdup(block);
+	*rows = 0;
+	while ((line = strsep(&ptr, "\r\n")))
+		if ((isdigit(*line)) && (strchr(line, ',')))
+			(*rows)++;
+	free(data);
+
+	ptr = data = strdup(block);
+	ret = (struct stock *)malloc((*rows) * sizeof(struct stock));
+	x = 0;
+	while ((line = strsep(&ptr, "\r\n"))) {
+		if ((!isdigit(*line)) || (!strchr(line, ',')))
+			continue;
+
+		// Each row owns a copy of its line, which starts with the date.
+		field = strdup(line);
+		ret[x].date = strsep(&field, ",");
+		ret[x].open = atof(strsep(&field, ","));
+		ret[x].high = atof(strsep(&field, ","));
+		ret[x].low = atof(strsep(&field, ","));
+		ret[x].close = atof(strsep(&field, ","));
+		ret[x].volume = strtol(strsep(&field, ","), NULL, 10);
+		x++;
+	}
+	free(data);
+
+	return ret;
+}
+
+TEST_CASE("CSV parser throughput", "[.][csv][benchmark]") {
+	const long count = 200000;
+	comma_separated_values csv;
+	struct stock *legacy;
+	stockinfo fast, slow;
+	char *block, *p;
+	long x, rows, parsed = 0;
+	double mb, seconds;
+
+	// About 60 bytes per row, like a download from the quote server.
+	p = block = (char *)malloc(count * 64 + 64);
+	p += sprintf(p, "Date,Open,High,Low,Close,Volume\r\n");
+	for (x = 0; x < count; x++)
+		p += sprintf(p, "%04li-%02li-%02li,%.2f,%.2f,%.2f,%.2f,%li\r\n", 1900 + x / 336, 1 + x / 28 % 12, 1 + x % 28,
+		             100 + x % 97 * 0.37, 101 + x % 89 * 0.41, 99 + x % 83 * 0.29, 100 + x % 79 * 0.33, 1000000 + x * 7);
+	mb = (p - block) / 1048576.0;
+
+	seconds = time_per_run(1, [&]() {
+		legacy = legacy_parse(block, &rows);
+		slow.insert_at(legacy, rows);
+	});
+	printf("strsep parser: %.1f MB/s\n", mb / seconds);
+
+	seconds = time_per_run(1, [&]() { parsed = csv.parse(block, p, fast); });
+	printf("single-pass parser: %.1f MB/s\n", mb / seconds);
+
+	REQUIRE(parsed == count);
+	REQUIRE(rows == count);
+	REQUIRE(memcmp(fast.closes(), slow.closes(), count * sizeof(double)) == 0);
+	REQUIRE(memcmp(fast.days(), slow.days(), count * sizeof(int32_t)) == 0);
+
+	for (x = 0; x < rows; x++)
+		free(legacy[x].date);
+	free(legacy);
+	free(block);
 }
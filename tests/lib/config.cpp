@@ -0,0 +1,50 @@
+#include "lib/third_party/catch2/catch.hpp"
+#include <stdlib.h>
+#include <string>
+#include <unistd.h>
+#include "lib/config.h"
+using namespace Catch;
+
+TEST_CASE("Delist a ticker from the store", "[config]") {
+	char home[] = "/tmp/rsiscan-test-XXXXXX";
+	std::string previous = getenv("HOME") ? getenv("HOME") : "";
+	stockinfo aaa, loaded;
+	bar_store writer, store, reader;
+	struct stock s = {};
+
+	REQUIRE(mkdtemp(home) != nullptr);
+	setenv("HOME", home, 1);
+
+	s.date = (char *)"2017-10-09";
+	s.close = 3;
+	aaa += s;
+
+	{
+		config conf;
+
+		REQUIRE(conf.save_config == true);
+		REQUIRE(writer.create(conf.store_file) == true);
+		REQUIRE(writer.append("AAA", aaa) == true);
+		REQUIRE(writer.append("BBB", aaa) == true);
+		REQUIRE(writer.commit() == true);
+
+		REQUIRE(store.open(conf.store_file) == true);
+		conf.delist("aaa", &store);
+
+		// A new run no longer finds the ticker.
+		REQUIRE(reader.open(conf.store_file) == true);
+		REQUIRE(reader.length() == 1);
+		REQUIRE_THAT(reader.symbol(0), Equals("BBB"));
+		REQUIRE(reader.load("AAA", loaded) == false);
+		REQUIRE(reader.load("BBB", loaded) == true);
+
+		unlink(conf.store_file);
+		rmdir(conf.old_dir);
+		rmdir(conf.list_dir);
+		rmdir(conf.stock_dir);
+		rmdir(conf.config_dir);
+	}
+
+	rmdir(home);
+	setenv("HOME", previous.c_str(), 1);
+}
@@ -0,0 +1,62 @@
+#include "lib/third_party/catch2/catch.hpp"
+#include <stdlib.h>
+#include <string.h>
+#include "lib/csv_scanner.h"
+#include "tests/prices.h"
+using namespace Catch;
+
+TEST_CASE("Find delimiters with every instruction set", "[csv]") {
+	const char *alphabet = "0123456789.-,\r\nabc";
+	const char *p, *expected, *last;
+	char block[1000];
+	long x, isa;
+
+	srand(17);
+	for (x = 0; x < (long)sizeof(block); x++)
+		block[x] = alphabet[rand() % strlen(alphabet)];
+
+	for (isa = scan_scalar; isa <= csv_scanner::best_isa(); isa++) {
+		// Scan many lengths, so that the partial block at the end is covered.
+		for (x = 0; x < (long)sizeof(block); x += 37) {
+			csv_scanner scanner(block, block + x, (scanner_isa)isa);
+
+			last = block + x;
+			for (p = block; p <= last; p = expected + 1) {
+				for (expected = p; (expected < last) && (*expected != ',') && (*expected != '\r') && (*expected != '\n'); expected++);
+				REQUIRE(scanner.next(p) == expected);
+			}
+		}
+	}
+
+	// Jump ahead, then back.
+	csv_scanner scanner(block, block + sizeof(block));
+	p = scanner.next(block + 500);
+	REQUIRE(p == scanner.next(p));
+	REQUIRE(scanner.next(block) == block + strcspn(block, ",\r\n"));
+}
+
+TEST_CASE("CSV tokenizer throughput", "[.][csv][benchmark]") {
+	const long size = 256 * 1048576;
+	const char *names[] = {"scalar", "sse2", "avx2", "avx512"};
+	const char *p;
+	char *block;
+	long x, isa, found;
+	double seconds;
+
+	block = (char *)malloc(size);
+	for (x = 0; x < size; x++)
+		block[x] = "2017-10-09,123.45,125.50,122.25,124.75,1234567\r\n"[x % 49];
+
+	for (isa = scan_scalar; isa <= csv_scanner::best_isa(); isa++) {
+		seconds = time_per_run(1, [&]() {
+			csv_scanner scanner(block, block + size, (scanner_isa)isa);
+
+			found = 0;
+			for (p = block; (p = scanner.next(p)) < block + size; p++)
+				found++;
+		});
+		printf("%s tokenizer: %.1f MB/s (%li delimiters)\n", names[isa], size / 1048576.0 / seconds, found);
+	}
+
+	free(block);
+}
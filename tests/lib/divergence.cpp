@@ -0,0 +1,69 @@
+#include "lib/third_party/catch2/catch.hpp"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string>
+#include "lib/stats/divergence.h"
+#include "lib/stats/simd.h"
+#include "tests/prices.h"
+using namespace Catch;
+
+/**
+ * Run diverge() on the bars of indicators, and return what it printed.
+ */
+static std::string diverge_text(indicator_cache &indicators, bool &found) {
+	std::string ret;
+	size_t size = 0;
+	char *text = nullptr;
+	FILE *out = open_memstream(&text, &size);
+
+	found = diverge("TEST", indicators, "potential daily", out, true);
+	fclose(out);
+	ret.assign(text, size);
+	free(text);
+
+	return ret;
+}
+
+TEST_CASE("Find highs and lows of a trend", "[divergence]") {
+	const double highs[] = {5, 4, 3, 6, 1}, lows[] = {1, 2, 3, 0.5, 4};
+	long pos = 0;
+
+	REQUIRE(divergence(highs, 5, 0, 3) == HIGHERHIGH);
+	REQUIRE(divergence(highs, 5, 0, 4, &pos) == LOWERHIGH);
+	REQUIRE(pos == 3);
+	REQUIRE(divergence(lows, 5, 3, 0) == LOWERLOW);
+	pos = 0;
+	REQUIRE(divergence(lows, 5, 4, 0, &pos) == HIGHERLOW);
+	REQUIRE(pos == 3);
+
+	// Resets past the values, or too few values, are ignored.
+	REQUIRE(divergence(highs, 5, 0, 5) == IGNORED);
+	REQUIRE(divergence(highs, 2, 0, 1) == IGNORED);
+}
+
+TEST_CASE("Walk back through a history looking for divergences", "[divergence]") {
+	stockinfo si = test_prices(20 * 252);
+	stockinfo_view data(si);
+	indicator_cache walk, fresh;
+	bool walked, found;
+	long drop, count = 0;
+
+	// Every day of the walk reads the history's series, and has to print what bars of its own would.
+	simd_select(simd_scalar);
+	walk.walk(data);
+	for (drop = 0; data.length() > 100; drop++, data.shift(), walk.reset(data)) {
+		INFO("Dropped: " << drop);
+		fresh.reset(data);
+		REQUIRE(diverge_text(walk, walked) == diverge_text(fresh, found));
+		REQUIRE(walked == found);
+		count += found;
+	}
+	simd_select(simd_avx512);
+
+	REQUIRE(count > 0);
+
+	// Too few bars for any of the series.
+	fresh.reset(stockinfo_view(si, 0, 28));
+	REQUIRE(diverge_text(fresh, found) == "");
+	REQUIRE(found == false);
+}
@@ -0,0 +1,167 @@
+#include "lib/third_party/catch2/catch.hpp"
+#include <string.h>
+#include <stdlib.h>
+#include <algorithm>
+#include "lib/stats/indicator_cache.h"
+#include "lib/stats/relative_strength_index.h"
+#include "lib/stats/simple_moving_average.h"
+#include "lib/stats/moving_average_convergence_divergence.h"
+#include "lib/stats/simd.h"
+#include "lib/rsiscript.h"
+#include "tests/prices.h"
+using namespace Catch;
+
+TEST_CASE("Work out each indicator series once", "[indicator_cache]") {
+	stockinfo si = test_prices(300);
+	stockinfo_view data(si);
+	indicator_cache cache;
+	relative_strength_index rsi;
+	moving_average_convergence_divergence macd;
+	bollinger bb;
+	struct bollinger_bands bands, expected_bands;
+	const double *first;
+	double *expected;
+
+	cache.reset(data);
+	first = cache.rsi(14, 274);
+	REQUIRE(cache.computed() == 1);
+	REQUIRE(cache.rsi(14, 274) == first);
+	REQUIRE(cache.computed() == 1);
+	cache.rsi(14, 12);
+	cache.rsi(9, 274);
+	REQUIRE(cache.computed() == 3);
+
+	expected = rsi.generate(data, 14, 274);
+	REQUIRE(memcmp(first, expected, sizeof(double) * series_size(274)) == 0);
+	free(expected);
+
+	// The histogram brings its MACD line in with it.
+	expected = macd.histogram(data, 12, 26, 9, 274);
+	REQUIRE(memcmp(cache.histogram(12, 26, 9, 274), expected, sizeof(double) * series_size(274)) == 0);
+	free(expected);
+	REQUIRE(cache.computed() == 5);
+	expected = macd.generate(data, 12, 26, 283);
+	REQUIRE(memcmp(cache.macd(12, 26, 283), expected, sizeof(double) * series_size(283)) == 0);
+	free(expected);
+	REQUIRE(cache.computed() == 5);
+
+	bands = cache.bands(20, 2, 274);
+	expected_bands = bb.generate(data, 20, 2, 274);
+	REQUIRE(bands.valid == expected_bands.valid);
+	REQUIRE(memcmp(bands.upper, expected_bands.upper, sizeof(double) * BOLLINGER_SERIES * series_size(274)) == 0);
+	bb.release(expected_bands);
+	REQUIRE(cache.bands(20, 2, 274).middle == bands.middle);
+	REQUIRE(cache.computed() == 6);
+
+	// Resetting forgets the series, and hands their buffers to the next ones.
+	data.shift();
+	cache.reset(data);
+	REQUIRE(cache.computed() == 0);
+	first = cache.rsi(14, 273);
+	REQUIRE(cache.computed() == 1);
+	expected = rsi.generate(data, 14, 273);
+	REQUIRE(memcmp(first, expected, sizeof(double) * series_size(273)) == 0);
+	free(expected);
+}
+
+TEST_CASE("Walk back through the history's own series", "[indicator_cache]") {
+	stockinfo si = test_prices(400), other = test_prices(400, 1);
+	stockinfo_view data(si);
+	indicator_cache cache, fresh;
+	struct bollinger_bands bands, expected_bands;
+	long drop, counts[2], count, size, computed;
+	int x;
+
+	// The scalar kernels give the same values wherever a series starts. The vector ones agree to within a few ULP.
+	simd_select(simd_scalar);
+	cache.walk(data);
+	REQUIRE(cache.bars().days() == si.days());
+	REQUIRE(cache.bars().length() == si.length());
+	for (drop = 0; drop < 300; drop++, data.shift(), cache.reset(data)) {
+		INFO("Dropped: " << drop);
+		fresh.reset(data);
+
+		// Counts past the rows, as the screens ask for, are cut to the rows. Once they reach the oldest rows, none
+		// are worked out afresh.
+		counts[0] = 374;
+		counts[1] = data.length() - 26;
+		for (x = 0; x < 2; x++) {
+			count = counts[x];
+			size = sizeof(double) * series_size(std::min(count, data.length()));
+			INFO("Count: " << count);
+			REQUIRE(memcmp(cache.sma(20, count), fresh.sma(20, count), size) == 0);
+			REQUIRE(memcmp(cache.ema(12, count), fresh.ema(12, count), size) == 0);
+			REQUIRE(memcmp(cache.rsi(14, count), fresh.rsi(14, count), size) == 0);
+			REQUIRE(memcmp(cache.macd(12, 26, count), fresh.macd(12, 26, count), size) == 0);
+			REQUIRE(memcmp(cache.histogram(12, 26, 9, count), fresh.histogram(12, 26, 9, count), size) == 0);
+
+			bands = cache.bands(20, 2, count);
+			expected_bands = fresh.bands(20, 2, count);
+			REQUIRE(bands.valid == expected_bands.valid);
+			REQUIRE(memcmp(bands.upper, expected_bands.upper, size) == 0);
+			REQUIRE(memcmp(bands.middle, expected_bands.middle, size) == 0);
+			REQUIRE(memcmp(bands.lower, expected_bands.lower, size) == 0);
+			REQUIRE(memcmp(bands.width, expected_bands.width, size) == 0);
+			REQUIRE(memcmp(bands.bandwidth, expected_bands.bandwidth, size) == 0);
+			if ((x == 0) && (drop >= 26))
+				REQUIRE(cache.computed() == 0);
+		}
+
+		// Series that stop short of the oldest rows differ from the history's, so they are worked out afresh.
+		computed = cache.computed();
+		REQUIRE(memcmp(cache.rsi(14, 5), fresh.rsi(14, 5), sizeof(double) * series_size(5)) == 0);
+		REQUIRE(cache.computed() == computed + 1);
+	}
+
+	// Other bars are not part of the history.
+	cache.reset(stockinfo_view(other));
+	cache.rsi(14, 374);
+	REQUIRE(cache.computed() == 1);
+	REQUIRE(cache.rsi(14, 1000) == cache.rsi(14, 400));
+	REQUIRE(cache.computed() == 2);
+	simd_select(simd_avx512);
+}
+
+TEST_CASE("Cache roll-up series apart from daily ones", "[indicator_cache]") {
+	stockinfo si = test_prices(400);
+	stockinfo weekly = si.calendar(week);
+	indicator_cache cache;
+	relative_strength_index rsi;
+	double *expected;
+
+	cache.reset(stockinfo_view(si));
+	indicator_cache &by_week = cache.timeframe(1, week, align_calendar);
+	REQUIRE(by_week.bars().length() == weekly.length());
+	REQUIRE(&cache.timeframe(1, week, align_calendar) == &by_week);
+	REQUIRE(&cache.timeframe(1, week) != &by_week);
+
+	expected = rsi.generate(weekly, 14, 12);
+	REQUIRE(memcmp(by_week.rsi(14, 12), expected, sizeof(double) * series_size(12)) == 0);
+	free(expected);
+	REQUIRE(by_week.computed() == 1);
+	REQUIRE(cache.computed() == 0);
+
+	// A reset rebuilds the roll-ups from the new bars.
+	cache.reset(stockinfo_view(si, 0, 100));
+	REQUIRE(cache.timeframe(1, week, align_calendar).bars().length() < weekly.length());
+	REQUIRE(by_week.computed() == 0);
+}
+
+TEST_CASE("Share a caller's indicator cache with rsiscript", "[indicator_cache]") {
+	stockinfo si = test_prices(300);
+	stockinfo_view data(si);
+	indicator_cache cache;
+	rsiscript rs;
+	simple_moving_average sma;
+	double *expected;
+
+	cache.reset(data);
+	rs.parse("{sma}>{bb_top}", data, nullptr, &cache);
+	REQUIRE(cache.computed() == 2);
+	rs.parse("{sma}<{close}", data, nullptr, &cache);
+	REQUIRE(cache.computed() == 2);
+
+	expected = sma.generate(data, 20, 274);
+	REQUIRE(*cache.sma(20, 274) == *expected);
+	free(expected);
+}
@@ -0,0 +1,146 @@
+#include "lib/third_party/catch2/catch.hpp"
+#include <string.h>
+#include <unistd.h>
+#include <stdlib.h>
+#include "lib/stats/live_indicators.h"
+#include "lib/stats/exponential_moving_average.h"
+#include "lib/stats/moving_average_convergence_divergence.h"
+#include "lib/stats/simd.h"
+#include "tests/prices.h"
+using namespace Catch;
+
+/**
+ * Run the rest of a test with the scalar kernels, which the streaming indicators match bit for bit.
+ */
+struct scalar_kernels {
+	scalar_kernels() { simd_select(simd_scalar); }
+	~scalar_kernels() { simd_select(simd_avx512); }
+};
+
+TEST_CASE("Streaming indicators match generate()", "[live_indicators]") {
+	scalar_kernels scalar;
+	stockinfo si = test_prices(300);
+	stockinfo_view data(si);
+	relative_strength_index rsi;
+	exponential_moving_average ema(20);
+	simple_moving_average sma(20);
+	moving_average_convergence_divergence macd(12, 26, 9);
+	double *expected, signal = 0, alpha = 2.0 / 10;
+	long x, rows = data.length();
+
+	REQUIRE(rsi.advance(data) == rows);
+	REQUIRE(ema.advance(data) == rows);
+	REQUIRE(sma.advance(data) == rows);
+	REQUIRE(macd.advance(data) == rows);
+
+	// Each generate() call below starts from the oldest row.
+	expected = rsi.generate(data, 14, rows - 26);
+	REQUIRE(rsi.value() == *expected);
+	free(expected);
+
+	expected = ema.generate(data, 20, rows - 21);
+	REQUIRE(ema.value() == *expected);
+	free(expected);
+
+	// The vector kernels only round differently.
+	simd_select(simd_avx512);
+	expected = ema.generate(data, 20, rows - 21);
+	REQUIRE(ema.value() == Approx(*expected).epsilon(1e-13));
+	free(expected);
+	simd_select(simd_scalar);
+
+	expected = sma.generate(data, 20, 1);
+	REQUIRE(sma.value() == Approx(*expected));
+	free(expected);
+
+	expected = macd.generate(data, 12, 26, rows - 13);
+	REQUIRE(macd.value() == *expected);
+	free(expected);
+
+	// The signal line is an EMA of every MACD value, starting at zero.
+	moving_average_convergence_divergence line(12, 26, 9);
+	for (x = rows - 1; x >= 0; x--) {
+		line.update(data.closes()[x]);
+		if (x < rows - 1)
+			signal = alpha * (line.snapshot().fast_ema - line.snapshot().slow_ema) + (1 - alpha) * signal;
+	}
+	REQUIRE(macd.signal() == Approx(signal));
+	REQUIRE(macd.histogram() == Approx(macd.value() - signal));
+
+	// Too few bars give zero, like generate().
+	relative_strength_index short_rsi;
+	REQUIRE(short_rsi.advance(stockinfo_view(si, 0, 15)) == 15);
+	REQUIRE(short_rsi.value() == 0);
+	REQUIRE(short_rsi.update(data.closes()[0]) != 0);
+}
+
+TEST_CASE("Advance streaming indicators by new bars only", "[live_indicators]") {
+	stockinfo si = test_prices(300), sj;
+	relative_strength_index full, old, resumed;
+	struct stock s = {};
+
+	full.advance(si);
+	old.advance(stockinfo_view(si, 5));
+	REQUIRE(resumed.restore(old.snapshot()) == true);
+	REQUIRE(resumed.advance(si) == 5);
+	REQUIRE(resumed.value() == full.value());
+	REQUIRE(resumed.advance(si) == 0);
+	REQUIRE(resumed.value() == full.value());
+
+	// Periods have to match.
+	relative_strength_index other(9);
+	REQUIRE(other.restore(old.snapshot()) == false);
+
+	// If the last bar changed, everything is fed in again.
+	sj = stockinfo(stockinfo_view(si, 5));
+	s.timestamp = (time_t)sj.days()[0] * SECONDS_PER_DAY;
+	s.close = 1;
+	sj.merge(stockinfo().insert_at(s));
+	REQUIRE(resumed.restore(old.snapshot()) == true);
+	REQUIRE(resumed.advance(sj) == sj.length());
+
+	// So is a change to an older bar, which since gives the day of, or rows older than the first bar.
+	sj = stockinfo(stockinfo_view(si, 5));
+	REQUIRE(resumed.restore(old.snapshot()) == true);
+	REQUIRE(resumed.advance(sj) == 0);
+	s.timestamp = (time_t)sj.days()[100] * SECONDS_PER_DAY;
+	s.close = sj.closes()[100] + 0.01;
+	sj.merge(stockinfo().insert_at(s));
+	REQUIRE(resumed.restore(old.snapshot()) == true);
+	REQUIRE(resumed.advance(sj, sj.days()[100]) == sj.length());
+	REQUIRE(resumed.restore(old.snapshot()) == true);
+	REQUIRE(resumed.advance(sj, sj.days()[0]) == sj.length());
+
+	// Changes after the last bar it saw are only new rows.
+	REQUIRE(resumed.restore(old.snapshot()) == true);
+	REQUIRE(resumed.advance(si, si.days()[4]) == 5);
+	REQUIRE(resumed.value() == full.value());
+
+	old.reset();
+	old.advance(stockinfo_view(si, 5, 200));
+	REQUIRE(resumed.restore(old.snapshot()) == true);
+	REQUIRE(resumed.advance(si) == si.length());
+}
+
+TEST_CASE("Save and load live indicators", "[live_indicators]") {
+	stockinfo si = test_prices(300);
+	live_indicators before, after, fresh;
+
+	unlink("rsiscan-test.live");
+	REQUIRE(after.load("rsiscan-test.live") == false);
+
+	before.advance(stockinfo_view(si, 3));
+	REQUIRE(before.current(si) == false);
+	REQUIRE(before.current(stockinfo_view(si, 3)) == true);
+	REQUIRE(before.save("rsiscan-test.live") == true);
+
+	REQUIRE(after.load("rsiscan-test.live") == true);
+	REQUIRE(after.advance(si) == 3);
+	REQUIRE(after.current(si) == true);
+
+	fresh.advance(si);
+	REQUIRE(after.rsi.value() == fresh.rsi.value());
+	REQUIRE(after.sma.value() == fresh.sma.value());
+
+	unlink("rsiscan-test.live");
+}
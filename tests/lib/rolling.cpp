@@ -0,0 +1,125 @@
+#include "lib/third_party/catch2/catch.hpp"
+#include <stdlib.h>
+#include <algorithm>
+#include "lib/stats/high.h"
+#include "lib/stats/low.h"
+#include "lib/calendar.h"
+#include "tests/prices.h"
+using namespace Catch;
+
+TEST_CASE("Roll the highs and lows of every window", "[rolling]") {
+	const int windows[] = {1, 2, 5, 20, 251};
+	const price_field fields[] = {price_high, price_low, price_close, price_open};
+	stockinfo si = test_prices(700);
+	stockinfo_view data(si), shifted;
+	high h;
+	low l;
+	double *highest, *lowest;
+	long *high_at, *low_at, row, y, valid;
+	const double *values;
+	int x, f, days;
+
+	for (x = 0; x < 5; x++) {
+		days = windows[x];
+		INFO("Days: " << days);
+
+		highest = h.generate(data, price_high, days, 700);
+		lowest = l.generate(data, price_low, days, 700);
+		for (row = 0, shifted = data; row <= 700; row++, shifted.shift()) {
+			REQUIRE(highest[row] == h.find(shifted, days));
+			REQUIRE(lowest[row] == l.find(shifted, days));
+		}
+		free(highest);
+		free(lowest);
+
+		for (f = 0; f < 4; f++) {
+			values = data.prices(fields[f]);
+			highest = (double *)malloc(sizeof(double) * series_size(650));
+			lowest = (double *)malloc(sizeof(double) * series_size(650));
+			high_at = (long *)malloc(sizeof(long) * series_size(650));
+			low_at = (long *)malloc(sizeof(long) * series_size(650));
+
+			valid = h.fill(data, fields[f], days, 650, highest, high_at);
+			REQUIRE(valid == std::min(650L, 700L - days - 1));
+			REQUIRE(l.fill(data, fields[f], days, 650, lowest, low_at) == valid);
+
+			for (row = 0; row < valid; row++) {
+				REQUIRE((high_at[row] >= 0 && high_at[row] < days));
+				REQUIRE((low_at[row] >= 0 && low_at[row] < days));
+				REQUIRE(values[row + high_at[row]] == highest[row]);
+				REQUIRE(values[row + low_at[row]] == lowest[row]);
+
+				// The newest of equal extremes.
+				for (y = row; y < row + days; y++) {
+					REQUIRE(values[y] <= highest[row]);
+					REQUIRE(values[y] >= lowest[row]);
+					if (y < row + high_at[row])
+						REQUIRE(values[y] < highest[row]);
+					if (y < row + low_at[row])
+						REQUIRE(values[y] > lowest[row]);
+				}
+			}
+			for (; row <= 650; row++) {
+				REQUIRE(highest[row] == 0);
+				REQUIRE(lowest[row] == 0);
+				REQUIRE(high_at[row] == -1);
+				REQUIRE(low_at[row] == -1);
+			}
+
+			free(highest);
+			free(lowest);
+			free(high_at);
+			free(low_at);
+		}
+	}
+}
+
+TEST_CASE("Short histories have no rolling extremes", "[rolling]") {
+	stockinfo si = test_prices(253);
+	stockinfo_view data(si);
+	double out[11];
+	long at[11], row;
+	high h;
+	low l;
+
+	REQUIRE(h.fill(data, price_high, 251, 10, out, at) == 1);
+	REQUIRE(out[0] == h.find(data, 251));
+	REQUIRE(at[1] == -1);
+
+	data.shift();
+	REQUIRE(l.fill(data, price_low, 251, 10, out, at) == 0);
+	for (row = 0; row < 11; row++) {
+		REQUIRE(out[row] == 0);
+		REQUIRE(at[row] == -1);
+	}
+
+	REQUIRE(h.fill(data, price_high, 0, 10, out, at) == 0);
+	REQUIRE(h.fill(data, price_high, 20, 0, out, at) == 0);
+}
+
+TEST_CASE("Rolling 52-week range throughput", "[.][rolling][benchmark]") {
+	const long rows = 20 * 252;
+	stockinfo si = test_prices(rows);
+	stockinfo_view data(si), shifted;
+	double *out = (double *)malloc(sizeof(double) * series_size(rows)), total = 0, seconds;
+	long row;
+	high h;
+	low l;
+
+	seconds = time_per_run(1, [&]() {
+		for (row = 0, shifted = data; row < rows; row++, shifted.shift())
+			total += h.find(shifted, 251) - l.find(shifted, 251);
+	});
+	printf("52-week high and low of every day of 20 years, a day at a time: %.2f ms\n", seconds * 1e3);
+
+	seconds = time_per_run(1, [&]() {
+		h.fill(data, price_high, 251, rows, out);
+		total += out[0];
+		l.fill(data, price_low, 251, rows, out);
+		total -= out[0];
+	});
+	printf("52-week high and low of every day of 20 years, as series: %.2f ms\n", seconds * 1e3);
+
+	free(out);
+	REQUIRE(total != 0);
+}
@@ -1,4 +1,7 @@
 #include "lib/third_party/catch2/catch.hpp"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
 #include "lib/rsiscript.h"
 #include "lib/stock.h"
 using namespace Catch;
@@ -39,6 +42,24 @@ TEST_CASE("Test variable replacement", "[script]") {
 	// Basic test.
 	REQUIRE_THAT(rs.parse("{volume} > 1000000", si).c_str(), Equals("0"));
 	REQUIRE_THAT(rs.parse("{volume} > 100000", si).c_str(), Equals("1"));
+
+	// Rows keep their own copy of the date.
+	free(s.date);
+}
+
+TEST_CASE("Print script errors to the caller's stream", "[script]") {
+	stockinfo si;
+	rsiscript rs;
+	char *text = nullptr;
+	size_t size = 0;
+
+	rs.out = open_memstream(&text, &size);
+	REQUIRE_THAT(rs.parse("1+2)", si).c_str(), Equals("0"));
+	REQUIRE_THAT(rs.parse("{volume} > 1}", si).c_str(), Equals("0"));
+	fclose(rs.out);
+
+	REQUIRE(std::string(text, size) == "ERROR: Mismatched parenthesis: 1+2)\nERROR: Mismatched brackets: {volume} > 1}\n");
+	free(text);
 }
 
 TEST_CASE("Test period parsing", "[script]") {
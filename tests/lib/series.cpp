@@ -0,0 +1,101 @@
+#include "lib/third_party/catch2/catch.hpp"
+#include <string.h>
+#include <stdlib.h>
+#include "lib/stats/series.h"
+#include "lib/stats/relative_strength_index.h"
+#include "lib/stats/exponential_moving_average.h"
+#include "lib/stats/simple_moving_average.h"
+#include "lib/stats/moving_average_convergence_divergence.h"
+#include "lib/stats/bollinger.h"
+#include "tests/prices.h"
+using namespace Catch;
+
+static bool same_values(const double *a, const double *b, const long count) {
+	return memcmp(a, b, sizeof(double) * series_size(count)) == 0;
+}
+
+TEST_CASE("Reuse series buffers", "[series]") {
+	series_buffer buffer;
+	double *first;
+
+	REQUIRE(buffer.data() == nullptr);
+	first = buffer.reserve(100);
+	REQUIRE(first != nullptr);
+	REQUIRE(buffer.reserve(50) == first);
+	REQUIRE(buffer.reserve(100) == first);
+	REQUIRE(buffer.reserve(101) != nullptr);
+
+	REQUIRE(series_size(10) == 11);
+	REQUIRE(series_size(0) == 1);
+	REQUIRE(series_size(-5) == 1);
+}
+
+TEST_CASE("Fill caller buffers like generate()", "[series]") {
+	const long counts[] = {-1, 0, 1, 12, 150, 274, 400};
+	relative_strength_index rsi;
+	exponential_moving_average ema;
+	simple_moving_average sma;
+	moving_average_convergence_divergence macd;
+	bollinger bb;
+	struct bollinger_bands filled, made;
+	series_buffer buffer;
+	double *expected, *out;
+	long valid, x, y;
+
+	for (y = 0; y < 2; y++) {
+		stockinfo si = test_prices(y ? 300 : 15);
+
+		for (x = 0; x < 7; x++) {
+			long count = counts[x];
+
+			out = buffer.reserve(series_size(count));
+
+			expected = rsi.generate(si, 14, count);
+			valid = rsi.fill(si, 14, count, out);
+			REQUIRE(same_values(out, expected, count));
+			REQUIRE(valid <= std::max(count, 0L));
+			free(expected);
+
+			expected = ema.generate(si, 20, count);
+			valid = ema.fill(si, 20, count, out);
+			REQUIRE(same_values(out, expected, count));
+			REQUIRE((valid == 0 || out[valid - 1] != 0));
+			free(expected);
+
+			expected = sma.generate(si, 20, count);
+			valid = sma.fill(si, 20, count, out);
+			REQUIRE(same_values(out, expected, count));
+			if (valid < count)
+				REQUIRE(out[valid] == 0);
+			free(expected);
+
+			expected = macd.generate(si, 12, 26, count);
+			valid = macd.fill(si, 12, 26, count, out);
+			REQUIRE(same_values(out, expected, count));
+			REQUIRE(valid <= std::max(count, 0L));
+			free(expected);
+
+			expected = macd.histogram(si, 12, 26, 9, count);
+			valid = macd.fill_histogram(si, 12, 26, 9, count, out);
+			REQUIRE(same_values(out, expected, count));
+			REQUIRE(valid <= std::max(count, 0L));
+			free(expected);
+
+			made = bb.generate(si, 20, 2, count);
+			filled = bb.fill(si, 20, 2, count, buffer.reserve(BOLLINGER_SERIES * series_size(count)));
+			REQUIRE(memcmp(made.upper, filled.upper, sizeof(double) * BOLLINGER_SERIES * series_size(count)) == 0);
+			REQUIRE(made.valid == filled.valid);
+			bb.release(made);
+		}
+	}
+
+	// Only the rows with a full period behind them are valid.
+	stockinfo si = test_prices(100);
+	out = buffer.reserve(series_size(90));
+	REQUIRE(sma.fill(si, 20, 90, out) == 80);
+	REQUIRE(out[79] != 0);
+	REQUIRE(out[80] == 0);
+	REQUIRE(ema.fill(si, 20, 90, out) == 79);
+	REQUIRE(macd.fill(si, 12, 26, 90, out) == 74);
+	REQUIRE(bb.fill(si, 20, 2, 90, buffer.reserve(BOLLINGER_SERIES * series_size(90))).valid == 80);
+}
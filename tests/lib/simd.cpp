@@ -0,0 +1,250 @@
+#include "lib/third_party/catch2/catch.hpp"
+#include <math.h>
+#include <stdint.h>
+#include <string.h>
+#include <stdlib.h>
+#include "lib/stats/simd.h"
+#include "tests/prices.h"
+using namespace Catch;
+
+// The most that a vector kernel may differ from the scalar one, in units in the last place. Both SMAs carry one
+// running sum through the whole history, so after a stock falls a long way their error is large next to its price.
+#define MEAN_ULPS 512
+#define SMOOTH_ULPS 64
+
+// The RSI multiplies by the reciprocal of its period at the vector levels. Wilder's smoothing forgets old rounding
+// errors at (period - 1) / period a row, so they never add up to much.
+#define STRENGTH_ULPS 64
+
+// The most that a vector SMA may differ from the exact mean.
+#define EXACT_MEAN_ULPS 256
+
+// The most that the squares of two band widths may differ, next to the square of the price. The scalar bands keep a
+// running sum of squares, and the square root of its rounding error is large when a window is nearly flat.
+#define VARIANCE_TOLERANCE 1e-13
+
+/**
+ * The mean of values[row] to values[row + period - 1], rounded once.
+ */
+static double exact_mean(const double *values, long row, int period) {
+	long double sum = 0;
+	int x;
+
+	for (x = 0; x < period; x++)
+		sum += values[row + x];
+
+	return (double)(sum / period);
+}
+
+/**
+ * How many doubles lie between a and b.
+ */
+static int64_t ulps(const double a, const double b) {
+	int64_t x, y;
+
+	if (a == b)
+		return 0;
+
+	memcpy(&x, &a, sizeof(x));
+	memcpy(&y, &b, sizeof(y));
+	x = (x < 0) ? INT64_MIN - x : x;
+	y = (y < 0) ? INT64_MIN - y : y;
+
+	return (x > y) ? x - y : y - x;
+}
+
+TEST_CASE("Pick SIMD kernels for the CPU", "[simd]") {
+	simd_level best = simd_supported();
+
+	REQUIRE(simd_select(simd_scalar) == simd_scalar);
+	REQUIRE(simd().level == simd_scalar);
+	REQUIRE(simd(simd_avx512).level == best);
+	REQUIRE(simd_select(simd_avx512) == best);
+	REQUIRE(simd().level == best);
+}
+
+TEST_CASE("Vector kernels agree with the scalar ones", "[simd]") {
+	const long lengths[] = {30, 64, 65, 100, 252, 1001, 5040};
+	const int periods[] = {2, 9, 12, 14, 20, 26, 50, 200};
+	const struct simd_kernels &scalar = simd(simd_scalar);
+	const double *close;
+	double *expected, *actual, *middle, *width;
+	long x, y, row, rows, start;
+	int level, period;
+
+	for (level = simd_avx2; level <= simd_supported(); level++) {
+		const struct simd_kernels &vector = simd((simd_level)level);
+		INFO("Kernels: " << vector.name);
+
+		for (x = 0; x < 7; x++) {
+			rows = lengths[x];
+			stockinfo si = test_prices(rows + 1);
+			close = si.closes();
+			expected = (double *)calloc(rows + 1, sizeof(double));
+			actual = (double *)calloc(rows + 1, sizeof(double));
+			middle = (double *)calloc(rows + 1, sizeof(double));
+			width = (double *)calloc(rows + 1, sizeof(double));
+
+			for (y = 0; y < 8; y++) {
+				period = periods[y];
+				if (rows <= period + 1)
+					continue;
+				INFO("Rows: " << rows << ", period: " << period);
+				start = rows - 1;
+
+				scalar.mean(close, start, period, expected);
+				vector.mean(close, start, period, actual);
+				for (row = 0; row < start - period; row++) {
+					REQUIRE(ulps(actual[row], expected[row]) <= MEAN_ULPS);
+					REQUIRE(ulps(actual[row], exact_mean(close, row, period)) <= EXACT_MEAN_ULPS);
+				}
+
+				scalar.deviation(close, start, period, 2, expected, middle);
+				vector.deviation(close, start, period, 2, actual, width);
+				for (row = 0; row < start - period; row++) {
+					REQUIRE(ulps(actual[row], expected[row]) <= MEAN_ULPS);
+					REQUIRE(fabs(width[row] * width[row] - middle[row] * middle[row]) <= VARIANCE_TOLERANCE * expected[row] * expected[row]);
+				}
+
+				scalar.smooth(close, start, 2.0 / (period + 1), start - period, expected);
+				vector.smooth(close, start, 2.0 / (period + 1), start - period, actual);
+				for (row = 0; row < start - period; row++)
+					REQUIRE(ulps(actual[row], expected[row]) <= SMOOTH_ULPS);
+
+				scalar.strength(close, start, period, start - period, expected);
+				vector.strength(close, start, period, start - period, actual);
+				for (row = 0; row < start - period; row++)
+					REQUIRE(ulps(actual[row], expected[row]) <= STRENGTH_ULPS);
+			}
+
+			for (row = 1; row <= rows; row += (row < 40) ? 1 : 37) {
+				REQUIRE(vector.highest(close, row) == scalar.highest(close, row));
+				REQUIRE(vector.lowest(close, row) == scalar.lowest(close, row));
+			}
+
+			free(expected);
+			free(actual);
+			free(middle);
+			free(width);
+		}
+	}
+}
+
+TEST_CASE("Vector bands of flat prices have no width", "[simd]") {
+	double close[301], middle[301], width[301];
+	long row;
+	int level;
+
+	for (row = 0; row < 301; row++)
+		close[row] = 12.34;
+
+	for (level = simd_scalar; level <= simd_supported(); level++) {
+		simd((simd_level)level).deviation(close, 300, 20, 2, middle, width);
+		for (row = 0; row < 280; row++) {
+			REQUIRE(middle[row] == Approx(12.34));
+			REQUIRE(width[row] < 1e-12);
+		}
+	}
+}
+
+TEST_CASE("Vector bands agree with the scalar ones over long histories", "[simd]") {
+	const int periods[] = {2, 3, 5, 7, 20, 26, 50, 200};
+	const long rows = 10080, start = rows - 1;
+	const struct simd_kernels &scalar = simd(simd_scalar);
+	const double *close;
+	double *middle[2], *width[2];
+	long row;
+	int seed, level, x, period;
+
+	for (x = 0; x < 2; x++) {
+		middle[x] = (double *)calloc(rows + 1, sizeof(double));
+		width[x] = (double *)calloc(rows + 1, sizeof(double));
+	}
+
+	// Forty years of each of a few stocks. Their middles are mean(), which the tests above cover.
+	for (seed = 0; seed < 4; seed++) {
+		stockinfo si = test_prices(rows + 1, seed);
+		close = si.closes();
+
+		for (level = simd_avx2; level <= simd_supported(); level++) {
+			const struct simd_kernels &vector = simd((simd_level)level);
+
+			for (x = 0; x < 8; x++) {
+				period = periods[x];
+				INFO("Kernels: " << vector.name << ", seed: " << seed << ", period: " << period);
+
+				scalar.deviation(close, start, period, 2, middle[0], width[0]);
+				vector.deviation(close, start, period, 2, middle[1], width[1]);
+				for (row = 0; row < start - period; row++)
+					REQUIRE(fabs(width[1][row] * width[1][row] - width[0][row] * width[0][row]) <= VARIANCE_TOLERANCE * middle[0][row] * middle[0][row]);
+			}
+		}
+	}
+
+	for (x = 0; x < 2; x++) {
+		free(middle[x]);
+		free(width[x]);
+	}
+}
+
+TEST_CASE("SIMD kernel throughput", "[.][simd][benchmark]") {
+	const long rows = 20 * 252;
+	stockinfo si = test_prices(rows + 1);
+	const double *close = si.closes();
+	double *out = (double *)malloc(sizeof(double) * (rows + 1)), *width = (double *)malloc(sizeof(double) * (rows + 1)), total = 0;
+	double seconds;
+	const int runs = 200;
+	int level;
+
+	for (level = simd_scalar; level <= simd_supported(); level++) {
+		const struct simd_kernels &k = simd((simd_level)level);
+
+		seconds = time_per_run(runs, [&]() {
+			k.mean(close, rows - 1, 20, out);
+			total += out[0];
+		});
+		printf("%-7s SMA(20) of 20 years: %.2f us\n", k.name, seconds * 1e6);
+
+		seconds = time_per_run(runs, [&]() {
+			k.deviation(close, rows - 1, 20, 2, out, width);
+			total += width[0];
+		});
+		printf("%-7s Bollinger(20, 2) of 20 years: %.2f us\n", k.name, seconds * 1e6);
+
+		seconds = time_per_run(runs, [&]() {
+			k.smooth(close, rows - 1, 2.0 / 27, rows - 27, out);
+			total += out[0];
+		});
+		printf("%-7s EMA(26) of 20 years: %.2f us\n", k.name, seconds * 1e6);
+
+		seconds = time_per_run(runs, [&]() { total += k.highest(close, rows) - k.lowest(close, rows); });
+		printf("%-7s High and low of 20 years: %.2f us\n", k.name, seconds * 1e6);
+	}
+
+	free(out);
+	free(width);
+	REQUIRE(total > 0);
+}
+
+TEST_CASE("RSI kernel throughput", "[.][simd][benchmark]") {
+	const long rows = 20 * 252;
+	stockinfo si = test_prices(rows + 1);
+	const double *close = si.closes();
+	double *out = (double *)malloc(sizeof(double) * (rows + 1)), total = 0, seconds;
+	const int runs = 200;
+	int level;
+
+	// The vector levels run Wilder's smoothing with multiplies instead of divides.
+	for (level = simd_scalar; level <= simd_supported(); level++) {
+		const struct simd_kernels &k = simd((simd_level)level);
+
+		seconds = time_per_run(runs, [&]() {
+			k.strength(close, rows - 1, 14, rows - 15, out);
+			total += out[0];
+		});
+		printf("%-7s RSI(14) of 20 years: %.2f us\n", k.name, seconds * 1e6);
+	}
+
+	free(out);
+	REQUIRE(total > 0);
+}
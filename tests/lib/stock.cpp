@@ -1,5 +1,13 @@
 #include "lib/third_party/catch2/catch.hpp"
+#include <string.h>
+#include <algorithm>
+#include <unistd.h>
+#include <sys/stat.h>
+#include <boost/log/trivial.hpp>
+#include <boost/date_time/gregorian/gregorian.hpp>
+#include "lib/bar_file.h"
 #include "lib/stock.h"
+#include "tests/prices.h"
 using namespace Catch;
 
 TEST_CASE("Load goog.csv", "[stockinfo,csv]") {
@@ -67,6 +75,12 @@ TEST_CASE("Manually build the data", "[stockinfo]") {
 	REQUIRE(si[2]->volume == 3);
 	REQUIRE(si[3]->volume == 4);
 	REQUIRE(si[4] == nullptr);
+
+	// Rows keep their own copy of the date.
+	free(s.date);
+	free(t.date);
+	free(u.date);
+	free(v.date);
 }
 
 TEST_CASE("Test assignment", "[stockinfo]") {
@@ -92,6 +106,9 @@ TEST_CASE("Test assignment", "[stockinfo]") {
 	REQUIRE(pj->length() == 1);
 	REQUIRE((*pj)[0]->volume == 2);
 	REQUIRE((*pj)[1] == nullptr);
+
+	// Rows keep their own copy of the date.
+	free(s.date);
 }
 
 TEST_CASE("Test weekly roll-ups", "[stockinfo]") {
@@ -164,6 +181,13 @@ TEST_CASE("Test weekly roll-ups", "[stockinfo]") {
 	REQUIRE(sj[1]->close == 3);
 	REQUIRE(sj[1]->volume == 10);
 	REQUIRE(sj[2] == nullptr);
+
+	// Rows keep their own copy of the date.
+	free(s.date);
+	free(t.date);
+	free(u.date);
+	free(v.date);
+	free(w.date);
 }
 
 TEST_CASE("Test 4-week roll-ups", "[stockinfo]") {
@@ -236,4 +260,732 @@ TEST_CASE("Test 4-week roll-ups", "[stockinfo]") {
 	REQUIRE(sj[1]->close == 3);
 	REQUIRE(sj[1]->volume == 6);
 	REQUIRE(sj[2] == nullptr);
-}
\ No newline at end of file
+
+	// Rows keep their own copy of the date.
+	free(s.date);
+	free(t.date);
+	free(u.date);
+	free(v.date);
+	free(w.date);
+}
+TEST_CASE("Read columns and shift rows", "[stockinfo]") {
+	stockinfo si;
+	struct stock s, t, u;
+
+	s.date = (char *)"2017-10-09";
+	s.open = 2;
+	s.high = 4;
+	s.low = 1;
+	s.close = 3;
+	s.volume = 2;
+	si += s;
+
+	t.date = (char *)"2017-10-10";
+	t.open = 3;
+	t.high = 6;
+	t.low = 2;
+	t.close = 5;
+	t.volume = 1;
+	si += t;
+
+	u = si.shift();
+
+	// Validate the remaining row, both by column and by row.
+	REQUIRE(si.length() == 1);
+	REQUIRE(si.closes()[0] == 5);
+	REQUIRE(si.highs()[0] == 6);
+	REQUIRE(si.volumes()[0] == 1);
+	REQUIRE_THAT(si[0]->date, Equals("2017-10-10"));
+
+	// Validate the row we removed.
+	REQUIRE(u.close == 3);
+	REQUIRE_THAT(u.date, Equals("2017-10-09"));
+	free(u.date);
+}
+
+TEST_CASE("View rows without copying", "[stockinfo]") {
+	stockinfo si, sj;
+	stockinfo_view view, tail;
+	struct stock s;
+	const char *dates[] = {"2017-10-09", "2017-10-10", "2017-10-11", "2017-10-16"};
+	int x;
+
+	for (x = 0; x < 4; x++) {
+		s.date = (char *)dates[x];
+		s.open = s.low = x + 1;
+		s.high = s.close = x + 2;
+		s.volume = x + 1;
+		si.insert_at(s);
+	}
+
+	// The view shares the stockinfo's columns.
+	view = stockinfo_view(si);
+	REQUIRE(view.length() == 4);
+	REQUIRE(view.closes() == si.closes());
+	REQUIRE(view.sorted());
+	REQUIRE_THAT(view[0]->date, Equals("2017-10-16"));
+
+	// Shifting only moves the window.
+	tail = view;
+	tail.shift();
+	REQUIRE(tail.length() == 3);
+	REQUIRE(tail.closes() == si.closes() + 1);
+	REQUIRE_THAT(tail[0]->date, Equals("2017-10-11"));
+	REQUIRE(tail[3] == nullptr);
+	REQUIRE(view.length() == 4);
+	REQUIRE(si.length() == 4);
+
+	// Views can start part way in, and cannot run past the end.
+	REQUIRE(stockinfo_view(si, 1, 2).length() == 2);
+	REQUIRE(stockinfo_view(si, 3, 5).length() == 1);
+	REQUIRE(stockinfo_view(si, 5).length() == 0);
+	REQUIRE(tail.shift(10).length() == 0);
+
+	// Roll-ups of a view match roll-ups of a copy of its rows.
+	sj = view.weekly();
+	REQUIRE(sj.length() == 2);
+	REQUIRE(sj[0]->open == 2);
+	REQUIRE(sj[0]->high == 5);
+	REQUIRE(sj[0]->close == 5);
+	REQUIRE(sj[0]->volume == 9);
+	REQUIRE(sj[1]->open == 1);
+	REQUIRE(sj[1]->volume == 1);
+
+	sj = stockinfo(stockinfo_view(si, 1));
+	REQUIRE(sj.length() == 3);
+	REQUIRE(sj[0]->close == 4);
+	REQUIRE(stockinfo_view(si, 1).weekly().length() == 1);
+}
+
+TEST_CASE("Share rows until they change", "[stockinfo]") {
+	stockinfo si, sj, sk;
+	stockinfo_view view;
+	struct stock s;
+	const double *closes;
+
+	s.date = (char *)"2017-10-09";
+	s.open = s.high = s.low = s.close = 3;
+	s.volume = 2;
+	si.insert_at(s);
+	s.date = (char *)"2017-10-10";
+	s.close = 4;
+	si.insert_at(s);
+
+	// Copies and views share the rows.
+	sj = si;
+	view = stockinfo_view(si);
+	closes = si.closes();
+	REQUIRE(sj.closes() == closes);
+	REQUIRE(view.closes() == closes);
+	REQUIRE(stockinfo(view).closes() == closes);
+
+	// Changing a copy leaves everything else alone.
+	s.date = (char *)"2017-10-11";
+	s.close = 5;
+	sj.insert_at(s);
+	REQUIRE(sj.length() == 3);
+	REQUIRE(sj[0]->close == 5);
+	REQUIRE(si.length() == 2);
+	REQUIRE(si.closes() == closes);
+	REQUIRE(si[0]->close == 4);
+
+	// Views keep the rows they were made with.
+	free(si.shift().date);
+	REQUIRE(si.length() == 1);
+	REQUIRE(view.length() == 2);
+	REQUIRE(view[0]->close == 4);
+	REQUIRE(view.closes() == closes);
+
+	// Moving hands the rows over without copying them.
+	closes = sj.closes();
+	sk = std::move(sj);
+	REQUIRE(sk.closes() == closes);
+	REQUIRE(sk.length() == 3);
+	REQUIRE(sj.length() == 0);
+	REQUIRE(sj[0] == nullptr);
+
+	stockinfo sl(std::move(sk));
+	REQUIRE(sl.closes() == closes);
+	REQUIRE(sk.length() == 0);
+
+	// Moved-from objects can be used again.
+	sk.insert_at(s);
+	REQUIRE(sk.length() == 1);
+	REQUIRE(sl.length() == 3);
+}
+
+TEST_CASE("Remove duplicate days", "[stockinfo]") {
+	stockinfo si;
+	struct stock s = {};
+	const char *dates[] = {"2017-10-09", "2017-10-10", "2017-10-09", "2017-10-11", "2017-10-09", "2017-10-10"};
+	int x;
+
+	for (x = 0; x < 6; x++) {
+		s.date = (char *)dates[x];
+		s.close = x;
+		si += s;
+	}
+
+	si.uniq();
+
+	// Every run of duplicates is removed, keeping the row that was nearest the front.
+	REQUIRE(si.length() == 3);
+	REQUIRE_THAT(si[0]->date, Equals("2017-10-11"));
+	REQUIRE(si[0]->close == 3);
+	REQUIRE_THAT(si[1]->date, Equals("2017-10-10"));
+	REQUIRE(si[1]->close == 1);
+	REQUIRE_THAT(si[2]->date, Equals("2017-10-09"));
+	REQUIRE(si[2]->close == 0);
+}
+
+TEST_CASE("Merge new bars into history", "[stockinfo]") {
+	stockinfo history, fresh, si;
+	struct stock s = {};
+	const char *old_dates[] = {"2017-10-12", "2017-10-11", "2017-10-10", "2017-10-09"};
+	const char *new_dates[] = {"2017-10-16", "2017-10-13", "2017-10-12", "2017-10-12", "2017-10-11"};
+	const double *closes;
+	int x;
+
+	for (x = 0; x < 4; x++) {
+		s.date = (char *)old_dates[x];
+		s.close = x;
+		history += s;
+	}
+
+	for (x = 0; x < 5; x++) {
+		s.date = (char *)new_dates[x];
+		s.close = 10 + x;
+		fresh += s;
+	}
+
+	// Newer bars win by default, and duplicates within the batch are dropped.
+	si = history;
+	si.merge(fresh);
+	REQUIRE(si.length() == 6);
+	REQUIRE_THAT(si[0]->date, Equals("2017-10-16"));
+	REQUIRE(si[0]->close == 10);
+	REQUIRE(si[2]->close == 12);
+	REQUIRE(si[3]->close == 14);
+	REQUIRE(si[4]->close == 2);
+	REQUIRE_THAT(si[5]->date, Equals("2017-10-09"));
+	REQUIRE(history.length() == 4);
+
+	// Or the existing bars can be kept.
+	si = history;
+	si.merge(fresh, keep_existing);
+	REQUIRE(si.length() == 6);
+	REQUIRE(si[0]->close == 10);
+	REQUIRE(si[2]->close == 0);
+	REQUIRE(si[3]->close == 1);
+
+	// The batch does not need to be in order.
+	si = history;
+	fresh = stockinfo();
+	s.date = (char *)"2017-10-05";
+	s.close = 20;
+	fresh += s;
+	s.date = (char *)"2017-10-13";
+	s.close = 21;
+	fresh += s;
+	si.merge(fresh);
+	REQUIRE(si.length() == 6);
+	REQUIRE(si[0]->close == 21);
+	REQUIRE(si[5]->close == 20);
+
+	// Merging bars we already have changes nothing.
+	si = history;
+	closes = si.closes();
+	si.merge(history);
+	REQUIRE(si.length() == 4);
+	REQUIRE(si.closes() == closes);
+}
+
+TEST_CASE("Save and load a bar file", "[stockinfo,bars]") {
+	stockinfo si, sj;
+	struct stock s, t;
+
+	s.date = (char *)"2017-10-09";
+	s.open = 2;
+	s.high = 4;
+	s.low = 1;
+	s.close = 3;
+	s.volume = 2;
+	si += s;
+
+	t.date = (char *)"2017-10-10";
+	t.open = 3;
+	t.high = 6;
+	t.low = 2;
+	t.close = 5;
+	t.volume = 1;
+	si.insert_at(t);
+
+	REQUIRE(si.save_bars("rsiscan-test.bars") == true);
+	REQUIRE(sj.load_bars("rsiscan-test.bars") == true);
+	unlink("rsiscan-test.bars");
+
+	// Validate the data in our class.
+	REQUIRE(sj.length() == 2);
+	REQUIRE(sj[0]->timestamp == si[0]->timestamp);
+	REQUIRE(sj[0]->close == 5);
+	REQUIRE(sj[1]->open == 2);
+	REQUIRE(sj[1]->volume == 2);
+	REQUIRE_THAT(sj[1]->date, Equals("2017-10-09"));
+
+	// Nothing changed, so there is nothing to save.
+	REQUIRE(sj.save_bars() == false);
+
+	// Reject files that are not bar files.
+	REQUIRE(sj.load_bars("non-existant-file-goo.bars") == false);
+}
+
+TEST_CASE("Append daily updates to a bar log", "[stockinfo,bars]") {
+	stockinfo si, sj, sk;
+	struct stock s;
+	char date[16];
+	struct stat buf;
+	long x;
+
+	s.open = 2;
+	s.high = 4;
+	s.low = 1;
+	s.volume = 2;
+	for (x = 1; x <= 5; x++) {
+		sprintf(date, "2017-09-%02li", x);
+		s.date = date;
+		s.close = x;
+		si.insert_at(s);
+	}
+
+	unlink("rsiscan-test.bars.log");
+	REQUIRE(si.save_bars("rsiscan-test.bars") == true);
+	REQUIRE(sj.load_bars("rsiscan-test.bars") == true);
+
+	// New days go in the log, and are read back on top of the bar file.
+	s.date = (char *)"2017-09-06";
+	s.close = 6;
+	sj.insert_at(s);
+	s.date = (char *)"2017-09-07";
+	s.close = 7;
+	sj.insert_at(s);
+	REQUIRE(sj.save_bars() == true);
+	REQUIRE(stat("rsiscan-test.bars.log", &buf) == 0);
+
+	REQUIRE(sk.load_bars("rsiscan-test.bars") == true);
+	REQUIRE(sk.length() == 7);
+	REQUIRE(sk[0]->close == 7);
+	REQUIRE(sk[1]->close == 6);
+	REQUIRE(sk[2]->close == 5);
+	REQUIRE(sk[0]->timestamp == sj[0]->timestamp);
+	REQUIRE_THAT(sk[0]->date, Equals("2017-09-07"));
+
+	// Changing an old row rewrites the file and removes the log.
+	free(sk.shift().date);
+	sk.insert_at(s, sk.length());
+	REQUIRE(sk.save_bars() == true);
+	REQUIRE(stat("rsiscan-test.bars.log", &buf) == -1);
+
+	REQUIRE(sj.load_bars("rsiscan-test.bars") == true);
+	REQUIRE(sj.length() == 7);
+	REQUIRE(sj[0]->close == 6);
+	REQUIRE(sj[6]->close == 7);
+
+	// The log is folded back into the file once it is full.
+	s.date = nullptr;
+	for (x = 1; x < BAR_LOG_COMPACT_ROWS; x++) {
+		s.timestamp = sj[0]->timestamp + 86400;
+		s.close = x;
+		sj.insert_at(s);
+		REQUIRE(sj.save_bars() == true);
+	}
+	REQUIRE(stat("rsiscan-test.bars.log", &buf) == 0);
+
+	s.timestamp = sj[0]->timestamp + 86400;
+	sj.insert_at(s);
+	REQUIRE(sj.save_bars() == true);
+	REQUIRE(stat("rsiscan-test.bars.log", &buf) == -1);
+
+	REQUIRE(sk.load_bars("rsiscan-test.bars") == true);
+	REQUIRE(sk.length() == 7 + BAR_LOG_COMPACT_ROWS);
+	REQUIRE(sk[0]->timestamp == sj[0]->timestamp);
+
+	unlink("rsiscan-test.bars");
+	unlink("rsiscan-test.bars.log");
+}
+
+TEST_CASE("Reject older bar files", "[stockinfo,bars]") {
+	struct bar_file_header header;
+	stockinfo si;
+	struct stock s = {};
+	FILE *f;
+
+	s.date = (char *)"2017-10-09";
+	si += s;
+	REQUIRE(si.save_bars("rsiscan-test.bars") == true);
+
+	// Versions 1 and 2 keyed rows by timestamp. The cache is rebuilt from downloads instead of reading them.
+	f = fopen("rsiscan-test.bars", "r+");
+	REQUIRE(fread(&header, sizeof(header), 1, f) == 1);
+	header.version = 2;
+	fseek(f, 0, SEEK_SET);
+	fwrite(&header, sizeof(header), 1, f);
+	fclose(f);
+
+	REQUIRE(si.load_bars("rsiscan-test.bars") == false);
+	unlink("rsiscan-test.bars");
+}
+
+TEST_CASE("Reject bar files with more rows than bytes", "[stockinfo,bars]") {
+	struct bar_file_header header;
+	uint64_t size = 1024;
+
+	// Enough rows for the column offsets to wrap around to a size that fits.
+	header = bar_file_new_header((uint64_t)1 << 62);
+	REQUIRE(bar_file_layout(header.rows).size <= size);
+	REQUIRE(bar_file_valid(&header, size) == false);
+
+	header.rows = 16;
+	REQUIRE(bar_file_valid(&header, bar_file_layout(header.rows).size) == true);
+	REQUIRE(bar_file_valid(&header, bar_file_layout(header.rows).size - 1) == false);
+}
+
+TEST_CASE("Track the order of rows", "[stockinfo]") {
+	stockinfo si, sj;
+	struct stock s = {};
+
+	// Empty data is in order.
+	REQUIRE(si.sorted());
+	REQUIRE(si.unique());
+
+	// New rows that are older than the rest keep the order.
+	s.date = (char *)"2017-10-10";
+	si += s;
+	s.date = (char *)"2017-10-09";
+	si += s;
+	REQUIRE(si.sorted());
+	REQUIRE(si.unique());
+	REQUIRE(si.check_order());
+
+	// A repeated day is still sorted.
+	si += s;
+	REQUIRE(si.sorted());
+	REQUIRE_FALSE(si.unique());
+	si.uniq();
+	REQUIRE(si.length() == 2);
+	REQUIRE(si.unique());
+
+	// A newer row at the end is not.
+	s.date = (char *)"2017-10-11";
+	si += s;
+	REQUIRE_FALSE(si.sorted());
+	REQUIRE_FALSE(si.unique());
+	REQUIRE(si.check_order());
+
+	// Copies share the flags, and sorting sets them again.
+	sj = si;
+	REQUIRE_FALSE(sj.sorted());
+	si.sort();
+	REQUIRE(si.sorted());
+	REQUIRE(si.unique());
+	REQUIRE_FALSE(sj.sorted());
+	REQUIRE_THAT(si[0]->date, Equals("2017-10-11"));
+
+	// Removing rows, or inserting them in order, keeps the order.
+	free(si.shift().date);
+	REQUIRE(si.unique());
+	s.date = (char *)"2017-10-12";
+	si.insert_at(s);
+	REQUIRE(si.unique());
+	REQUIRE(si.check_order());
+	REQUIRE(stockinfo(stockinfo_view(si, 1)).unique());
+}
+
+TEST_CASE("Cache roll-ups until the rows change", "[stockinfo]") {
+	stockinfo si, sj, weekly;
+	struct stock s = {};
+	const char *dates[] = {"2017-10-16", "2017-10-11", "2017-10-10", "2017-10-09"};
+	int x;
+
+	for (x = 0; x < 4; x++) {
+		s.date = (char *)dates[x];
+		s.close = x;
+		s.volume = 1;
+		si += s;
+	}
+
+	// The same roll-up is only made once, whether it is asked for by a stockinfo or a view of it.
+	weekly = si.weekly();
+	REQUIRE(weekly.length() == 2);
+	REQUIRE(si.weekly().closes() == weekly.closes());
+	REQUIRE(stockinfo_view(si).weekly().closes() == weekly.closes());
+	REQUIRE(si.rollup(1, month).closes() != weekly.closes());
+	REQUIRE(si.weekly(true).closes() != weekly.closes());
+	REQUIRE(si.rollup(2, week).closes() != weekly.closes());
+
+	// Copies share the cache. Views of part of the rows do not use it.
+	sj = si;
+	REQUIRE(sj.weekly().closes() == weekly.closes());
+	REQUIRE(stockinfo_view(si, 1).weekly().closes() != weekly.closes());
+
+	// Changing the rows starts over.
+	s.date = (char *)"2017-10-17";
+	s.volume = 5;
+	si.insert_at(s);
+	REQUIRE(si.weekly().closes() != weekly.closes());
+	REQUIRE(si.weekly()[0]->volume == 7);
+	REQUIRE(sj.weekly().closes() == weekly.closes());
+	REQUIRE(weekly[0]->volume == 3);
+
+	// Changing a cached roll-up does not change the cache.
+	weekly.insert_at(s);
+	REQUIRE(sj.weekly().length() == 2);
+}
+
+/**
+ * The roll-up that stockinfo used before it bucketed day numbers directly, for comparison. It steps boost
+ * date iterators back one period at a time and logs every row.
+ */
+template<class T>
+static stockinfo legacy_rollup_iterator(const stockinfo &data, T &iterator, int number) {
+	boost::gregorian::date current_date;
+	bool add = false, init = true;
+	struct stock tmp;
+	stockinfo ret;
+	unsigned m, d;
+	int y;
+	long x;
+
+	civil_from_days(data.days()[0], &y, &m, &d);
+	current_date = boost::gregorian::date(y, m, d);
+	while (iterator > current_date)
+		for (int n = 0; n < number; n++)
+			--iterator;
+
+	for (x = 0; x < data.length(); x++) {
+		civil_from_days(data.days()[x], &y, &m, &d);
+		current_date = boost::gregorian::date(y, m, d);
+
+		if (iterator >= current_date) {
+			BOOST_LOG_TRIVIAL(info) << "Decrement iterator.";
+			for (int n = 0; n < number; n++)
+				--iterator;
+			init = true;
+
+			if (add)
+				ret += tmp;
+		}
+
+		if (init) {
+			tmp.open = data.opens()[x];
+			tmp.high = data.highs()[x];
+			tmp.low = data.lows()[x];
+			tmp.close = data.closes()[x];
+			tmp.volume = data.volumes()[x];
+			BOOST_LOG_TRIVIAL(info) << "Set high: " << tmp.high << ", low: " << tmp.low << ", volume = " << tmp.volume;
+			init = false;
+		} else {
+			if (data.highs()[x] > tmp.high)
+				tmp.high = data.highs()[x];
+			if (data.lows()[x] < tmp.low)
+				tmp.low = data.lows()[x];
+			BOOST_LOG_TRIVIAL(info) << "Added volume: " << data.volumes()[x];
+			tmp.open = data.opens()[x];
+			tmp.volume += data.volumes()[x];
+		}
+
+		tmp.timestamp = (time_t)data.days()[x] * SECONDS_PER_DAY;
+		tmp.date = nullptr;
+		add = true;
+	}
+
+	if (add)
+		ret += tmp;
+
+	return ret;
+}
+
+static stockinfo legacy_rollup(const stockinfo &data, int number, timeperiods period, bool align_week) {
+	unsigned m, d;
+	int y;
+
+	civil_from_days(data.days()[0], &y, &m, &d);
+	boost::gregorian::date start(y, m, d);
+	if (align_week)
+		start = next_weekday(start, boost::gregorian::greg_weekday(boost::gregorian::Sunday));
+
+	boost::gregorian::day_iterator itr_day(start);
+	boost::gregorian::week_iterator itr_week(start);
+	boost::gregorian::month_iterator itr_month(start);
+	boost::gregorian::year_iterator itr_year(start);
+
+	switch (period) {
+		case day:
+			return legacy_rollup_iterator(data, itr_day, number);
+		case week:
+			return legacy_rollup_iterator(data, itr_week, number);
+		case month:
+			return legacy_rollup_iterator(data, itr_month, number);
+		case year:
+			return legacy_rollup_iterator(data, itr_year, number);
+		default:
+			return data;
+	}
+}
+
+static bool same_bars(const stockinfo &a, const stockinfo &b) {
+	long n = a.length();
+
+	return (n == b.length()) && (memcmp(a.days(), b.days(), n * sizeof(int32_t)) == 0) &&
+	       (memcmp(a.opens(), b.opens(), n * sizeof(double)) == 0) && (memcmp(a.highs(), b.highs(), n * sizeof(double)) == 0) &&
+	       (memcmp(a.lows(), b.lows(), n * sizeof(double)) == 0) && (memcmp(a.closes(), b.closes(), n * sizeof(double)) == 0) &&
+	       (memcmp(a.volumes(), b.volumes(), n * sizeof(long)) == 0);
+}
+
+TEST_CASE("Roll-ups match the boost iterators", "[stockinfo]") {
+	const timeperiods periods[] = {day, week, month, year};
+	int number, align, x;
+
+	// Without gaps longer than a period, both ways agree on every bar. Month ends and leap days move the
+	// month and year edges around.
+	stockinfo si = test_prices(800);
+	for (x = 0; x < 4; x++)
+		for (number = 1; number <= 3; number++)
+			for (align = 0; align <= 1; align++)
+				REQUIRE(same_bars(stockinfo_view(si).rollup(number, periods[x], align), legacy_rollup(si, number, periods[x], align)));
+
+	si = test_prices(800, {0, 50, days_from_civil(2017, 10, 31), true, 0});
+	for (x = 1; x < 4; x++)
+		for (align = 0; align <= 1; align++)
+			REQUIRE(same_bars(stockinfo_view(si).rollup(1, periods[x], align), legacy_rollup(si, 1, periods[x], align)));
+
+	// Quarters are three months.
+	REQUIRE(same_bars(si.rollup(1, quarter), si.rollup(3, month)));
+	REQUIRE(same_bars(si.rollup(2, quarter, true), si.rollup(6, month, true)));
+}
+
+TEST_CASE("Roll-ups skip empty periods", "[stockinfo]") {
+	stockinfo si, sj;
+	struct stock s = {};
+	const char *dates[] = {"2017-10-31", "2017-10-30", "2017-08-01", "2017-07-31"};
+	int x;
+
+	for (x = 0; x < 4; x++) {
+		s.date = (char *)dates[x];
+		s.open = s.high = s.low = s.close = x;
+		s.volume = 1;
+		si += s;
+	}
+
+	// Two months without bars are skipped, instead of giving every later row a bar of its own.
+	sj = si.weekly();
+	REQUIRE(sj.length() == 2);
+	REQUIRE_THAT(sj[0]->date, Equals("2017-10-30"));
+	REQUIRE(sj[0]->volume == 2);
+	REQUIRE_THAT(sj[1]->date, Equals("2017-07-31"));
+	REQUIRE(sj[1]->open == 3);
+	REQUIRE(sj[1]->close == 2);
+	REQUIRE(sj[1]->volume == 2);
+}
+
+TEST_CASE("Roll calendar bars forward", "[stockinfo,bars]") {
+	const timeperiods periods[] = {week, month, quarter, year};
+	stockinfo si = test_prices(800, {0, 50, days_from_civil(2017, 10, 31), true, 0}), sj, sk;
+	struct stock s = {};
+	struct stat buf;
+	long days, x;
+
+	// Calendar bars end on Sunday, and on the last day of a month, quarter or year.
+	sj = si.calendar(month);
+	REQUIRE_THAT(sj[0]->date, Equals("2017-10-02"));
+	REQUIRE_THAT(sj[1]->date, Equals("2017-09-01"));
+	REQUIRE(same_bars(si.calendar(week), si.weekly(true)));
+	REQUIRE_THAT(si.calendar(year)[0]->date, Equals("2017-01-02"));
+
+	// Adding days to the daily bars only changes the latest calendar bar, or adds new ones. Bars that do not
+	// start where the daily bars do are rebuilt.
+	for (x = 0; x < 4; x++) {
+		for (days = 1; days <= 40; days += 13) {
+			sj = stockinfo(stockinfo_view(si, days)).calendar(periods[x]);
+			sk = stockinfo(stockinfo_view(si, 0, si.length() - days)).calendar(periods[x]);
+			REQUIRE(same_bars(sj.roll_forward(si, periods[x], si.days()[days - 1]), stockinfo_view(si).calendar(periods[x])));
+			REQUIRE(same_bars(sk.roll_forward(si, periods[x], si.days()[0]), sj));
+		}
+	}
+
+	// Correcting an older day rebuilds the bars that were saved before it.
+	sj = si.calendar(month);
+	sk = si;
+	s.timestamp = (time_t)si.days()[300] * SECONDS_PER_DAY;
+	s.open = s.high = s.low = s.close = 1000;
+	s.volume = 1;
+	sk.merge(stockinfo() += s);
+	REQUIRE(same_bars(sj.roll_forward(sk, month, si.days()[300]), stockinfo(sk).calendar(month)));
+	REQUIRE(*std::max_element(sj.highs(), sj.highs() + sj.length()) == 1000);
+
+	// Roll-ups of the daily bars use what was rolled forward.
+	sj = stockinfo(stockinfo_view(si, 3)).calendar(week);
+	sj.roll_forward(si, week, si.days()[2]);
+	REQUIRE(si.calendar(week).closes() == sj.closes());
+
+	// Only the latest bar goes in the log.
+	unlink("rsiscan-test.week.bars.log");
+	sj = stockinfo(stockinfo_view(si, 1)).calendar(week);
+	REQUIRE(sj.save_bars("rsiscan-test.week.bars") == true);
+	REQUIRE(sk.load_bars("rsiscan-test.week.bars") == true);
+	REQUIRE(sk.roll_forward(si, week, si.days()[0]).save_bars() == true);
+	REQUIRE(stat("rsiscan-test.week.bars.log", &buf) == 0);
+
+	REQUIRE(sj.load_bars("rsiscan-test.week.bars") == true);
+	REQUIRE(same_bars(sj, si.calendar(week)));
+
+	unlink("rsiscan-test.week.bars");
+	unlink("rsiscan-test.week.bars.log");
+}
+
+TEST_CASE("Roll up a walk-back from every row's calendar bars", "[stockinfo]") {
+	const timeperiods periods[] = {week, month, quarter};
+	stockinfo si, all;
+	stockinfo_view data;
+	long drop;
+	int x, weekdays;
+
+	// Each day of the walk drops one more row. Copies of the rows have none of the cached bars to start from.
+	for (weekdays = 0; weekdays <= 1; weekdays++) {
+		si = test_prices(400, {0, 50, days_from_civil(2017, 10, 31), weekdays == 1, 0});
+		for (x = 0; x < 3; x++) {
+			all = si.calendar(periods[x]);
+			for (data = stockinfo_view(si), drop = 0; drop < 100; drop++, data.shift()) {
+				INFO("Period: " << periods[x] << ", dropped: " << drop);
+				REQUIRE(same_bars(data.calendar(periods[x]), stockinfo(data).calendar(periods[x])));
+			}
+			REQUIRE(si.calendar(periods[x]).closes() == all.closes());
+		}
+	}
+
+	// Other alignments, and views that stop short of the oldest row, are rolled up from scratch.
+	data = stockinfo_view(si, 3);
+	REQUIRE(same_bars(data.weekly(true), stockinfo(data).weekly(true)));
+	data = stockinfo_view(si, 3, 200);
+	REQUIRE(same_bars(data.calendar(week), stockinfo(data).calendar(week)));
+}
+
+TEST_CASE("Roll-up throughput", "[.][stockinfo][benchmark]") {
+	const timeperiods periods[] = {week, month, year};
+	const char *names[] = {"weekly", "monthly", "yearly"};
+	stockinfo si = test_prices(20 * 261, {0, 50, days_from_civil(2017, 10, 31), true, 0}), fast, slow;
+	const int runs = 20;
+	double seconds;
+	int x;
+
+	for (x = 0; x < 3; x++) {
+		seconds = time_per_run(runs, [&]() { slow = legacy_rollup(si, 1, periods[x], false); });
+		printf("boost iterator %s roll-up of 20 years: %.3f ms\n", names[x], seconds * 1000);
+
+		// Views of every row would hit the cache, so roll up a view of all but one.
+		seconds = time_per_run(runs, [&]() { fast = stockinfo_view(si, 0, si.length() - 1).rollup(1, periods[x], false); });
+		printf("bucketed %s roll-up of 20 years: %.3f ms\n", names[x], seconds * 1000);
+
+		REQUIRE(fast.length() > 0);
+		REQUIRE(slow.length() > 0);
+	}
+}
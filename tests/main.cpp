@@ -5,6 +5,7 @@
 #include <boost/log/utility/setup/common_attributes.hpp>
 
 #define CATCH_CONFIG_RUNNER
+#define CATCH_CONFIG_NO_POSIX_SIGNALS
 #include "lib/third_party/catch2/catch.hpp"
 #include "lib/config.h"
 
@@ -24,5 +25,6 @@ int main( int argc, char* argv[] ) {
 
   int result = Catch::Session().run( argc, argv );
 
+  free(logfile);
   return result;
 }
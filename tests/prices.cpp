@@ -0,0 +1,59 @@
+#include <math.h>
+#include <algorithm>
+#include <vector>
+#include "lib/calendar.h"
+#include "tests/prices.h"
+
+static double cents(double price) {
+	return round(price * 100) / 100;
+}
+
+/**
+ * Each close moves up to 2.5% from the one before, and about one day in a hundred jumps 20% up or down, so a
+ * few thousand bars look like twenty years of a real stock. Prices are rounded to the cent, so windows often
+ * hold equal extremes. The open, high, low and volume come from the same draw as the close.
+ */
+stockinfo test_prices(long count, const struct price_walk &walk) {
+	std::vector<struct stock> bars;
+	std::vector<int32_t> days;
+	struct stock s = {};
+	stockinfo ret;
+	uint64_t seed = 88172645463325252ull + walk.seed;
+	double price = walk.base;
+	int32_t day;
+	long x;
+
+	for (day = walk.newest; (long)days.size() < count; day--) {
+		if (walk.gap && (day == walk.newest - walk.gap))
+			continue;
+		if (walk.weekdays && ((weekday_from_days(day) == 0) || (weekday_from_days(day) == 6)))
+			continue;
+		days.push_back(day);
+	}
+
+	// Walk forward from the oldest day, then add the bars newest first.
+	for (x = count - 1; x >= 0; x--) {
+		seed ^= seed << 13;
+		seed ^= seed >> 7;
+		seed ^= seed << 17;
+		price *= 1 + ((double)(seed % 2001) - 1000) / 40000;
+		if (seed % 97 == 0)
+			price *= (seed & 256) ? 1.2 : 0.8;
+
+		s.timestamp = (time_t)days[x] * SECONDS_PER_DAY;
+		s.close = cents(price);
+		s.open = cents(price * (1 + ((double)(seed % 7) - 3) / 400));
+		s.high = std::max(s.open, s.close) + (double)(seed % 5) / 100;
+		s.low = std::max(std::min(s.open, s.close) - (double)(seed % 3) / 100, 0.01);
+		s.volume = 1000 + (long)(seed % 100000);
+		bars.push_back(s);
+	}
+	for (x = count - 1; x >= 0; x--)
+		ret += bars[x];
+
+	return ret;
+}
+
+stockinfo test_prices(long count, uint64_t seed, double base) {
+	return test_prices(count, {seed, base, days_from_civil(2017, 10, 31), false, 0});
+}
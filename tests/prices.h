@@ -0,0 +1,44 @@
+#include <stdint.h>
+#include <chrono>
+#include "lib/stock.h"
+
+#ifndef _test_prices_h
+#define _test_prices_h
+/**
+ * How test_prices() lays out its bars. Bars run one a day up to the newest day, skipping weekends if weekdays
+ * is set, and skipping the day gap days before the newest if gap is set.
+ */
+struct price_walk {
+	uint64_t seed;
+	double base;
+	int32_t newest;
+	bool weekdays;
+	long gap;
+};
+
+/**
+ * A seeded random walk of count bars, newest first, for tests that need a real-looking history. The same seed
+ * always gives the same bars.
+ */
+stockinfo test_prices(long count, const struct price_walk &walk);
+stockinfo test_prices(long count, uint64_t seed = 0, double base = 50);
+
+/**
+ * Time runs calls of f, for the benchmarks. They are hidden, tagged "[.][<module>][benchmark]", so they only run
+ * when asked for: runall "[benchmark]"
+ *
+ * @return The mean seconds per call.
+ */
+template<class F>
+double time_per_run(int runs, F f) {
+	std::chrono::duration<double> elapsed;
+	int x;
+
+	auto start = std::chrono::steady_clock::now();
+	for (x = 0; x < runs; x++)
+		f();
+	elapsed = std::chrono::steady_clock::now() - start;
+
+	return elapsed.count() / runs;
+}
+#endif